@@ -0,0 +1,43 @@
+#!/bin/sh
+# Сравнение epoll и io_uring на одной нагрузке.
+#
+# Нужны две сборки: обычная и с -DGAME_SERVER_IO_URING=ON, например build и build-uring.
+# Нагрузка всегда даётся http_load из первой сборки, чтобы клиент не менялся между прогонами.
+#
+# compare_io_backends.sh <epoll-build-dir> <io_uring-build-dir> <config-file> <www-root> [connections] [requests]
+
+set -e
+
+EPOLL_BUILD=$1
+URING_BUILD=$2
+CONFIG=$3
+WWW_ROOT=$4
+CONNECTIONS=${5:-256}
+REQUESTS=${6:-2000}
+PORT=8080
+
+if [ -z "$WWW_ROOT" ]; then
+    echo "Usage: $0 <epoll-build-dir> <io_uring-build-dir> <config-file> <www-root> [connections] [requests]"
+    exit 1
+fi
+
+run() {
+    backend=$1
+    server=$2
+    "$server" --config-file "$CONFIG" --www-root "$WWW_ROOT" --tick-period 50 > /dev/null &
+    pid=$!
+    sleep 1
+
+    for target in /api/v1/maps /index.html; do
+        # прогрев, затем замер
+        "$EPOLL_BUILD/http_load" 127.0.0.1 $PORT $target "$CONNECTIONS" 100 > /dev/null
+        printf '%-8s %-14s ' "$backend" "$target"
+        "$EPOLL_BUILD/http_load" 127.0.0.1 $PORT $target "$CONNECTIONS" "$REQUESTS"
+    done
+
+    kill -INT $pid
+    wait $pid || true
+}
+
+run epoll "$EPOLL_BUILD/game_server"
+run io_uring "$URING_BUILD/game_server"
@@ -0,0 +1,160 @@
+// Нагрузка keep-alive запросами: много соединений, на каждом запросы идут один за другим.
+// Печатает пропускную способность и перцентили задержки одной строкой.
+//
+// http_load <host> <port> <target> <connections> <requests-per-connection> [threads]
+
+#include <boost/asio/connect.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/beast/core.hpp>
+#include <boost/beast/http.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace net = boost::asio;
+namespace beast = boost::beast;
+namespace http = beast::http;
+using tcp = net::ip::tcp;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+struct Results {
+    std::mutex mutex;
+    std::vector<std::int64_t> latencies_us;
+    std::uint64_t errors = 0;
+};
+
+class Connection : public std::enable_shared_from_this<Connection> {
+public:
+    Connection(net::io_context& ioc, const tcp::resolver::results_type& endpoints, std::string host,
+               std::string target, int requests, Results& results)
+        : stream_(ioc)
+        , endpoints_(endpoints)
+        , requests_left_(requests)
+        , results_(results) {
+        request_.method(http::verb::get);
+        request_.target(target);
+        request_.version(11);
+        request_.set(http::field::host, host);
+        request_.keep_alive(true);
+        latencies_.reserve(requests);
+    }
+
+    void Run() {
+        stream_.async_connect(endpoints_, beast::bind_front_handler(&Connection::OnConnect, shared_from_this()));
+    }
+
+private:
+    beast::tcp_stream stream_;
+    tcp::resolver::results_type endpoints_;
+    beast::flat_buffer buffer_;
+    http::request<http::empty_body> request_;
+    http::response<http::string_body> response_;
+    int requests_left_;
+    Clock::time_point sent_at_;
+    std::vector<std::int64_t> latencies_;
+    Results& results_;
+
+    void OnConnect(beast::error_code ec, const tcp::endpoint&) {
+        if (ec) {
+            return Finish(true);
+        }
+        Send();
+    }
+
+    void Send() {
+        if (requests_left_-- == 0) {
+            return Finish(false);
+        }
+        sent_at_ = Clock::now();
+        http::async_write(stream_, request_, beast::bind_front_handler(&Connection::OnWrite, shared_from_this()));
+    }
+
+    void OnWrite(beast::error_code ec, std::size_t) {
+        if (ec) {
+            return Finish(true);
+        }
+        response_ = {};
+        http::async_read(stream_, buffer_, response_, beast::bind_front_handler(&Connection::OnRead, shared_from_this()));
+    }
+
+    void OnRead(beast::error_code ec, std::size_t) {
+        if (ec || response_.result() != http::status::ok) {
+            return Finish(true);
+        }
+        latencies_.push_back(std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - sent_at_).count());
+        Send();
+    }
+
+    void Finish(bool failed) {
+        std::lock_guard lock{results_.mutex};
+        results_.latencies_us.insert(results_.latencies_us.end(), latencies_.begin(), latencies_.end());
+        results_.errors += failed ? 1 : 0;
+    }
+};
+
+std::int64_t Percentile(const std::vector<std::int64_t>& sorted, double q) {
+    if (sorted.empty()) {
+        return 0;
+    }
+    auto index = static_cast<size_t>(q * static_cast<double>(sorted.size() - 1));
+    return sorted[index];
+}
+
+} // namespace
+
+int main(int argc, const char* argv[]) {
+    if (argc < 6) {
+        std::cerr << "Usage: http_load <host> <port> <target> <connections> <requests-per-connection> [threads]\n";
+        return EXIT_FAILURE;
+    }
+
+    std::string host = argv[1];
+    std::string port = argv[2];
+    std::string target = argv[3];
+    int connections = std::stoi(argv[4]);
+    int requests = std::stoi(argv[5]);
+    unsigned threads = argc > 6 ? static_cast<unsigned>(std::stoi(argv[6])) : std::thread::hardware_concurrency();
+
+    net::io_context ioc(static_cast<int>(threads));
+    auto endpoints = tcp::resolver{ioc}.resolve(host, port);
+
+    Results results;
+    for (int i = 0; i < connections; ++i) {
+        std::make_shared<Connection>(ioc, endpoints, host, target, requests, results)->Run();
+    }
+
+    auto start = Clock::now();
+    std::vector<std::thread> workers;
+    for (unsigned i = 1; i < std::max(1u, threads); ++i) {
+        workers.emplace_back([&ioc] {
+            ioc.run();
+        });
+    }
+    ioc.run();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    auto& latencies = results.latencies_us;
+    std::sort(latencies.begin(), latencies.end());
+    std::cout << "requests=" << latencies.size()
+              << " errors=" << results.errors
+              << " rps=" << static_cast<std::uint64_t>(static_cast<double>(latencies.size()) / seconds)
+              << " p50_us=" << Percentile(latencies, 0.5)
+              << " p90_us=" << Percentile(latencies, 0.9)
+              << " p99_us=" << Percentile(latencies, 0.99)
+              << " max_us=" << (latencies.empty() ? 0 : latencies.back())
+              << std::endl;
+    return results.errors == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,267 @@
+#pragma once
+
+#include <boost/beast/http/verb.hpp>
+
+#include <array>
+#include <charconv>
+#include <cstdint>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+namespace api_router {
+
+namespace http = boost::beast::http;
+
+enum class Route {
+    maps, map, players, join, state, state_stream, spectate, action, batch, tick, records, websocket, tick_metrics
+};
+
+using MethodMask = std::uint8_t;
+
+struct Method {
+    Method() = delete;
+    constexpr static MethodMask GET = 1;
+    constexpr static MethodMask HEAD = 1 << 1;
+    constexpr static MethodMask POST = 1 << 2;
+    constexpr static MethodMask GET_HEAD = GET | HEAD;
+};
+
+constexpr MethodMask ToMethodMask(http::verb verb) {
+    switch (verb) {
+        case http::verb::get:
+            return Method::GET;
+        case http::verb::head:
+            return Method::HEAD;
+        case http::verb::post:
+            return Method::POST;
+        default:
+            return 0;
+    }
+}
+
+struct RouteSpec {
+    std::string_view pattern;
+    Route route;
+    MethodMask methods;
+};
+
+constexpr size_t MAX_PATH_PARAMS = 2;
+
+struct RouteMatch {
+    Route route;
+    MethodMask methods = 0;
+    std::array<std::string_view, MAX_PATH_PARAMS> path_params{};
+    size_t path_params_count = 0;
+
+    constexpr bool IsMethodAllowed(http::verb verb) const {
+        return (methods & ToMethodMask(verb)) != 0;
+    }
+};
+
+// Разбор значения параметра пути или запроса в нужный тип
+template <typename T>
+std::optional<T> ParseParam(std::string_view value) {
+    if constexpr (std::is_same_v<T, std::string_view>) {
+        return value;
+    } else if constexpr (std::is_same_v<T, std::string>) {
+        return std::string(value);
+    } else {
+        static_assert(std::is_arithmetic_v<T> && !std::is_same_v<T, bool>, "Unsupported parameter type");
+        T result{};
+        auto [ptr, ec] = std::from_chars(value.data(), value.data() + value.size(), result);
+        if (value.empty() || ec != std::errc{} || ptr != value.data() + value.size()) {
+            return std::nullopt;
+        }
+        return result;
+    }
+}
+
+template <typename T>
+std::optional<T> GetPathParam(const RouteMatch& match, size_t index) {
+    if (index >= match.path_params_count) {
+        return std::nullopt;
+    }
+    return ParseParam<T>(match.path_params[index]);
+}
+
+// target = путь + "?" + строка запроса
+constexpr std::pair<std::string_view, std::string_view> SplitTarget(std::string_view target) {
+    size_t delim = target.find('?');
+    if (delim == std::string_view::npos) {
+        return {target, {}};
+    }
+    return {target.substr(0, delim), target.substr(delim + 1)};
+}
+
+/*
+ * Префиксное дерево по сегментам пути, строится из таблицы маршрутов при компиляции.
+ * Сегмент вида "{name}" совпадает с любым непустым сегментом и попадает в path_params,
+ * статические сегменты проверяются раньше параметров. Один завершающий "/" допускается.
+ */
+template <size_t MaxNodes>
+class SegmentTrie {
+public:
+    template <size_t N>
+    constexpr explicit SegmentTrie(const std::array<RouteSpec, N>& routes) {
+        for (const RouteSpec& spec : routes) {
+            Insert(spec);
+        }
+    }
+
+    constexpr std::optional<RouteMatch> Match(std::string_view path) const {
+        if (path.empty() || path.front() != '/') {
+            return std::nullopt;
+        }
+        if (path.size() > 1 && path.back() == '/') {
+            path.remove_suffix(1);
+        }
+
+        RouteMatch match{};
+        int node = 0;
+        for (size_t pos = 1; pos <= path.size();) {
+            size_t end = path.find('/', pos);
+            if (end == std::string_view::npos) {
+                end = path.size();
+            }
+            std::string_view segment = path.substr(pos, end - pos);
+            if (segment.empty()) {
+                if (end == path.size()) {
+                    break;
+                }
+                return std::nullopt;
+            }
+
+            int child = FindChild(node, segment);
+            if (child < 0) {
+                child = nodes_[node].param_child;
+                if (child < 0 || match.path_params_count == MAX_PATH_PARAMS) {
+                    return std::nullopt;
+                }
+                match.path_params[match.path_params_count++] = segment;
+            }
+            node = child;
+            pos = end + 1;
+        }
+
+        if (!nodes_[node].terminal) {
+            return std::nullopt;
+        }
+        match.route = nodes_[node].route;
+        match.methods = nodes_[node].methods;
+        return match;
+    }
+
+private:
+    struct Node {
+        std::string_view segment;
+        int first_child = -1;
+        int next_sibling = -1;
+        int param_child = -1;
+        bool terminal = false;
+        Route route{};
+        MethodMask methods = 0;
+    };
+
+    std::array<Node, MaxNodes> nodes_{};
+    size_t size_ = 1;
+
+    constexpr static bool IsParamSegment(std::string_view segment) {
+        return segment.size() > 2 && segment.front() == '{' && segment.back() == '}';
+    }
+
+    constexpr int FindChild(int node, std::string_view segment) const {
+        for (int child = nodes_[node].first_child; child >= 0; child = nodes_[child].next_sibling) {
+            if (nodes_[child].segment == segment) {
+                return child;
+            }
+        }
+        return -1;
+    }
+
+    constexpr int AddNode(std::string_view segment) {
+        if (size_ == MaxNodes) {
+            throw std::length_error("Route table is too large");
+        }
+        nodes_[size_].segment = segment;
+        return static_cast<int>(size_++);
+    }
+
+    // исключение при вычислении на этапе компиляции превращается в ошибку сборки
+    constexpr void Insert(const RouteSpec& spec) {
+        std::string_view pattern = spec.pattern;
+        if (pattern.size() < 2 || pattern.front() != '/' || pattern.back() == '/') {
+            throw std::invalid_argument("Route pattern must start with '/' and have no trailing '/'");
+        }
+
+        int node = 0;
+        for (size_t pos = 1; pos <= pattern.size();) {
+            size_t end = pattern.find('/', pos);
+            if (end == std::string_view::npos) {
+                end = pattern.size();
+            }
+            std::string_view segment = pattern.substr(pos, end - pos);
+            if (segment.empty()) {
+                throw std::invalid_argument("Empty segment in route pattern");
+            }
+
+            if (IsParamSegment(segment)) {
+                if (nodes_[node].param_child < 0) {
+                    int child = AddNode(segment);
+                    nodes_[node].param_child = child;
+                }
+                node = nodes_[node].param_child;
+            } else if (int child = FindChild(node, segment); child >= 0) {
+                node = child;
+            } else {
+                child = AddNode(segment);
+                nodes_[child].next_sibling = nodes_[node].first_child;
+                nodes_[node].first_child = child;
+                node = child;
+            }
+            pos = end + 1;
+        }
+
+        if (nodes_[node].terminal) {
+            throw std::invalid_argument("Duplicate route pattern");
+        }
+        nodes_[node].terminal = true;
+        nodes_[node].route = spec.route;
+        nodes_[node].methods = spec.methods;
+    }
+};
+
+template <size_t N>
+constexpr size_t CountSegments(const std::array<RouteSpec, N>& routes) {
+    size_t count = 0;
+    for (const RouteSpec& spec : routes) {
+        for (char c : spec.pattern) {
+            count += c == '/';
+        }
+    }
+    return count;
+}
+
+constexpr std::array API_ROUTES = std::to_array<RouteSpec>({
+    {"/api/v1/maps", Route::maps, Method::GET_HEAD},
+    {"/api/v1/maps/{id}", Route::map, Method::GET_HEAD},
+    {"/api/v1/game/players", Route::players, Method::GET_HEAD},
+    {"/api/v1/game/join", Route::join, Method::POST},
+    {"/api/v1/game/state", Route::state, Method::GET_HEAD},
+    {"/api/v1/game/state/stream", Route::state_stream, Method::GET},
+    {"/api/v1/game/spectate/{mapId}", Route::spectate, Method::GET},
+    {"/api/v1/game/player/action", Route::action, Method::POST},
+    {"/api/v1/game/batch", Route::batch, Method::POST},
+    {"/api/v1/game/tick", Route::tick, Method::POST},
+    {"/api/v1/game/records", Route::records, Method::GET_HEAD},
+    {"/api/v1/game/ws", Route::websocket, Method::GET},
+    {"/api/v1/admin/tick-metrics", Route::tick_metrics, Method::GET_HEAD},
+});
+
+// корень + по узлу на каждый сегмент каждого шаблона (верхняя оценка)
+inline constexpr SegmentTrie<CountSegments(API_ROUTES) + 1> API_ROUTER{API_ROUTES};
+
+} // namespace api_router
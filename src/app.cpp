@@ -86,39 +86,47 @@ bool ManageDogActionsUseCase::MoveDog(std::string_view token, std::string_view m
         throw ListPlayersError{ListPlayersErrorReason::unknownToken};
     }
 
-    double map_speed = player->GetGameSession()->GetMap()->GetSpeed();
-    model::Dog* dog = player->GetDog();
-
-    if (move.empty()) {
-        dog->Stop();
-    } else if (move == "L"sv) {
-        dog->SetSpeed({-map_speed, 0});
-        dog->SetDirection(model::Direction::WEST);
-    } else if (move == "R"sv) {
-        dog->SetSpeed({map_speed, 0});
-        dog->SetDirection(model::Direction::EAST);
-    } else if (move == "U"sv) {
-        dog->SetSpeed({0, -map_speed});
-        dog->SetDirection(model::Direction::NORTH);
-    } else if (move == "D"sv) {
-        dog->SetSpeed({0, map_speed});
-        dog->SetDirection(model::Direction::SOUTH);
-    } else {
+    auto parsed_move = model::ParseMove(move);
+    if (!parsed_move) {
         return false;
     }
 
+    game_->GetGameSession(player->GetGameSession()->GetMapId())->ApplyMove(player->GetDog()->GetId(), *parsed_move);
     return true;
 }
 
-void ProcessTickUseCase::ProcessTick(std::int64_t tick) {
-    game_->UpdateState(tick);
+bool ManageDogActionsUseCase::EnqueueMove(std::string_view token, std::string_view move) const {
+    auto parsed_move = model::ParseMove(move);
+    if (!parsed_move) {
+        return false;
+    }
+
+    bool found = tokens_->VisitPlayer(user::Token{std::string(token)}, [&parsed_move](const user::Player& player) {
+        player.GetGameSession()->EnqueueMove(player.GetDog()->GetId(), *parsed_move);
+    });
+    if (!found) {
+        throw ListPlayersError{ListPlayersErrorReason::unknownToken};
+    }
+    return true;
+}
+
+void ProcessTickUseCase::ProcessTick(std::int64_t tick, tick_profiler::TickProfiler& profiler, bool skip_idle_loot) {
+    for (const auto& [_, map_sessions] : game_->GetAllSessions()) {
+        for (const auto& session_ptr : map_sessions) {
+            model::GameSession* session = session_ptr.get();
+            session->UpdateState(tick, [&profiler, session](model::TickPhase phase, auto&& run) {
+                profiler.Measure(tick_profiler::ToPhase(phase), session, run);
+            }, skip_idle_loot);
+        }
+    }
 }
 
 void DeletePlayerUseCase::DeletePlayer(const std::string& token) {
     user::Player* player = player_tokens_->FindPlayerByToken(user::Token{token});
+    // токен удаляется первым: после этого потоки ввода уже не доберутся до игрока
+    player_tokens_->DeletePlayer(user::Token{token});
     game_->GetGameSession(player->GetGameSession()->GetMap()->GetId())->DeleteDog(player->GetDog()->GetId());
     players_->Delete(player);
-    player_tokens_->DeletePlayer(user::Token{token});
 }
 
 void LeaderboardUseCase::SaveToLeaderboard(const std::string& name, std::uint16_t score, std::uint16_t time_in_game_ms) {
@@ -145,22 +153,48 @@ const model::GameSession::IdToDogIndex& Application::ListPlayers(std::string_vie
     return get_players_info_use_case_.GetPlayersList(token);
 }
 
+snapshot::Buffer Application::GetGameStateSnapshot(std::string_view token, snapshot::Encoding encoding) {
+    return snapshots_.GetOrBuild(*GetPlayerGameSession(token), encoding);
+}
+
+snapshot::Buffer Application::GetGameStateDelta(std::string_view token, std::uint64_t since_version,
+                                                snapshot::Encoding encoding) {
+    return snapshots_.GetOrBuildDelta(*GetPlayerGameSession(token), since_version, encoding);
+}
+
 JoinGameResult Application::JoinGame(const std::string& user_name, const std::string& map_id) {
     auto join_result = join_game_use_case_.JoinGame(user_name, map_id);
+    snapshots_.Invalidate(GetPlayerGameSession(*join_result.token));
     NotifyListenersJoin(*join_result.token, tokens_.FindPlayerByToken(join_result.token)->GetDog());
     return join_result;
 }
 
 bool Application::MoveDog(std::string_view token, std::string_view move) {
-    return manage_dog_actions_use_case_.MoveDog(token, move);
+    bool moved = manage_dog_actions_use_case_.MoveDog(token, move);
+    if (moved) {
+        snapshots_.Invalidate(GetPlayerGameSession(token));
+    }
+    return moved;
+}
+
+bool Application::EnqueueMove(std::string_view token, std::string_view move) const {
+    return manage_dog_actions_use_case_.EnqueueMove(token, move);
 }
 
 void Application::ProcessTick(std::int64_t tick) {
-    NotifyListenersTick(tick);
-    process_tick_use_case_.ProcessTick(tick);
+    tick_profiler_.BeginTick();
+    // слушатели (уход игроков на покой, сохранение) видят состояние до движения, как и раньше
+    tick_profiler_.Measure(tick_profiler::Phase::listeners, nullptr, [this, tick] {
+        NotifyListenersTick(tick);
+    });
+    process_tick_use_case_.ProcessTick(tick, tick_profiler_, watchdog_.IsAtLeast(overload::Level::skip_idle_loot));
+    PublishSnapshots();
+    tick_profiler_.EndTick();
+    watchdog_.OnTick(tick_profiler_.GetLastTick().total, tick_profiler_.GetBudget());
 }
 
 void Application::DeletePlayer(const std::string& player_token) {
+    snapshots_.Invalidate(GetPlayerGameSession(player_token));
     delete_player_use_case_.DeletePlayer(player_token);
 }
 
@@ -190,6 +224,35 @@ void Application::NotifyListenersTick(std::int64_t tick) const {
     }
 }
 
+void Application::PublishSnapshots() {
+    if (!watchdog_.ShouldPublishSnapshot()) {
+        // подписчики пропускают кадр, а запросы состояния соберут снимок сами
+        for (const auto& [_, map_sessions] : game_->GetAllSessions()) {
+            for (const auto& session : map_sessions) {
+                snapshots_.Invalidate(session.get());
+            }
+        }
+        return;
+    }
+
+    for (const auto& [_, map_sessions] : game_->GetAllSessions()) {
+        for (const auto& session : map_sessions) {
+            tick_profiler_.Measure(tick_profiler::Phase::snapshot, session.get(), [this, &session] {
+                NotifyListenersStateUpdated(*session, snapshots_.Publish(*session));
+            });
+        }
+    }
+}
+
+void Application::NotifyListenersStateUpdated(const model::GameSession& session,
+                                              const snapshot::Buffer& state) const {
+    for (auto* listener : listeners_) {
+        if (listener != nullptr) {
+            listener->OnStateUpdated(session, state);
+        }
+    }
+}
+
 void Application::NotifyListenersJoin(std::string token, model::Dog* dog) const {
     for (auto* listener : listeners_) {
         if (listener != nullptr) {
@@ -2,8 +2,11 @@
 
 #include <boost/asio/ip/tcp.hpp>
 
+#include "game_state_snapshot.h"
 #include "player.h"
 #include "model.h"
+#include "overload_watchdog.h"
+#include "tick_profiler.h"
 #include "./leaderboard/leaderboard.h"
 
 #include <chrono>
@@ -127,14 +130,18 @@ private:
 
 class ManageDogActionsUseCase {
 public:
-    ManageDogActionsUseCase(user::Players* players, user::PlayerTokens* tokens)
-        : players_(players)
+    ManageDogActionsUseCase(model::Game* game, user::Players* players, user::PlayerTokens* tokens)
+        : game_(game)
+        , players_(players)
         , tokens_(tokens) {
     }
 
     bool MoveDog(std::string_view token, std::string_view move);
+    // из любого потока: команда попадёт в очередь сессии и применится в начале тика
+    bool EnqueueMove(std::string_view token, std::string_view move) const;
 
 private:
+    model::Game* game_;
     user::Players* players_;
     user::PlayerTokens* tokens_;
 };
@@ -148,7 +155,8 @@ public:
         : game_(game) {
     }
 
-    void ProcessTick(std::int64_t tick);
+    // фазы сессий по порядку с замером каждой
+    void ProcessTick(std::int64_t tick, tick_profiler::TickProfiler& profiler, bool skip_idle_loot = false);
 
 private:
     model::Game* game_;
@@ -196,6 +204,8 @@ class ApplicationListener {
 public:
     virtual void OnTick(std::chrono::milliseconds delta) = 0;
     virtual void OnJoin(std::string token, model::Dog* dog) {}
+    // состояние сессии после тика, буфер уже опубликован в SnapshotStorage
+    virtual void OnStateUpdated(const model::GameSession& session, const snapshot::Buffer& state) {}
 
 protected:
     ~ApplicationListener() = default;
@@ -222,8 +232,14 @@ public:
     const model::Map* FindMap(model::Map::Id map_id) const;
     const model::GameSession* GetPlayerGameSession(std::string_view token) const;
     const model::GameSession::IdToDogIndex& ListPlayers(std::string_view token) const;
+    snapshot::Buffer GetGameStateSnapshot(std::string_view token,
+                                          snapshot::Encoding encoding = snapshot::Encoding::json);
+    snapshot::Buffer GetGameStateDelta(std::string_view token, std::uint64_t since_version,
+                                       snapshot::Encoding encoding = snapshot::Encoding::json);
     JoinGameResult JoinGame(const std::string& user_name, const std::string& map_id);
     bool MoveDog(std::string_view token, std::string_view move);
+    // потокобезопасно, в отличие от MoveDog; false - неизвестная команда
+    bool EnqueueMove(std::string_view token, std::string_view move) const;
     void ProcessTick(std::int64_t tick);
     void DeletePlayer(const std::string& player_token);
     void SaveToLeaderboard(const std::string& name, std::uint16_t score, std::uint16_t time_in_game_ms);
@@ -232,6 +248,22 @@ public:
     bool IsTokenValid(std::string_view token) const;
     void SetListener(ApplicationListener* listener);
 
+    tick_profiler::TickProfiler& GetTickProfiler() noexcept {
+        return tick_profiler_;
+    }
+
+    const tick_profiler::TickProfiler& GetTickProfiler() const noexcept {
+        return tick_profiler_;
+    }
+
+    overload::Watchdog& GetWatchdog() noexcept {
+        return watchdog_;
+    }
+
+    const overload::Watchdog& GetWatchdog() const noexcept {
+        return watchdog_;
+    }
+
 private:
     model::Game* game_;
     user::Players players_;
@@ -241,11 +273,15 @@ private:
 
     std::vector<ApplicationListener*> listeners_;
 
+    snapshot::SnapshotStorage snapshots_;
+    tick_profiler::TickProfiler tick_profiler_;
+    overload::Watchdog watchdog_;
+
     GetMapUseCase get_map_use_case_{game_};
     ListMapsUseCase list_maps_use_case_{game_};
     GetPlayersInfoUseCase get_players_info_use_case_{&players_, &tokens_};
     JoinGameUseCase join_game_use_case_{game_, &players_, &tokens_};
-    ManageDogActionsUseCase manage_dog_actions_use_case_{&players_, &tokens_};
+    ManageDogActionsUseCase manage_dog_actions_use_case_{game_, &players_, &tokens_};
     ProcessTickUseCase process_tick_use_case_{game_};
     DeletePlayerUseCase delete_player_use_case_{game_, &players_, &tokens_};
     LeaderboardUseCase leaderboard_use_case_{leaderboard_.get()};
@@ -253,6 +289,8 @@ private:
     void NotifyListenersTick(std::int64_t tick) const;
     void NotifyListenersJoin(std::string token, model::Dog* dog) const;
     void NotifyListenersMove(model::Dog* dog, std::string_view move) const;
+    void NotifyListenersStateUpdated(const model::GameSession& session, const snapshot::Buffer& state) const;
+    void PublishSnapshots();
 };
 
 } // namespace app
@@ -16,9 +16,31 @@ namespace po = boost::program_options;
     desc.add_options()
         ("help,h", "produce help message")
         ("tick-period,t", po::value<std::int64_t>(&args.tick_period)->value_name("milliseconds"s), "set tick period")
+        ("tick-catch-up", po::value(&args.tick_catch_up)->value_name("policy"s),
+         "late ticks: skip, coalesce (default) or steps")
+        ("max-degradation-level", po::value(&args.max_degradation_level)->value_name("0-4"s),
+         "deepest overload degradation level, 0 disables the watchdog")
+        ("request-limit", po::value(&args.request_limits)->composing()->value_name("path=body[:header]"s),
+         "request size limits in bytes for a path, may be repeated")
+        ("rate-limit", po::value(&args.rate_limits)->composing()->value_name("path=rate[:burst]"s),
+         "requests per second for one player token on an API path (* for others), may be repeated")
+        ("ip-rate-limit", po::value(&args.ip_rate_limits)->composing()->value_name("path=rate[:burst]"s),
+         "requests per second for one client address on an API path (* for others), may be repeated")
+        ("max-connections", po::value(&args.max_connections)->value_name("count"s),
+         "maximum concurrent HTTP connections, 0 for no limit")
+        ("drain-timeout", po::value(&args.drain_timeout)->value_name("milliseconds"s),
+         "on SIGTERM, how long to wait for in-flight requests before stopping")
         ("config-file,c", po::value(&args.config_file_path)->value_name("file"s), "set config file path")
         ("www-root,w", po::value(&args.static_root)->value_name("dir"s), "set static files root")
         ("randomize-spawn-points", po::bool_switch(&args.random_spawn_point), "spawn dogs at random positions")
+        ("io-context-per-core", po::bool_switch(&args.io_context_per_core),
+         "serve connections with one io_context and SO_REUSEPORT listener per thread")
+        ("coroutine-sessions", po::bool_switch(&args.coroutine_sessions),
+         "serve connections with coroutine sessions instead of callback ones")
+        ("unix-socket", po::value(&args.unix_socket)->value_name("path"s),
+         "also serve HTTP on a Unix domain socket for a local reverse proxy")
+        ("trust-forwarded", po::bool_switch(&args.trust_forwarded),
+         "take the client address from Forwarded/X-Forwarded-For on the TCP port")
         ("state-file", po::value(&args.state_file)->value_name("file"s), "set save state file")
         ("save-state-period", po::value<std::int64_t>(&args.save_state_period)->value_name("milliseconds"s), "set save state period");
 
@@ -35,9 +57,20 @@ namespace po = boost::program_options;
         std::stringstream ss;
         ss << "Basic usage: game_server\n"s
             << "             --tick-period <tick-period in ms> (optional)\n"s
+            << "             --tick-catch-up <skip|coalesce|steps> (optional)\n"s
+            << "             --max-degradation-level <0-4> (optional)\n"s
+            << "             --request-limit <path>=<body>[:<header>] (optional, repeatable)\n"s
+            << "             --rate-limit <path>=<rate>[:<burst>] (optional, repeatable)\n"s
+            << "             --ip-rate-limit <path>=<rate>[:<burst>] (optional, repeatable)\n"s
+            << "             --max-connections <count> (optional)\n"s
+            << "             --drain-timeout <timeout in ms> (optional)\n"s
             << "             --config-file <game-config-json>\n"s
             << "             --www-root <static-files-dir>\n"s
             << "             --randomize-spawn-points (optional)\n"s
+            << "             --io-context-per-core (optional)\n"s
+            << "             --coroutine-sessions (optional)\n"s
+            << "             --unix-socket <socket-path> (optional)\n"s
+            << "             --trust-forwarded (optional)\n"s
             << "             --state-file <state-file-path> (optional)\n"s
             << "             --save-state-period <tick-period in ms> (optional)\n"s;
         throw std::runtime_error(ss.str());
@@ -47,6 +80,14 @@ namespace po = boost::program_options;
         throw std::runtime_error("Tick-period must be positive number in ms"s);
     }
 
+    if (args.drain_timeout < 0) {
+        throw std::runtime_error("Drain-timeout must be positive number in ms"s);
+    }
+
+    if (args.max_degradation_level > 4) {
+        throw std::runtime_error("Max-degradation-level must be from 0 to 4"s);
+    }
+
     return args;
 }
 
@@ -11,11 +11,22 @@ namespace cl_parser {
 
 struct Args {
     std::int64_t tick_period = 0;
+    std::string tick_catch_up = "coalesce";
+    unsigned max_degradation_level = 4;
+    std::vector<std::string> request_limits;
+    std::vector<std::string> rate_limits;
+    std::vector<std::string> ip_rate_limits;
+    std::size_t max_connections = 10000;
+    std::int64_t drain_timeout = 10000;
     std::int64_t save_state_period = 0;
     std::string config_file_path;
     std::string static_root;
     std::string state_file;
     bool random_spawn_point = false;
+    bool io_context_per_core = false;
+    bool coroutine_sessions = false;
+    std::string unix_socket;
+    bool trust_forwarded = false;
 };
 
 [[nodiscard]] std::optional<Args> ParseComandLine(int argc, const char* const argv[]);
@@ -0,0 +1,152 @@
+#include "connection_manager.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace connection_manager {
+
+ConnectionManager::Connection::Connection(Connection&& other) noexcept
+    : manager_(std::move(other.manager_))
+    , requests_(std::exchange(other.requests_, 0)) {
+}
+
+ConnectionManager::Connection& ConnectionManager::Connection::operator=(Connection&& other) noexcept {
+    if (this != &other) {
+        Release();
+        manager_ = std::move(other.manager_);
+        requests_ = std::exchange(other.requests_, 0);
+    }
+    return *this;
+}
+
+ConnectionManager::Connection::~Connection() {
+    Release();
+}
+
+void ConnectionManager::Connection::BeginRequest() {
+    if (manager_) {
+        ++requests_;
+        manager_->requests_.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void ConnectionManager::Connection::EndRequest() {
+    if (manager_ && requests_ > 0) {
+        --requests_;
+        manager_->EndRequests(1);
+    }
+}
+
+std::chrono::milliseconds ConnectionManager::Connection::GetIdleTimeout() const {
+    return manager_ ? manager_->GetIdleTimeout() : ConnectionLimits{}.idle_timeout;
+}
+
+bool ConnectionManager::Connection::IsDraining() const {
+    return manager_ && manager_->IsDraining();
+}
+
+void ConnectionManager::Connection::Release() noexcept {
+    if (!manager_) {
+        return;
+    }
+    // запросы, ответы на которые уже не будут записаны, тоже завершены
+    if (requests_ > 0) {
+        manager_->EndRequests(std::exchange(requests_, 0));
+    }
+    std::exchange(manager_, nullptr)->Release();
+}
+
+std::optional<ConnectionManager::Connection> ConnectionManager::TryAcquire(std::function<void()> waiter) {
+    std::lock_guard lock{mutex_};
+    if (IsDraining()) {
+        return std::nullopt;
+    }
+    if (limits_.max_connections != 0 && connections_.load(std::memory_order_relaxed) >= limits_.max_connections) {
+        waiters_.push_back(std::move(waiter));
+        return std::nullopt;
+    }
+    connections_.fetch_add(1, std::memory_order_relaxed);
+    return Connection{shared_from_this()};
+}
+
+void ConnectionManager::Release() {
+    std::function<void()> waiter;
+    {
+        std::lock_guard lock{mutex_};
+        connections_.fetch_sub(1, std::memory_order_relaxed);
+        if (!waiters_.empty()) {
+            waiter = std::move(waiters_.back());
+            waiters_.pop_back();
+        }
+    }
+    if (waiter) {
+        waiter();
+    }
+}
+
+void ConnectionManager::EndRequests(size_t count) {
+    if (requests_.fetch_sub(count, std::memory_order_acq_rel) == count) {
+        NotifyIfDrained();
+    }
+}
+
+void ConnectionManager::OnDrain(std::function<void()> hook) {
+    {
+        std::lock_guard lock{mutex_};
+        if (!IsDraining()) {
+            drain_hooks_.push_back(std::move(hook));
+            return;
+        }
+    }
+    hook();
+}
+
+void ConnectionManager::Drain(std::function<void()> on_drained) {
+    std::vector<std::function<void()>> hooks;
+    std::vector<std::function<void()>> waiters;
+    {
+        std::lock_guard lock{mutex_};
+        if (IsDraining()) {
+            return;
+        }
+        draining_.store(true, std::memory_order_release);
+        on_drained_ = std::move(on_drained);
+        hooks = std::move(drain_hooks_);
+        // ожидающие места акцепторы больше не понадобятся
+        waiters = std::move(waiters_);
+    }
+    for (auto& hook : hooks) {
+        hook();
+    }
+    NotifyIfDrained();
+}
+
+void ConnectionManager::NotifyIfDrained() {
+    std::function<void()> on_drained;
+    {
+        std::lock_guard lock{mutex_};
+        if (!IsDraining() || requests_.load(std::memory_order_acquire) != 0) {
+            return;
+        }
+        on_drained = std::exchange(on_drained_, nullptr);
+    }
+    if (on_drained) {
+        on_drained();
+    }
+}
+
+std::chrono::milliseconds ConnectionManager::GetIdleTimeout() const {
+    if (limits_.max_connections == 0 || limits_.idle_shrink_from >= 1.) {
+        return limits_.idle_timeout;
+    }
+    double load = static_cast<double>(GetConnectionCount()) / static_cast<double>(limits_.max_connections);
+    if (load <= limits_.idle_shrink_from) {
+        return limits_.idle_timeout;
+    }
+    // от idle_timeout до min_idle_timeout линейно по доле занятых мест
+    double shrink = std::min(1., (load - limits_.idle_shrink_from) / (1. - limits_.idle_shrink_from));
+    auto range = limits_.idle_timeout - limits_.min_idle_timeout;
+    return limits_.idle_timeout - std::chrono::duration_cast<std::chrono::milliseconds>(range * shrink);
+}
+
+} // namespace connection_manager
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+namespace connection_manager {
+
+struct ConnectionLimits {
+    // 0 - без ограничения
+    size_t max_connections = 10000;
+    std::chrono::milliseconds idle_timeout = std::chrono::seconds{30};
+    // таймаут простоя при занятых всех местах
+    std::chrono::milliseconds min_idle_timeout = std::chrono::seconds{2};
+    // с какой доли занятых мест таймаут простоя начинает сокращаться
+    double idle_shrink_from = 0.5;
+};
+
+/*
+ * Учёт HTTP-соединений всех акцепторов сервера. Место под соединение занимается до accept:
+ * если мест нет, акцептор ждёт, пока какое-нибудь соединение закроется, и новые клиенты
+ * остаются в очереди listen. Чем больше занято мест, тем быстрее закрываются простаивающие соединения.
+ *
+ * При остановке (Drain) акцепторы закрываются, а когда обрабатываемых запросов не остаётся,
+ * вызывается on_drained. Методы можно вызывать из любого потока.
+ */
+class ConnectionManager : public std::enable_shared_from_this<ConnectionManager> {
+public:
+    // место, занятое соединением; освобождается при разрушении
+    class Connection {
+    public:
+        Connection() = default;
+        Connection(Connection&& other) noexcept;
+        Connection& operator=(Connection&& other) noexcept;
+        ~Connection();
+
+        // запрос прочитан и передан обработчику
+        void BeginRequest();
+        // ответ на запрос записан
+        void EndRequest();
+
+        std::chrono::milliseconds GetIdleTimeout() const;
+        // после текущих запросов соединение нужно закрыть
+        bool IsDraining() const;
+
+    private:
+        friend class ConnectionManager;
+
+        explicit Connection(std::shared_ptr<ConnectionManager> manager)
+            : manager_(std::move(manager)) {
+        }
+
+        void Release() noexcept;
+
+        std::shared_ptr<ConnectionManager> manager_;
+        size_t requests_ = 0;
+    };
+
+    explicit ConnectionManager(ConnectionLimits limits = {})
+        : limits_(limits) {
+    }
+
+    ConnectionManager(const ConnectionManager&) = delete;
+    ConnectionManager& operator=(const ConnectionManager&) = delete;
+
+    /*
+     * Занимает место под соединение. Если мест нет, возвращает nullopt, а waiter будет вызван
+     * один раз, когда место освободится (в потоке, где закрылось соединение). При остановке
+     * мест не даётся и waiter не запоминается.
+     */
+    std::optional<Connection> TryAcquire(std::function<void()> waiter);
+
+    // вызывается при начале остановки, например чтобы закрыть акцептор
+    void OnDrain(std::function<void()> hook);
+    void Drain(std::function<void()> on_drained);
+
+    bool IsDraining() const noexcept {
+        return draining_.load(std::memory_order_acquire);
+    }
+
+    size_t GetConnectionCount() const noexcept {
+        return connections_.load(std::memory_order_relaxed);
+    }
+
+    size_t GetRequestCount() const noexcept {
+        return requests_.load(std::memory_order_relaxed);
+    }
+
+    std::chrono::milliseconds GetIdleTimeout() const;
+
+    const ConnectionLimits& GetLimits() const noexcept {
+        return limits_;
+    }
+
+private:
+    ConnectionLimits limits_;
+    std::atomic<size_t> connections_ = 0;
+    std::atomic<size_t> requests_ = 0;
+    std::atomic<bool> draining_ = false;
+
+    std::mutex mutex_;
+    std::vector<std::function<void()>> waiters_;
+    std::vector<std::function<void()>> drain_hooks_;
+    std::function<void()> on_drained_;
+
+    void Release();
+    void EndRequests(size_t count);
+    void NotifyIfDrained();
+};
+
+} // namespace connection_manager
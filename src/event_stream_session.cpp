@@ -0,0 +1,128 @@
+#include "event_stream_session.h"
+#include "http_server.h"
+
+#include <boost/asio/dispatch.hpp>
+#include <boost/asio/post.hpp>
+#include <boost/asio/write.hpp>
+
+#include <array>
+#include <string_view>
+
+namespace state_stream {
+
+using namespace std::literals;
+
+EventStreamSession::EventStreamSession(beast::tcp_stream&& stream, Connection&& connection, Strand& game_strand,
+                                       StateHub& hub, const model::GameSession* session, Options options)
+    : stream_(std::move(stream))
+    , connection_(std::move(connection))
+    , game_strand_(game_strand)
+    , hub_(hub)
+    , session_(session)
+    , options_(options) {
+}
+
+void EventStreamSession::Run(unsigned http_version) {
+    header_ = http_server::MakeEventStreamHeader(http_version);
+
+    stream_.expires_after(STREAM_WRITE_TIMEOUT);
+    http::async_write_header(stream_, header_serializer_,
+                             beast::bind_front_handler(&EventStreamSession::OnWriteHeader, shared_from_this()));
+}
+
+void EventStreamSession::OnFrame(const snapshot::Buffer& frame) {
+    if (options_.max_fps != 0) {
+        auto now = Clock::now();
+        if (now < next_frame_time_) {
+            return;
+        }
+        // средняя частота не падает из-за дрожания тиков вокруг границы интервала
+        next_frame_time_ = std::max(next_frame_time_ + std::chrono::microseconds{1'000'000 / options_.max_fps}, now);
+    }
+
+    net::post(stream_.get_executor(), [self = shared_from_this(), frame] {
+        self->Send(frame);
+    });
+}
+
+void EventStreamSession::OnWriteHeader(beast::error_code ec, [[maybe_unused]] std::size_t bytes_written) {
+    if (ec) {
+        closed_ = true;
+        return http_server::ReportError(ec, "event stream write"sv);
+    }
+
+    net::dispatch(game_strand_, [self = shared_from_this()] {
+        self->hub_.Subscribe(self->session_, self->weak_from_this());
+    });
+
+    // ожидание данных от клиента не ограничено, таймаут ставится на каждую запись кадра
+    stream_.expires_never();
+    Read();
+}
+
+void EventStreamSession::Read() {
+    stream_.async_read_some(net::buffer(read_buffer_),
+                            beast::bind_front_handler(&EventStreamSession::OnRead, shared_from_this()));
+}
+
+void EventStreamSession::OnRead(beast::error_code ec, [[maybe_unused]] std::size_t bytes_read) {
+    if (!ec) {
+        // присланное клиентом не нужно
+        return Read();
+    }
+
+    // после текущей записи сессия закончится вместе с последней ссылкой на неё
+    closed_ = true;
+    pending_frame_.reset();
+    if (ec != net::error::eof && ec != net::error::operation_aborted && !http_server::IsClientDisconnect(ec)) {
+        http_server::ReportError(ec, "event stream read"sv);
+    }
+}
+
+void EventStreamSession::Send(snapshot::Buffer frame) {
+    if (closed_) {
+        return;
+    }
+
+    if (writing_) {
+        // предыдущий неотправленный кадр устарел
+        pending_frame_ = std::move(frame);
+        return;
+    }
+
+    writing_frame_ = std::move(frame);
+    Write();
+}
+
+void EventStreamSession::Write() {
+    writing_ = true;
+    std::array<net::const_buffer, 3> event = {
+        net::buffer(STATE_EVENT_PREFIX), net::buffer(*writing_frame_), net::buffer(STATE_EVENT_SUFFIX)
+    };
+
+    stream_.expires_after(STREAM_WRITE_TIMEOUT);
+    net::async_write(stream_, event, beast::bind_front_handler(&EventStreamSession::OnWrite, shared_from_this()));
+}
+
+void EventStreamSession::OnWrite(beast::error_code ec, [[maybe_unused]] std::size_t bytes_written) {
+    writing_ = false;
+    writing_frame_.reset();
+
+    if (ec) {
+        if (!closed_ && !http_server::IsClientDisconnect(ec)) {
+            http_server::ReportError(ec, "event stream write"sv);
+        }
+        closed_ = true;
+        pending_frame_.reset();
+        // прерывает ожидающее чтение, чтобы сессия не ждала закрытия соединения клиентом
+        stream_.close();
+        return;
+    }
+
+    if (pending_frame_) {
+        writing_frame_ = std::exchange(pending_frame_, nullptr);
+        Write();
+    }
+}
+
+} // namespace state_stream
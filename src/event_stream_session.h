@@ -0,0 +1,79 @@
+#pragma once
+
+#include "state_stream.h"
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/strand.hpp>
+#include <boost/beast/core.hpp>
+#include <boost/beast/http.hpp>
+
+#include <array>
+#include <chrono>
+#include <memory>
+
+namespace state_stream {
+
+namespace net = boost::asio;
+namespace beast = boost::beast;
+namespace http = beast::http;
+
+/*
+ * Поток text/event-stream с состоянием сессии: после заголовков ответа
+ * каждый кадр уходит событием "event: state". Частота кадров ограничивается max_fps,
+ * медленному клиенту отправляется только самый свежий кадр, остальные отбрасываются.
+ * Клиент ничего не присылает, но чтение из соединения ждёт всё время, пока оно открыто:
+ * оно держит сессию (StateHub хранит её по weak_ptr) и замечает, что клиент ушёл.
+ */
+class EventStreamSession : public Subscriber, public std::enable_shared_from_this<EventStreamSession> {
+public:
+    struct Options {
+        // 0 - каждый тик
+        unsigned max_fps = 0;
+    };
+
+    EventStreamSession(beast::tcp_stream&& stream, Connection&& connection, Strand& game_strand, StateHub& hub,
+                       const model::GameSession* session, Options options);
+
+    EventStreamSession(const EventStreamSession&) = delete;
+    EventStreamSession& operator=(const EventStreamSession&) = delete;
+
+    void Run(unsigned http_version);
+
+    void OnFrame(const snapshot::Buffer& frame) override;
+
+    snapshot::Encoding GetEncoding() const override {
+        return snapshot::Encoding::json;
+    }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    beast::tcp_stream stream_;
+    Connection connection_;
+    Strand& game_strand_;
+    StateHub& hub_;
+    const model::GameSession* session_;
+    Options options_;
+
+    http::response<http::empty_body> header_;
+    http::response_serializer<http::empty_body> header_serializer_{header_};
+
+    // только на strand игры
+    Clock::time_point next_frame_time_{};
+
+    // только на executor соединения
+    std::array<char, 64> read_buffer_;
+    snapshot::Buffer writing_frame_;
+    snapshot::Buffer pending_frame_;
+    bool writing_ = false;
+    bool closed_ = false;
+
+    void OnWriteHeader(beast::error_code ec, std::size_t bytes_written);
+    void Read();
+    void OnRead(beast::error_code ec, std::size_t bytes_read);
+    void Send(snapshot::Buffer frame);
+    void Write();
+    void OnWrite(beast::error_code ec, std::size_t bytes_written);
+};
+
+} // namespace state_stream
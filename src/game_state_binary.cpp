@@ -0,0 +1,151 @@
+#include "game_state_binary.h"
+
+#include <bit>
+#include <cstring>
+
+namespace snapshot {
+
+namespace {
+
+std::uint8_t DirectionToCode(model::Direction dir) {
+    switch (dir) {
+        case model::Direction::NORTH:
+            return 0;
+        case model::Direction::SOUTH:
+            return 1;
+        case model::Direction::WEST:
+            return 2;
+        case model::Direction::EAST:
+            return 3;
+    }
+    throw std::runtime_error("Unknown direction status in Dog class");
+}
+
+void PutHeader(BinaryWriter& writer, MessageType type) {
+    writer.PutU8(static_cast<std::uint8_t>(type));
+    writer.PutU8(FORMAT_VERSION);
+}
+
+void PutDog(BinaryWriter& writer, const model::Dog& dog) {
+    writer.PutVarint(*dog.GetId());
+    writer.PutFloat(dog.GetPosition().x);
+    writer.PutFloat(dog.GetPosition().y);
+    writer.PutFloat(dog.GetSpeed().x);
+    writer.PutFloat(dog.GetSpeed().y);
+    writer.PutU8(DirectionToCode(dog.GetDirection()));
+    writer.PutVarint(dog.GetScore());
+
+    const auto& bag = dog.GetBag()->GetAllLoot();
+    writer.PutVarint(bag.size());
+    for (const auto& loot : bag) {
+        writer.PutVarint(*loot.id);
+        writer.PutU8(loot.type);
+    }
+}
+
+void PutLoot(BinaryWriter& writer, const model::Loot& loot) {
+    writer.PutVarint(*loot.id);
+    writer.PutU8(loot.type);
+    writer.PutFloat(loot.point.x);
+    writer.PutFloat(loot.point.y);
+}
+
+void PutFullState(BinaryWriter& writer, const model::GameSession& session) {
+    writer.PutVarint(session.GetDogs().size());
+    for (const auto& [_, dog] : session.GetDogs()) {
+        PutDog(writer, *dog);
+    }
+
+    writer.PutVarint(session.GetAllLoot().size());
+    for (const auto& [_, loot] : session.GetAllLoot()) {
+        PutLoot(writer, *loot);
+    }
+}
+
+} // namespace
+
+void BinaryWriter::PutU8(std::uint8_t value) {
+    out_.push_back(static_cast<char>(value));
+}
+
+void BinaryWriter::PutVarint(std::uint64_t value) {
+    while (value >= 0x80) {
+        out_.push_back(static_cast<char>((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    out_.push_back(static_cast<char>(value));
+}
+
+void BinaryWriter::PutFloat(double value) {
+    auto bits = std::bit_cast<std::uint32_t>(static_cast<float>(value));
+    for (int i = 0; i < 4; ++i) {
+        out_.push_back(static_cast<char>(bits & 0xFF));
+        bits >>= 8;
+    }
+}
+
+void BinaryWriter::PutString(std::string_view value) {
+    PutVarint(value.size());
+    out_.append(value);
+}
+
+std::string EncodeGameStateBinary(const model::GameSession& session) {
+    std::string out;
+    BinaryWriter writer{out};
+    PutHeader(writer, MessageType::game_state);
+    PutFullState(writer, session);
+    return out;
+}
+
+std::string EncodeGameStateDeltaBinary(const model::GameSession& session, std::uint64_t since_version) {
+    std::string out;
+    BinaryWriter writer{out};
+    PutHeader(writer, MessageType::game_state_delta);
+    writer.PutVarint(session.GetVersion());
+
+    if (!session.CanMakeDelta(since_version)) {
+        writer.PutU8(1);
+        PutFullState(writer, session);
+        writer.PutVarint(0);
+        writer.PutVarint(0);
+        return out;
+    }
+
+    model::GameSession::StateDelta delta = session.MakeDelta(since_version);
+    writer.PutU8(0);
+
+    writer.PutVarint(delta.changed_dogs.size());
+    for (const model::Dog* dog : delta.changed_dogs) {
+        PutDog(writer, *dog);
+    }
+
+    writer.PutVarint(delta.spawned_loot.size());
+    for (const model::Loot* loot : delta.spawned_loot) {
+        PutLoot(writer, *loot);
+    }
+
+    writer.PutVarint(delta.removed_dogs.size());
+    for (const auto& id : delta.removed_dogs) {
+        writer.PutVarint(*id);
+    }
+
+    writer.PutVarint(delta.removed_loot.size());
+    for (const auto& id : delta.removed_loot) {
+        writer.PutVarint(*id);
+    }
+    return out;
+}
+
+std::string EncodePlayersBinary(const model::GameSession::IdToDogIndex& dogs) {
+    std::string out;
+    BinaryWriter writer{out};
+    PutHeader(writer, MessageType::players);
+    writer.PutVarint(dogs.size());
+    for (const auto& [id, dog] : dogs) {
+        writer.PutVarint(*id);
+        writer.PutString(dog->GetName());
+    }
+    return out;
+}
+
+} // namespace snapshot
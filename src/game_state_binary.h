@@ -0,0 +1,71 @@
+#pragma once
+
+#include "model.h"
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace snapshot {
+
+/*
+ * Компактный двоичный формат ответов /api/v1/game/state и /api/v1/game/players.
+ * Выбирается заголовком "Accept: application/octet-stream" или параметром запроса format=binary.
+ * Декодер для браузера: static/js/state_decoder.js
+ *
+ * Все многобайтовые поля little-endian.
+ *   u8       - беззнаковый байт
+ *   f32      - IEEE 754 float32
+ *   varint   - беззнаковое целое LEB128: по 7 бит в байте, старший бит - признак продолжения
+ *   string   - varint длина + байты UTF-8
+ *
+ * Заголовок любого сообщения:
+ *   u8 message_type   - MessageType
+ *   u8 format_version - FORMAT_VERSION
+ *
+ * game_state (1):
+ *   varint players_count, затем players_count раз:
+ *     varint id, f32 pos_x, f32 pos_y, f32 speed_x, f32 speed_y,
+ *     u8 dir (0 - U, 1 - D, 2 - L, 3 - R), varint score,
+ *     varint bag_size, затем bag_size раз: varint loot_id, u8 loot_type
+ *   varint lost_objects_count, затем lost_objects_count раз:
+ *     varint id, u8 type, f32 pos_x, f32 pos_y
+ *
+ * players (2):
+ *   varint players_count, затем players_count раз: varint id, string name
+ *
+ * game_state_delta (3):
+ *   varint version, u8 full (1 - полное состояние вместо дельты),
+ *   далее players и lost_objects в том же виде, что и в game_state,
+ *   varint removed_players_count, затем varint id каждого,
+ *   varint removed_objects_count, затем varint id каждого
+ */
+
+enum class MessageType : std::uint8_t {
+    game_state = 1,
+    players = 2,
+    game_state_delta = 3
+};
+
+constexpr std::uint8_t FORMAT_VERSION = 1;
+
+std::string EncodeGameStateBinary(const model::GameSession& session);
+std::string EncodeGameStateDeltaBinary(const model::GameSession& session, std::uint64_t since_version);
+std::string EncodePlayersBinary(const model::GameSession::IdToDogIndex& dogs);
+
+class BinaryWriter {
+public:
+    explicit BinaryWriter(std::string& out)
+        : out_(out) {
+    }
+
+    void PutU8(std::uint8_t value);
+    void PutVarint(std::uint64_t value);
+    void PutFloat(double value);
+    void PutString(std::string_view value);
+
+private:
+    std::string& out_;
+};
+
+} // namespace snapshot
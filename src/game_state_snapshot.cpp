@@ -0,0 +1,187 @@
+#include "game_state_snapshot.h"
+#include "game_state_binary.h"
+#include "json_writer.h"
+
+namespace snapshot {
+
+using namespace std::literals;
+
+namespace {
+
+// примерные размеры сериализованных объектов, чтобы строка не перевыделялась по ходу записи
+constexpr size_t DOG_JSON_SIZE_HINT = 128;
+constexpr size_t LOOT_JSON_SIZE_HINT = 48;
+
+void WriteDog(json_writer::JsonWriter& writer, const model::Dog& dog) {
+    const geom::Point2D& pos = dog.GetPosition();
+    const geom::Vec2D& speed = dog.GetSpeed();
+
+    writer.Key(*dog.GetId()).BeginObject()
+        .Key("pos"sv).Point(pos.x, pos.y)
+        .Key("speed"sv).Point(speed.x, speed.y)
+        .Key("dir"sv).String(model::DirectionToString(dog.GetDirection()))
+        .Key("score"sv).Uint(dog.GetScore());
+
+    writer.Key("bag"sv).BeginArray();
+    for (const auto& loot : dog.GetBag()->GetAllLoot()) {
+        writer.BeginObject().Key("id"sv).Uint(*loot.id).Key("type"sv).Uint(loot.type).EndObject();
+    }
+    writer.EndArray();
+
+    writer.EndObject();
+}
+
+void WriteLoot(json_writer::JsonWriter& writer, const model::Loot& loot) {
+    writer.Key(*loot.id).BeginObject()
+        .Key("type"sv).Uint(loot.type)
+        .Key("pos"sv).Point(loot.point.x, loot.point.y)
+        .EndObject();
+}
+
+void WriteFullState(json_writer::JsonWriter& writer, const model::GameSession& session) {
+    writer.Key("players"sv).BeginObject();
+    for (const auto& [_, dog] : session.GetDogs()) {
+        WriteDog(writer, *dog);
+    }
+    writer.EndObject();
+
+    writer.Key("lostObjects"sv).BeginObject();
+    for (const auto& [_, loot] : session.GetAllLoot()) {
+        WriteLoot(writer, *loot);
+    }
+    writer.EndObject();
+}
+
+size_t EstimateFullStateSize(const model::GameSession& session) {
+    return session.GetDogs().size() * DOG_JSON_SIZE_HINT + session.GetAllLoot().size() * LOOT_JSON_SIZE_HINT + 64;
+}
+
+} // namespace
+
+std::string SerializeGameState(const model::GameSession& session) {
+    std::string out;
+    out.reserve(EstimateFullStateSize(session));
+    json_writer::JsonWriter writer{out};
+    writer.BeginObject();
+    WriteFullState(writer, session);
+    writer.EndObject();
+    return out;
+}
+
+std::string SerializeGameStateDelta(const model::GameSession& session, std::uint64_t since_version) {
+    std::string out;
+    json_writer::JsonWriter writer{out};
+
+    if (!session.CanMakeDelta(since_version)) {
+        out.reserve(EstimateFullStateSize(session));
+        writer.BeginObject();
+        WriteFullState(writer, session);
+        writer.Key("version"sv).Uint(session.GetVersion()).Key("full"sv).Bool(true);
+        writer.EndObject();
+        return out;
+    }
+
+    model::GameSession::StateDelta delta = session.MakeDelta(since_version);
+    out.reserve(delta.changed_dogs.size() * DOG_JSON_SIZE_HINT + delta.spawned_loot.size() * LOOT_JSON_SIZE_HINT
+                + (delta.removed_dogs.size() + delta.removed_loot.size()) * 8 + 128);
+
+    writer.BeginObject();
+    writer.Key("version"sv).Uint(session.GetVersion()).Key("full"sv).Bool(false);
+
+    writer.Key("players"sv).BeginObject();
+    for (const model::Dog* dog : delta.changed_dogs) {
+        WriteDog(writer, *dog);
+    }
+    writer.EndObject();
+
+    writer.Key("lostObjects"sv).BeginObject();
+    for (const model::Loot* loot : delta.spawned_loot) {
+        WriteLoot(writer, *loot);
+    }
+    writer.EndObject();
+
+    writer.Key("removedPlayers"sv).BeginArray();
+    for (const auto& id : delta.removed_dogs) {
+        writer.Uint(*id);
+    }
+    writer.EndArray();
+
+    writer.Key("removedObjects"sv).BeginArray();
+    for (const auto& id : delta.removed_loot) {
+        writer.Uint(*id);
+    }
+    writer.EndArray();
+
+    writer.EndObject();
+    return out;
+}
+
+Buffer SessionSnapshot::Load(Encoding encoding) const {
+    return std::atomic_load_explicit(&buffers_[static_cast<size_t>(encoding)], std::memory_order_acquire);
+}
+
+void SessionSnapshot::Store(Encoding encoding, Buffer buffer) {
+    std::atomic_store_explicit(&buffers_[static_cast<size_t>(encoding)], std::move(buffer), std::memory_order_release);
+}
+
+void SessionSnapshot::Reset() {
+    Store(Encoding::json, nullptr);
+    Store(Encoding::binary, nullptr);
+    deltas_ = {};
+}
+
+Buffer SessionSnapshot::FindDelta(Encoding encoding, std::uint64_t since_version) const {
+    const Delta& delta = deltas_[static_cast<size_t>(encoding)];
+    if (delta.since_version == since_version) {
+        return delta.buffer;
+    }
+    return nullptr;
+}
+
+void SessionSnapshot::StoreDelta(Encoding encoding, std::uint64_t since_version, Buffer delta) {
+    deltas_[static_cast<size_t>(encoding)] = {since_version, std::move(delta)};
+}
+
+Buffer SnapshotStorage::Publish(const model::GameSession& session) {
+    auto buffer = std::make_shared<const std::string>(SerializeGameState(session));
+    SessionSnapshot& session_snapshot = snapshots_[&session];
+    session_snapshot.Reset();
+    session_snapshot.Store(Encoding::json, buffer);
+    return buffer;
+}
+
+void SnapshotStorage::Invalidate(const model::GameSession* session) {
+    if (auto it = snapshots_.find(session); it != snapshots_.end()) {
+        it->second.Reset();
+    }
+}
+
+Buffer SnapshotStorage::GetOrBuild(const model::GameSession& session, Encoding encoding) {
+    SessionSnapshot& session_snapshot = snapshots_[&session];
+    if (auto buffer = session_snapshot.Load(encoding)) {
+        return buffer;
+    }
+
+    // снимок сбрасывается при входе игрока или смене направления между тиками
+    auto buffer = std::make_shared<const std::string>(encoding == Encoding::json ? SerializeGameState(session)
+                                                                                 : EncodeGameStateBinary(session));
+    session_snapshot.Store(encoding, buffer);
+    return buffer;
+}
+
+Buffer SnapshotStorage::GetOrBuildDelta(const model::GameSession& session, std::uint64_t since_version,
+                                        Encoding encoding) {
+    SessionSnapshot& session_snapshot = snapshots_[&session];
+    // большинство клиентов опрашивают каждый тик и просят дельту от одной и той же версии
+    if (auto delta = session_snapshot.FindDelta(encoding, since_version)) {
+        return delta;
+    }
+
+    auto delta = std::make_shared<const std::string>(encoding == Encoding::json
+                                                     ? SerializeGameStateDelta(session, since_version)
+                                                     : EncodeGameStateDeltaBinary(session, since_version));
+    session_snapshot.StoreDelta(encoding, since_version, delta);
+    return delta;
+}
+
+} // namespace snapshot
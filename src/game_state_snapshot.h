@@ -0,0 +1,63 @@
+#pragma once
+
+#include "model.h"
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <unordered_map>
+
+namespace snapshot {
+
+// Неизменяемый закодированный снимок состояния игровой сессии.
+// Один буфер разделяется между всеми запросами состояния до следующего тика.
+using Buffer = std::shared_ptr<const std::string>;
+
+std::string SerializeGameState(const model::GameSession& session);
+// Изменения с версии since_version; если версия слишком старая, то полное состояние с "full": true
+std::string SerializeGameStateDelta(const model::GameSession& session, std::uint64_t since_version);
+
+enum class Encoding {
+    json, binary
+};
+
+class SessionSnapshot {
+public:
+    Buffer Load(Encoding encoding) const;
+    void Store(Encoding encoding, Buffer buffer);
+    void Reset();
+
+    Buffer FindDelta(Encoding encoding, std::uint64_t since_version) const;
+    void StoreDelta(Encoding encoding, std::uint64_t since_version, Buffer delta);
+
+private:
+    struct Delta {
+        std::optional<std::uint64_t> since_version;
+        Buffer buffer;
+    };
+
+    // доступ к буферам только через std::atomic_load/std::atomic_store
+    std::array<Buffer, 2> buffers_;
+
+    // последняя запрошенная дельта, используется только на strand игрового состояния
+    std::array<Delta, 2> deltas_;
+};
+
+class SnapshotStorage {
+public:
+    // Кодирует состояние сессии в JSON и атомарно публикует новый буфер,
+    // двоичный снимок строится при первом запросе
+    Buffer Publish(const model::GameSession& session);
+    void Invalidate(const model::GameSession* session);
+    Buffer GetOrBuild(const model::GameSession& session, Encoding encoding = Encoding::json);
+    Buffer GetOrBuildDelta(const model::GameSession& session, std::uint64_t since_version,
+                           Encoding encoding = Encoding::json);
+
+private:
+    std::unordered_map<const model::GameSession*, SessionSnapshot> snapshots_;
+};
+
+} // namespace snapshot
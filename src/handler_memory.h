@@ -0,0 +1,135 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace handler_memory {
+
+/*
+ * Память под состояние асинхронных операций одного соединения или акцептора.
+ * Пока есть свободный блок, операция размещается в нём, иначе - в куче.
+ * Блоков хватает на одновременные чтение, запись и передачу ответов из других контекстов.
+ * Блок может освобождаться в другом потоке, чем был занят, поэтому флаги атомарные.
+ */
+class HandlerMemory {
+public:
+    constexpr static size_t BLOCK_SIZE = 2048;
+    constexpr static size_t BLOCK_COUNT = 4;
+
+    struct Stats {
+        std::uint64_t recycled = 0;
+        std::uint64_t heap = 0;
+    };
+
+    HandlerMemory() = default;
+
+    HandlerMemory(const HandlerMemory&) = delete;
+    HandlerMemory& operator=(const HandlerMemory&) = delete;
+
+    void* Allocate(size_t size, size_t alignment) {
+        if (size <= BLOCK_SIZE && alignment <= alignof(std::max_align_t)) {
+            for (auto& block : blocks_) {
+                if (!block.in_use.exchange(true, std::memory_order_acquire)) {
+                    recycled_.fetch_add(1, std::memory_order_relaxed);
+                    return block.storage;
+                }
+            }
+        }
+        heap_.fetch_add(1, std::memory_order_relaxed);
+        return ::operator new(size, std::align_val_t{alignment});
+    }
+
+    void Deallocate(void* pointer, size_t alignment) noexcept {
+        for (auto& block : blocks_) {
+            if (pointer == block.storage) {
+                block.in_use.store(false, std::memory_order_release);
+                return;
+            }
+        }
+        ::operator delete(pointer, std::align_val_t{alignment});
+    }
+
+    Stats GetStats() const noexcept {
+        return {recycled_.load(std::memory_order_relaxed), heap_.load(std::memory_order_relaxed)};
+    }
+
+private:
+    struct Block {
+        alignas(std::max_align_t) unsigned char storage[BLOCK_SIZE];
+        std::atomic<bool> in_use = false;
+    };
+
+    Block blocks_[BLOCK_COUNT];
+    std::atomic<std::uint64_t> recycled_ = 0;
+    std::atomic<std::uint64_t> heap_ = 0;
+};
+
+template <typename T>
+class HandlerAllocator {
+public:
+    using value_type = T;
+
+    explicit HandlerAllocator(HandlerMemory& memory) noexcept
+        : memory_(&memory) {
+    }
+
+    template <typename U>
+    HandlerAllocator(const HandlerAllocator<U>& other) noexcept
+        : memory_(other.memory_) {
+    }
+
+    T* allocate(size_t n) {
+        return static_cast<T*>(memory_->Allocate(sizeof(T) * n, alignof(T)));
+    }
+
+    void deallocate(T* pointer, size_t /*n*/) noexcept {
+        memory_->Deallocate(pointer, alignof(T));
+    }
+
+    template <typename U>
+    bool operator==(const HandlerAllocator<U>& other) const noexcept {
+        return memory_ == other.memory_;
+    }
+
+private:
+    template <typename U>
+    friend class HandlerAllocator;
+
+    HandlerMemory* memory_;
+};
+
+// обработчик, состояние операции которого Asio размещает через HandlerAllocator
+template <typename Handler>
+class AllocHandler {
+public:
+    using allocator_type = HandlerAllocator<Handler>;
+
+    AllocHandler(HandlerMemory& memory, Handler handler)
+        : memory_(&memory)
+        , handler_(std::move(handler)) {
+    }
+
+    allocator_type get_allocator() const noexcept {
+        return allocator_type{*memory_};
+    }
+
+    template <typename... Args>
+    void operator()(Args&&... args) {
+        handler_(std::forward<Args>(args)...);
+    }
+
+private:
+    HandlerMemory* memory_;
+    Handler handler_;
+};
+
+template <typename Handler>
+AllocHandler<std::decay_t<Handler>> MakeAllocHandler(HandlerMemory& memory, Handler&& handler) {
+    return {memory, std::forward<Handler>(handler)};
+}
+
+} // namespace handler_memory
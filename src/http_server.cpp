@@ -1,8 +1,14 @@
 #include "http_server.h"
+#include "api_router.h"
 #include "logger.h"
 
 #include <boost/asio/dispatch.hpp>
+#include <boost/asio/redirect_error.hpp>
 
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <charconv>
 #include <iostream>
 
 namespace http_server {
@@ -14,54 +20,535 @@ void ReportError(beast::error_code ec, std::string_view what) {
     std::cerr << what << ": "sv << ec.message() << std::endl;
 }
 
-void SessionBase::Run() {
+http::request<http::string_body> CopyToStringRequest(const HttpRequest& request) {
+    http::request<http::string_body> copy{request.method(), request.target(), request.version()};
+    for (const auto& field : request) {
+        copy.insert(field.name_string(), field.value());
+    }
+    copy.body().assign(request.body().data(), request.body().size());
+    return copy;
+}
+
+void RequestLimits::SetRouteLimit(std::string path, RequestLimit limit) {
+    max_header_ = std::max(max_header_, limit.max_header);
+    for (auto& [route_path, route_limit] : routes_) {
+        if (route_path == path) {
+            route_limit = limit;
+            return;
+        }
+    }
+    routes_.emplace_back(std::move(path), limit);
+}
+
+const RequestLimit& RequestLimits::Find(std::string_view target) const {
+    std::string_view path = target.substr(0, target.find('?'));
+    for (const auto& [route_path, route_limit] : routes_) {
+        if (route_path == path) {
+            return route_limit;
+        }
+    }
+    return default_limit_;
+}
+
+bool ParseRouteLimit(std::string_view spec, RequestLimits& limits) {
+    auto read_number = [](std::string_view text, auto& value) {
+        auto [end, ec] = std::from_chars(text.data(), text.data() + text.size(), value);
+        return ec == std::errc{} && end == text.data() + text.size();
+    };
+
+    auto eq = spec.rfind('=');
+    if (eq == std::string_view::npos || spec.front() != '/') {
+        return false;
+    }
+
+    std::string_view path = spec.substr(0, eq);
+    RequestLimit limit = limits.Find(path);
+    std::string_view sizes = spec.substr(eq + 1);
+    auto colon = sizes.find(':');
+    if (!read_number(sizes.substr(0, colon), limit.max_body)) {
+        return false;
+    }
+    if (colon != std::string_view::npos && !read_number(sizes.substr(colon + 1), limit.max_header)) {
+        return false;
+    }
+    limits.SetRouteLimit(std::string{path}, limit);
+    return true;
+}
+
+bool IsEventStreamRequest(const HttpRequest& request) {
+    if (request.method() != http::verb::get
+        || request[http::field::accept].find("text/event-stream"sv) == std::string_view::npos) {
+        return false;
+    }
+    // браузеры шлют такой Accept и на другие адреса, им нужен обычный ответ
+    auto match = api_router::API_ROUTER.Match(api_router::SplitTarget(request.target()).first);
+    return match && (match->route == api_router::Route::state_stream || match->route == api_router::Route::spectate);
+}
+
+http::response<http::empty_body> MakeEventStreamHeader(unsigned http_version) {
+    http::response<http::empty_body> header{http::status::ok, http_version};
+    header.set(http::field::content_type, "text/event-stream"sv);
+    header.set(http::field::cache_control, "no-cache"sv);
+    header.keep_alive(false);
+    return header;
+}
+
+bool IsClientDisconnect(beast::error_code ec) {
+    return ec == net::error::broken_pipe || ec == net::error::connection_reset || ec == beast::error::timeout;
+}
+
+void SetReusePort(tcp::acceptor& acceptor) {
+#ifdef SO_REUSEPORT
+    using reuse_port = net::detail::socket_option::boolean<SOL_SOCKET, SO_REUSEPORT>;
+    acceptor.set_option(reuse_port(true));
+#else
+    throw std::runtime_error("SO_REUSEPORT is not supported on this platform"s);
+#endif
+}
+
+void SetReusePort(unix_socket::acceptor& /*acceptor*/) {
+    // ядро не распределяет соединения Unix-сокета между несколькими акцепторами
+    throw std::runtime_error("SO_REUSEPORT is not supported for Unix domain sockets"s);
+}
+
+namespace {
+
+std::string_view Trim(std::string_view text) {
+    auto begin = text.find_first_not_of(" \t"sv);
+    if (begin == std::string_view::npos) {
+        return {};
+    }
+    return text.substr(begin, text.find_last_not_of(" \t"sv) - begin + 1);
+}
+
+// последний элемент списка через запятую - его добавил ближайший к серверу прокси
+std::string_view LastListElement(std::string_view list) {
+    auto comma = list.rfind(',');
+    return Trim(comma == std::string_view::npos ? list : list.substr(comma + 1));
+}
+
+bool IEquals(std::string_view a, std::string_view b) {
+    return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin(), [](char x, char y) {
+        return std::tolower(static_cast<unsigned char>(x)) == std::tolower(static_cast<unsigned char>(y));
+    });
+}
+
+// for=192.0.2.60, for="198.51.100.17:4711", for="[2001:db8::1]:4711"
+std::string_view ParseForwardedNode(std::string_view node) {
+    if (node.size() >= 2 && node.front() == '"' && node.back() == '"') {
+        node = node.substr(1, node.size() - 2);
+    }
+    if (node.starts_with('[')) {
+        auto bracket = node.find(']');
+        return bracket == std::string_view::npos ? std::string_view{} : node.substr(1, bracket - 1);
+    }
+    // порт есть только у IPv4 (IPv6 без скобок в заголовке не бывает)
+    if (auto colon = node.find(':'); colon != std::string_view::npos && node.find(':', colon + 1) == std::string_view::npos) {
+        return node.substr(0, colon);
+    }
+    return node;
+}
+
+} // namespace
+
+std::string_view ParseForwardedFor(std::string_view forwarded, std::string_view x_forwarded_for) {
+    if (!forwarded.empty()) {
+        std::string_view element = LastListElement(forwarded);
+        while (!element.empty()) {
+            auto semicolon = element.find(';');
+            std::string_view pair = Trim(element.substr(0, semicolon));
+            if (auto eq = pair.find('='); eq != std::string_view::npos && IEquals(Trim(pair.substr(0, eq)), "for"sv)) {
+                // "unknown" и скрытые идентификаторы ("_hidden") адресом не являются
+                std::string_view node = ParseForwardedNode(Trim(pair.substr(eq + 1)));
+                if (!node.empty() && node != "unknown"sv && !node.starts_with('_')) {
+                    return node;
+                }
+                break;
+            }
+            element = semicolon == std::string_view::npos ? std::string_view{} : element.substr(semicolon + 1);
+        }
+    }
+    return LastListElement(x_forwarded_for);
+}
+
+std::string EndpointToString(const tcp::endpoint& endpoint) {
+    return endpoint.address().to_string();
+}
+
+std::string EndpointToString(const unix_socket::endpoint& endpoint) {
+    // клиенты Unix-сокета обычно не привязаны к пути
+    auto path = endpoint.path();
+    return path.empty() ? "unix"s : "unix:"s + path;
+}
+
+namespace {
+
+std::atomic<std::uint64_t> closed_session_requests = 0;
+std::atomic<std::uint64_t> recycled_handler_allocations = 0;
+std::atomic<std::uint64_t> heap_handler_allocations = 0;
+
+} // namespace
+
+HandlerAllocationStats GetHandlerAllocationStats() {
+    return {closed_session_requests.load(), {recycled_handler_allocations.load(), heap_handler_allocations.load()}};
+}
+
+void AddClosedSessionStats(std::uint64_t requests, const handler_memory::HandlerMemory::Stats& memory) {
+    closed_session_requests += requests;
+    recycled_handler_allocations += memory.recycled;
+    heap_handler_allocations += memory.heap;
+}
+
+http::response<http::string_body> MakeRejectResponse(http::status status, std::string_view code,
+                                                     std::string_view message, unsigned http_version) {
+    http::response<http::string_body> response{status, http_version};
+    response.set(http::field::content_type, "application/json"sv);
+    response.body().append(R"({"code":")"sv).append(code).append(R"(","message":")"sv).append(message).append(R"("})"sv);
+    response.content_length(response.body().size());
+    response.keep_alive(false);
+    return response;
+}
+
+template <typename Protocol>
+SessionBase<Protocol>::~SessionBase() {
+    AddClosedSessionStats(requests_, handler_memory_.GetStats());
+}
+
+template <typename Protocol>
+void SessionBase<Protocol>::Run() {
     net::dispatch(
         stream_.get_executor(),
-        beast::bind_front_handler(&SessionBase::Read, GetSharedThis()));
+        handler_memory::MakeAllocHandler(handler_memory_,
+                                         beast::bind_front_handler(&SessionBase::Read, GetSharedThis())));
 }
 
-void SessionBase::Read() {
-    request_ = {};
-    stream_.expires_after(30s);
-    http::async_read(stream_, buffer_, request_,
-                     beast::bind_front_handler(&SessionBase::OnRead, GetSharedThis()));
-    
+template <typename Protocol>
+void SessionBase<Protocol>::Read() {
+    if (reading_ != nullptr || read_stopped_ || in_flight_ == MAX_IN_FLIGHT) {
+        return;
+    }
+
+    // слоты создаются при первой нужде и потом переиспользуются
+    auto& slot = exchanges_[(head_ + in_flight_) % MAX_IN_FLIGHT];
+    if (!slot) {
+        slot = std::make_unique<Exchange>();
+    }
+    // пока есть запросы в обработке, соединение не простаивает, даже если ответ ждёт тика (long-poll);
+    // таймаут простоя появится, когда на них уйдут ответы (OnWrite)
+    if (in_flight_ == 0) {
+        // чем больше соединений, тем меньше простаивающее соединение держит место и буферы
+        stream_.expires_after(connection_.GetIdleTimeout());
+    } else {
+        stream_.expires_never();
+    }
+    ++in_flight_;
+    reading_ = slot.get();
+
+    reading_->parser.emplace(std::piecewise_construct, std::make_tuple(reading_->arena.GetAllocator()),
+                             std::make_tuple(reading_->arena.GetAllocator()));
+    reading_->parser->header_limit(limits_->GetMaxHeader());
+
+    http::async_read_header(stream_, buffer_, *reading_->parser,
+                            handler_memory::MakeAllocHandler(handler_memory_,
+                                beast::bind_front_handler(&SessionBase::OnReadHeader, GetSharedThis())));
 }
 
-void SessionBase::OnRead(beast::error_code ec, [[maybe_unused]] std::size_t bytes_read) {
+template <typename Protocol>
+void SessionBase<Protocol>::OnReadHeader(beast::error_code ec, std::size_t bytes_read) {
+    if (std::exchange(restart_read_, false)) {
+        stream_.expires_after(connection_.GetIdleTimeout());
+        if (ec == net::error::operation_aborted) {
+            return ResumeRead();
+        }
+    }
+
     if (ec == http::error::end_of_stream) {
-        return Close();
+        StopReading();
+        // ответы на уже прочитанные запросы ещё уйдут, соединение закроется после них
+        if (in_flight_ == 0) {
+            Close();
+        }
+        return;
+    }
+
+    if (ec == http::error::header_limit) {
+        return Reject(http::status::request_header_fields_too_large, "headerTooLarge"sv, "Request header is too large"sv);
     }
 
     if (ec) {
+        StopReading();
         return ReportError(ec, "read"sv);
     }
 
-    HandlerRequest(std::move(request_));
+    auto& parser = *reading_->parser;
+    const RequestLimit& limit = limits_->Find(parser.get().target());
+    if (bytes_read > limit.max_header) {
+        return Reject(http::status::request_header_fields_too_large, "headerTooLarge"sv, "Request header is too large"sv);
+    }
+    if (auto length = parser.content_length(); length && *length > limit.max_body) {
+        return Reject(http::status::payload_too_large, "payloadTooLarge"sv, "Request body is too large"sv);
+    }
+
+    // тело без Content-Length (chunked) обрывается парсером на лимите
+    parser.body_limit(limit.max_body);
+    http::async_read(stream_, buffer_, parser,
+                     handler_memory::MakeAllocHandler(handler_memory_,
+                                                      beast::bind_front_handler(&SessionBase::OnRead, GetSharedThis())));
 }
 
-void SessionBase::Close() {
+template <typename Protocol>
+void SessionBase<Protocol>::OnRead(beast::error_code ec, [[maybe_unused]] std::size_t bytes_read) {
+    if (std::exchange(restart_read_, false)) {
+        stream_.expires_after(connection_.GetIdleTimeout());
+        if (ec == net::error::operation_aborted) {
+            return ResumeRead();
+        }
+    }
+
+    if (ec == http::error::end_of_stream) {
+        StopReading();
+        if (in_flight_ == 0) {
+            Close();
+        }
+        return;
+    }
+
+    if (ec == http::error::body_limit) {
+        return Reject(http::status::payload_too_large, "payloadTooLarge"sv, "Request body is too large"sv);
+    }
+
+    if (ec) {
+        StopReading();
+        return ReportError(ec, "read"sv);
+    }
+
+    ++requests_;
+    Exchange& exchange = *std::exchange(reading_, nullptr);
+    HttpRequest& request = exchange.parser->get();
+    if (websocket::is_upgrade(request) || IsEventStreamRequest(request)) {
+        // соединение уходит обработчику, а арена остаётся в сессии
+        pending_upgrade_ = CopyToStringRequest(request);
+        exchange.parser.reset();
+        exchange.arena.Reset();
+        --in_flight_;
+        read_stopped_ = true;
+        if (in_flight_ == 0) {
+            HandlerUpgrade(std::move(*pending_upgrade_));
+        }
+        return;
+    }
+
+    // после Connection: close клиент не ждёт ответов на следующие запросы, при остановке сервера их не будет
+    read_stopped_ = !request.keep_alive() || connection_.IsDraining();
+    connection_.BeginRequest();
+    HandlerRequest(request, ResponseSender{GetSharedThis(), &exchange});
+    Read();
+}
+
+template <typename Protocol>
+void SessionBase<Protocol>::ResumeRead() {
+    auto& parser = *reading_->parser;
+    if (connection_.IsDraining() && !parser.got_some()) {
+        StopReading();
+        return Close();
+    }
+
+    // прочитанное уже в buffer_ и в парсере, чтение продолжается с того же места
+    if (!parser.is_header_done()) {
+        http::async_read_header(stream_, buffer_, parser,
+                                handler_memory::MakeAllocHandler(handler_memory_,
+                                    beast::bind_front_handler(&SessionBase::OnReadHeader, GetSharedThis())));
+        return;
+    }
+    http::async_read(stream_, buffer_, parser,
+                     handler_memory::MakeAllocHandler(handler_memory_,
+                                                      beast::bind_front_handler(&SessionBase::OnRead, GetSharedThis())));
+}
+
+template <typename Protocol>
+void SessionBase<Protocol>::StopReading() {
+    read_stopped_ = true;
+    if (reading_ != nullptr) {
+        reading_->parser.reset();
+        reading_->arena.Reset();
+        reading_ = nullptr;
+        --in_flight_;
+    }
+}
+
+template <typename Protocol>
+void SessionBase<Protocol>::Reject(http::status status, std::string_view code, std::string_view message) {
+    Exchange& exchange = *std::exchange(reading_, nullptr);
+    read_stopped_ = true;
+    connection_.BeginRequest();
+
+    SetResponse(exchange, MakeRejectResponse(status, code, message, exchange.parser->get().version()));
+    WriteNext();
+}
+
+template <typename Protocol>
+void SessionBase<Protocol>::SetResponse(Exchange& exchange, StringResponse&& response) {
+    exchange.response = std::move(response);
+    exchange.ready = true;
+}
+
+template <typename Protocol>
+void SessionBase<Protocol>::WriteNext() {
+    if (writing_ || in_flight_ == 0) {
+        return;
+    }
+    Exchange& exchange = *exchanges_[head_];
+    if (!exchange.ready) {
+        return;
+    }
+
+    writing_ = true;
+    if (exchange.write_other) {
+        return exchange.write_other();
+    }
+    stream_.expires_after(WRITE_TIMEOUT);
+    http::async_write(stream_, exchange.response, handler_memory::MakeAllocHandler(handler_memory_,
+                      [self = GetSharedThis(), &exchange](beast::error_code ec, std::size_t bytes_written) {
+        self->OnWrite(exchange.response.need_eof(), ec, bytes_written);
+    }));
+}
+
+template <typename Protocol>
+typename SessionBase<Protocol>::StringResponse SessionBase<Protocol>::TakeResponse(Exchange& exchange) {
+    StringResponse response;
+    response.body() = std::move(exchange.response.body());
+    response.body().clear();
+    return response;
+}
+
+template <typename Protocol>
+void SessionBase<Protocol>::Close() {
     stream_.socket().shutdown(tcp::socket::shutdown_send);
 }
 
-void SessionBase::OnWrite(bool close, beast::error_code ec, [[maybe_unused]] std::size_t bytes_written) {
+template <typename Protocol>
+void SessionBase<Protocol>::OnWrite(bool close, beast::error_code ec, [[maybe_unused]] std::size_t bytes_written) {
+    // ответ записан, запрос и его память больше не нужны
+    Exchange& exchange = *exchanges_[head_];
+    exchange.parser.reset();
+    exchange.arena.Reset();
+    exchange.write_other = nullptr;
+    exchange.ready = false;
+    head_ = (head_ + 1) % MAX_IN_FLIGHT;
+    --in_flight_;
+    writing_ = false;
+    connection_.EndRequest();
+
     if (ec) {
+        StopReading();
         return ReportError(ec, "write"sv);
     }
 
     if (close) {
+        StopReading();
         return Close();
     }
 
+    if (in_flight_ == 0 && read_stopped_) {
+        if (pending_upgrade_) {
+            return HandlerUpgrade(std::move(*pending_upgrade_));
+        }
+        return Close();
+    }
+
+    // следующий запрос читался без таймаута, пока обрабатывались предыдущие; когда они все отвечены,
+    // чтение прерывается и продолжается с таймаутом простоя, отсчитанным от последнего ответа
+    if (in_flight_ == 1 && reading_ != nullptr) {
+        restart_read_ = true;
+        stream_.cancel();
+        return;
+    }
+
+    WriteNext();
     Read();
 }
 
-net::ip::tcp::endpoint SessionBase::GetRemoteEndpoint() const {
+template <typename Protocol>
+typename Protocol::endpoint SessionBase<Protocol>::GetRemoteEndpoint() const {
     return stream_.socket().remote_endpoint();
 }
 
-net::ip::tcp::endpoint SessionBase::GetLocalEndpoint() const {
+template <typename Protocol>
+typename Protocol::endpoint SessionBase<Protocol>::GetLocalEndpoint() const {
     return stream_.socket().local_endpoint();
 }
 
+namespace {
+
+template <typename Stream>
+net::awaitable<bool> CoReject(Stream& stream, http::status status, std::string_view code,
+                              std::string_view message, unsigned http_version) {
+    auto response = MakeRejectResponse(status, code, message, http_version);
+    beast::error_code ec;
+    stream.expires_after(WRITE_TIMEOUT);
+    co_await http::async_write(stream, response, net::redirect_error(net::use_awaitable, ec));
+    if (ec) {
+        ReportError(ec, "write"sv);
+    } else {
+        stream.socket().shutdown(tcp::socket::shutdown_send, ec);
+    }
+    co_return false;
+}
+
+} // namespace
+
+template <typename Stream>
+net::awaitable<bool> CoReadRequest(Stream& stream, beast::flat_buffer& buffer, RequestParser& parser,
+                                   const RequestLimits& limits, std::chrono::milliseconds idle_timeout) {
+    beast::error_code ec;
+    parser.header_limit(limits.GetMaxHeader());
+    stream.expires_after(idle_timeout);
+    std::size_t bytes_read = co_await http::async_read_header(stream, buffer, parser,
+                                                              net::redirect_error(net::use_awaitable, ec));
+    if (ec == http::error::end_of_stream) {
+        stream.socket().shutdown(tcp::socket::shutdown_send, ec);
+        co_return false;
+    }
+    if (ec == http::error::header_limit) {
+        co_return co_await CoReject(stream, http::status::request_header_fields_too_large, "headerTooLarge"sv,
+                                    "Request header is too large"sv, parser.get().version());
+    }
+    if (ec) {
+        ReportError(ec, "read"sv);
+        co_return false;
+    }
+
+    const RequestLimit& limit = limits.Find(parser.get().target());
+    if (bytes_read > limit.max_header) {
+        co_return co_await CoReject(stream, http::status::request_header_fields_too_large, "headerTooLarge"sv,
+                                    "Request header is too large"sv, parser.get().version());
+    }
+    if (auto length = parser.content_length(); length && *length > limit.max_body) {
+        co_return co_await CoReject(stream, http::status::payload_too_large, "payloadTooLarge"sv,
+                                    "Request body is too large"sv, parser.get().version());
+    }
+
+    parser.body_limit(limit.max_body);
+    co_await http::async_read(stream, buffer, parser, net::redirect_error(net::use_awaitable, ec));
+    if (ec == http::error::body_limit) {
+        co_return co_await CoReject(stream, http::status::payload_too_large, "payloadTooLarge"sv,
+                                    "Request body is too large"sv, parser.get().version());
+    }
+    if (ec) {
+        if (ec != http::error::end_of_stream) {
+            ReportError(ec, "read"sv);
+        }
+        co_return false;
+    }
+    co_return true;
+}
+
+template class SessionBase<tcp>;
+template class SessionBase<unix_socket>;
+
+template net::awaitable<bool> CoReadRequest(beast::basic_stream<tcp>&, beast::flat_buffer&, RequestParser&,
+                                            const RequestLimits&, std::chrono::milliseconds);
+template net::awaitable<bool> CoReadRequest(beast::basic_stream<unix_socket>&, beast::flat_buffer&, RequestParser&,
+                                            const RequestLimits&, std::chrono::milliseconds);
+
 }  // namespace http_server
@@ -1,143 +1,646 @@
 #pragma once
 #include "sdk.h"
+#include "connection_manager.h"
+#include "handler_memory.h"
 #include "logger.h"
 
+#include <boost/asio/awaitable.hpp>
+#include <boost/asio/co_spawn.hpp>
+#include <boost/asio/detached.hpp>
+#include <boost/asio/dispatch.hpp>
+#include <boost/asio/use_awaitable.hpp>
 #include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/local/stream_protocol.hpp>
+#include <boost/asio/steady_timer.hpp>
 #include <boost/asio/strand.hpp>
 #include <boost/asio/write.hpp>
 #include <boost/beast/core.hpp>
 #include <boost/beast/http.hpp>
+#include <boost/beast/websocket/rfc6455.hpp>
 
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <functional>
 #include <memory>
+#include <memory_resource>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
 
 namespace http_server {
 
 namespace net = boost::asio;
 using tcp = net::ip::tcp;
+using unix_socket = net::local::stream_protocol;
 namespace beast = boost::beast;
 namespace http = beast::http;
+namespace websocket = beast::websocket;
 namespace sys = boost::system;
+using connection_manager::ConnectionManager;
+using Connection = ConnectionManager::Connection;
 
 void ReportError(beast::error_code ec, std::string_view what);
 
+// клиент, который не принимает ответ дольше этого времени, отключается; таймаут простоя ограничивает
+// только ожидание запроса, пока соединению нечего отвечать
+constexpr std::chrono::seconds WRITE_TIMEOUT{30};
+
+// бэкенд ввода-вывода Asio выбирается при сборке (GAME_SERVER_IO_URING в CMake)
+#if defined(BOOST_ASIO_HAS_IO_URING_AS_DEFAULT)
+constexpr std::string_view IO_BACKEND = "io_uring";
+#elif defined(BOOST_ASIO_HAS_EPOLL)
+constexpr std::string_view IO_BACKEND = "epoll";
+#else
+constexpr std::string_view IO_BACKEND = "select";
+#endif
+
+/*
+ * Память запроса соединения: заголовки и тело размещаются подряд в одном буфере
+ * и освобождаются разом перед чтением следующего запроса.
+ */
+class RequestArena {
+public:
+    constexpr static size_t INITIAL_SIZE = 4096;
+
+    using Allocator = std::pmr::polymorphic_allocator<char>;
+
+    RequestArena()
+        : resource_(buffer_.data(), buffer_.size()) {
+    }
+
+    RequestArena(const RequestArena&) = delete;
+    RequestArena& operator=(const RequestArena&) = delete;
+
+    Allocator GetAllocator() noexcept {
+        return &resource_;
+    }
+
+    // всё, что выделено из арены, после этого недействительно
+    void Reset() noexcept {
+        resource_.release();
+    }
+
+private:
+    std::array<std::byte, INITIAL_SIZE> buffer_;
+    std::pmr::monotonic_buffer_resource resource_;
+};
+
+using ArenaBody = http::basic_string_body<char, std::char_traits<char>, RequestArena::Allocator>;
+using HttpRequest = http::request<ArenaBody, http::basic_fields<RequestArena::Allocator>>;
+
+// копия запроса с обычным аллокатором для обработчиков, которые живут дольше сессии
+http::request<http::string_body> CopyToStringRequest(const HttpRequest& request);
+
+struct RequestLimit {
+    std::uint64_t max_body = 1024 * 1024;
+    std::uint32_t max_header = 8 * 1024;
+};
+
+/*
+ * Лимиты размера запроса по пути (без query). Заголовок читается с наибольшим лимитом из всех,
+ * потом проверяется лимитом пути; тело, заявленное больше лимита, отклоняется не читаясь.
+ */
+class RequestLimits {
+public:
+    explicit RequestLimits(RequestLimit default_limit = {})
+        : default_limit_(default_limit)
+        , max_header_(default_limit.max_header) {
+    }
+
+    void SetRouteLimit(std::string path, RequestLimit limit);
+
+    const RequestLimit& Find(std::string_view target) const;
+
+    std::uint32_t GetMaxHeader() const noexcept {
+        return max_header_;
+    }
+
+private:
+    RequestLimit default_limit_;
+    std::uint32_t max_header_;
+    // путей с отдельными лимитами немного, линейный поиск быстрее хеширования
+    std::vector<std::pair<std::string, RequestLimit>> routes_;
+};
+
+// "<путь>=<тело>[:<заголовок>]" в байтах; не указанный лимит заголовка берётся из текущего для пути
+bool ParseRouteLimit(std::string_view spec, RequestLimits& limits);
+
+// text/event-stream ответ не укладывается в запрос-ответ, соединение передаётся обработчику как при апгрейде;
+// только для маршрутов потока состояния и зрителей
+bool IsEventStreamRequest(const HttpRequest& request);
+// заголовок ответа text/event-stream, тело которого заканчивается закрытием соединения
+http::response<http::empty_body> MakeEventStreamHeader(unsigned http_version);
+// обрыв соединения клиентом или истёкший таймаут записи, в лог не пишется
+bool IsClientDisconnect(beast::error_code ec);
+
+// бросает исключение, если платформа не поддерживает SO_REUSEPORT
+void SetReusePort(tcp::acceptor& acceptor);
+void SetReusePort(unix_socket::acceptor& acceptor);
+
+// адрес клиента из последнего элемента Forwarded (RFC 7239) или X-Forwarded-For; пусто, если его нет
+std::string_view ParseForwardedFor(std::string_view forwarded, std::string_view x_forwarded_for);
+
+std::string EndpointToString(const tcp::endpoint& endpoint);
+std::string EndpointToString(const unix_socket::endpoint& endpoint);
+
+// за доверенным прокси адрес клиента берётся из заголовков, которые добавил прокси
+template <typename Fields, typename Endpoint>
+std::string GetClientIp(const Fields& fields, const Endpoint& remote, bool trust_forwarded) {
+    using namespace std::literals;
+    if (trust_forwarded) {
+        auto forwarded = ParseForwardedFor(fields[http::field::forwarded], fields["X-Forwarded-For"sv]);
+        if (!forwarded.empty()) {
+            return std::string{forwarded};
+        }
+    }
+    return EndpointToString(remote);
+}
+
+// сколько запросов обработано закрытыми соединениями и сколько раз их операции брали память из блоков и из кучи
+struct HandlerAllocationStats {
+    std::uint64_t requests = 0;
+    handler_memory::HandlerMemory::Stats memory;
+};
+
+HandlerAllocationStats GetHandlerAllocationStats();
+void AddClosedSessionStats(std::uint64_t requests, const handler_memory::HandlerMemory::Stats& memory);
+
+// ответ на запрос, который не будет дочитан; после него соединение закрывается
+http::response<http::string_body> MakeRejectResponse(http::status status, std::string_view code,
+                                                     std::string_view message, unsigned http_version);
+
+/*
+ * Сессия HTTP/1.1 с конвейерной обработкой: следующий запрос читается, пока предыдущие
+ * обрабатываются, но в работе одновременно не больше MAX_IN_FLIGHT запросов. Ответы пишутся
+ * строго в порядке запросов, даже если обработчики ответили в другом порядке.
+ * Реализована для TCP и Unix-сокетов (явные инстанцирования в http_server.cpp).
+ */
+template <typename Protocol>
 class SessionBase {
+    // запрос и ответ на него; живёт от начала чтения запроса до конца записи ответа
+    struct Exchange {
+        RequestArena arena;
+        std::optional<http::request_parser<ArenaBody, RequestArena::Allocator>> parser;
+        // строковый ответ; тело сохраняет ёмкость для следующего запроса в этом слоте
+        http::response<http::string_body> response;
+        // запись ответа с другим типом тела
+        std::function<void()> write_other;
+        bool ready = false;
+    };
+
 public:
+    using Stream = beast::basic_stream<Protocol>;
+    using StringResponse = http::response<http::string_body>;
+
+    constexpr static size_t MAX_IN_FLIGHT = 8;
+
     SessionBase(const SessionBase&) = delete;
     SessionBase& operator=(const SessionBase&) = delete;
 
     void Run();
 
+    /*
+     * Отправляет ответ обработчика в соединение. Пока send жив, жива и сессия,
+     * поэтому запрос, переданный обработчику по ссылке, остаётся действительным до отправки ответа.
+     */
+    class ResponseSender {
+    public:
+        ResponseSender(std::shared_ptr<SessionBase> session, Exchange* exchange)
+            : session_(std::move(session))
+            , exchange_(exchange) {
+        }
+
+        template <typename Response>
+        void operator()(Response&& response) const {
+            session_->SendResponse(exchange_, std::move(response));
+        }
+
+        // ответ, тело которого сохранило ёмкость после предыдущего запроса соединения
+        StringResponse TakeResponse() const {
+            return session_->TakeResponse(*exchange_);
+        }
+
+    private:
+        std::shared_ptr<SessionBase> session_;
+        Exchange* exchange_;
+    };
+
 protected:
-    using HttpRequest = http::request<http::string_body>;
+    SessionBase(typename Protocol::socket&& socket, std::shared_ptr<const RequestLimits> limits,
+                Connection&& connection)
+        : stream_(std::move(socket))
+        , limits_(std::move(limits))
+        , connection_(std::move(connection)) {
+    }
 
-    explicit SessionBase(tcp::socket&& socket)
-        : stream_(std::move(socket)) {
+    ~SessionBase();
+
+    // ответ может прийти из другого контекста (со strand игры), запись всегда начинается на executor соединения
+    template <typename Body, typename Fields>
+    void SendResponse(Exchange* exchange, http::response<Body, Fields>&& response) {
+        net::dispatch(stream_.get_executor(), handler_memory::MakeAllocHandler(handler_memory_,
+            [self = GetSharedThis(), exchange, response = std::move(response)]() mutable {
+                self->SetResponse(*exchange, std::move(response));
+                self->WriteNext();
+            }));
     }
 
-    ~SessionBase() = default;
+    // строковые ответы пишутся из слота запроса, остальные - из отдельной копии
+    void SetResponse(Exchange& exchange, StringResponse&& response);
 
     template<typename Body, typename Fields>
-    void Write(http::response<Body, Fields>&& response) {
+    void SetResponse(Exchange& exchange, http::response<Body, Fields>&& response) {
         auto safe_response = std::make_shared<http::response<Body, Fields>>(std::move(response));
-        auto self = GetSharedThis();
-        http::async_write(stream_, *safe_response,
-                          [safe_response, self](beast::error_code ec, std::size_t bytes_written) {
-            self->OnWrite(safe_response->need_eof(), ec, bytes_written);
-        });
+        exchange.write_other = [safe_response, self = GetSharedThis()] {
+            self->stream_.expires_after(WRITE_TIMEOUT);
+            http::async_write(self->stream_, *safe_response, handler_memory::MakeAllocHandler(self->handler_memory_,
+                              [safe_response, self](beast::error_code ec, std::size_t bytes_written) {
+                self->OnWrite(safe_response->need_eof(), ec, bytes_written);
+            }));
+        };
+        exchange.ready = true;
     }
 
-    net::ip::tcp::endpoint GetRemoteEndpoint() const;
-    net::ip::tcp::endpoint GetLocalEndpoint() const;
+    StringResponse TakeResponse(Exchange& exchange);
+
+    typename Protocol::endpoint GetRemoteEndpoint() const;
+    typename Protocol::endpoint GetLocalEndpoint() const;
+
+    // после апгрейда соединение принадлежит обработчику, сессия больше не читает из него
+    Stream ReleaseStream() {
+        return std::move(stream_);
+    }
+
+    // место соединения переходит к обработчику вместе с ним и остаётся занятым, пока оно открыто
+    Connection ReleaseConnection() {
+        return std::move(connection_);
+    }
 
 
 private:
-    beast::tcp_stream stream_;
+    Stream stream_;
     beast::flat_buffer buffer_;
-    HttpRequest request_;
+    std::shared_ptr<const RequestLimits> limits_;
+    Connection connection_;
+    handler_memory::HandlerMemory handler_memory_;
+    std::uint64_t requests_ = 0;
+
+    // кольцо слотов: [head_, head_ + in_flight_) ждут ответа, последний из них может ещё читаться
+    std::array<std::unique_ptr<Exchange>, MAX_IN_FLIGHT> exchanges_;
+    size_t head_ = 0;
+    size_t in_flight_ = 0;
+    Exchange* reading_ = nullptr;
+    bool writing_ = false;
+    // ожидание запроса отменено, чтобы продолжить его с таймаутом простоя
+    bool restart_read_ = false;
+    // новых запросов не будет: ошибка чтения, Connection: close или апгрейд
+    bool read_stopped_ = false;
+    // апгрейд ждёт, пока уйдут ответы на запросы перед ним
+    std::optional<http::request<http::string_body>> pending_upgrade_;
 
     void Read();
+    void OnReadHeader(beast::error_code ec, std::size_t bytes_read);
     void OnRead(beast::error_code ec, [[maybe_unused]] std::size_t bytes_read);
+    // продолжает отменённое чтение запроса с того места, где оно остановилось
+    void ResumeRead();
+    // читаемый запрос отбрасывается, новых запросов не будет
+    void StopReading();
+    // ответ на запрос, который не будет дочитан; соединение закрывается после отправки
+    void Reject(http::status status, std::string_view code, std::string_view message);
+    void WriteNext();
     void Close();
     void OnWrite(bool close, beast::error_code ec, [[maybe_unused]] std::size_t bytes_written);
 
-    virtual void HandlerRequest(HttpRequest&& request) = 0;
+    virtual void HandlerRequest(HttpRequest& request, ResponseSender&& send) = 0;
+    virtual void HandlerUpgrade(http::request<http::string_body>&& request) = 0;
 
     virtual std::shared_ptr<SessionBase> GetSharedThis() = 0;
 };
 
-template <typename RequestHandler>
-class Session : public SessionBase, public std::enable_shared_from_this<Session<RequestHandler>> {
+extern template class SessionBase<tcp>;
+extern template class SessionBase<unix_socket>;
+
+template <typename Protocol, typename RequestHandler>
+class Session : public SessionBase<Protocol>, public std::enable_shared_from_this<Session<Protocol, RequestHandler>> {
+    using Base = SessionBase<Protocol>;
+
 public:
     template <typename Handler>
-    Session(tcp::socket&& socket, Handler&& request_handler)
-        : SessionBase(std::move(socket))
+    Session(typename Protocol::socket&& socket, std::shared_ptr<const RequestLimits> limits, Connection&& connection,
+            bool trust_forwarded, Handler&& request_handler)
+        : Base(std::move(socket), std::move(limits), std::move(connection))
+        , trust_forwarded_(trust_forwarded)
         , request_handler_(std::forward<Handler>(request_handler)) {
     }
 
 private:
+    bool trust_forwarded_;
     RequestHandler request_handler_;
 
-    void HandlerRequest(HttpRequest&& request) override {
-        request_handler_(std::move(request), GetRemoteEndpoint().address().to_string(),
-                         [self = this->shared_from_this()](auto&& response) {
-            self->Write(std::move(response));
-        });
+    void HandlerRequest(HttpRequest& request, typename Base::ResponseSender&& send) override {
+        request_handler_(request, GetClientIp(request, this->GetRemoteEndpoint(), trust_forwarded_), std::move(send));
+    }
+
+    void HandlerUpgrade(http::request<http::string_body>&& request) override {
+        std::string client_ip = GetClientIp(request, this->GetRemoteEndpoint(), trust_forwarded_);
+        request_handler_.Upgrade(std::move(request), client_ip, this->ReleaseStream(), this->ReleaseConnection());
     }
 
-    std::shared_ptr<SessionBase> GetSharedThis() override {
+    std::shared_ptr<Base> GetSharedThis() override {
         return this->shared_from_this();
     }
 };
 
-template <typename RequestHandler>
-class Listener : public std::enable_shared_from_this<Listener<RequestHandler>> {
+using RequestParser = http::request_parser<ArenaBody, RequestArena::Allocator>;
+
+// читает запрос, проверяя лимиты, и сам отвечает отказом на слишком большой; false - читать больше нечего
+template <typename Stream>
+net::awaitable<bool> CoReadRequest(Stream& stream, beast::flat_buffer& buffer, RequestParser& parser,
+                                   const RequestLimits& limits, std::chrono::milliseconds idle_timeout);
+
+extern template net::awaitable<bool> CoReadRequest(beast::basic_stream<tcp>&, beast::flat_buffer&, RequestParser&,
+                                                   const RequestLimits&, std::chrono::milliseconds);
+extern template net::awaitable<bool> CoReadRequest(beast::basic_stream<unix_socket>&, beast::flat_buffer&,
+                                                   RequestParser&, const RequestLimits&, std::chrono::milliseconds);
+
+// ответ обработчика для сессии-сопрограммы; хранится в сессии между запросами
+template <typename Stream>
+struct CoroResponse {
+    http::response<http::string_body> response;
+    // запись ответа с другим типом тела, возвращает need_eof
+    std::function<net::awaitable<bool>(Stream&)> write_other;
+};
+
+/*
+ * send для сессии-сопрограммы: кладёт ответ в сессию и продолжает сопрограмму на executor соединения,
+ * даже если ответ пришёл со strand игры. Копируется, как и обычный send, вызывается один раз.
+ */
+template <typename Stream, typename Completion>
+class CoroResponseSender {
+public:
+    CoroResponseSender(CoroResponse<Stream>& slot, net::any_io_executor executor, Completion completion)
+        : slot_(&slot)
+        , executor_(std::move(executor))
+        , completion_(std::make_shared<std::optional<Completion>>(std::move(completion))) {
+    }
+
+    void operator()(http::response<http::string_body>& response) const {
+        slot_->response = std::move(response);
+        Resume();
+    }
+
+    void operator()(http::response<http::string_body>&& response) const {
+        slot_->response = std::move(response);
+        Resume();
+    }
+
+    template <typename Response>
+    void operator()(Response&& response) const {
+        auto safe_response = std::make_shared<std::decay_t<Response>>(std::move(response));
+        slot_->write_other = [safe_response](Stream& stream) -> net::awaitable<bool> {
+            co_await http::async_write(stream, *safe_response, net::use_awaitable);
+            co_return safe_response->need_eof();
+        };
+        Resume();
+    }
+
+    http::response<http::string_body> TakeResponse() const {
+        http::response<http::string_body> response;
+        response.body() = std::move(slot_->response.body());
+        response.body().clear();
+        return response;
+    }
+
+private:
+    CoroResponse<Stream>* slot_;
+    net::any_io_executor executor_;
+    std::shared_ptr<std::optional<Completion>> completion_;
+
+    void Resume() const {
+        auto completion = std::move(**completion_);
+        completion_->reset();
+        net::dispatch(executor_, std::move(completion));
+    }
+};
+
+/*
+ * Сессия на сопрограмме: чтение, передача обработчику (и на strand игры), ожидание ответа и запись
+ * идут последовательными co_await. Запросы не конвейеризуются.
+ */
+template <typename Protocol, typename RequestHandler>
+net::awaitable<void> RunCoroSession(typename Protocol::socket socket, std::shared_ptr<const RequestLimits> limits,
+                                    Connection connection, bool trust_forwarded, RequestHandler request_handler) {
+    using namespace std::literals;
+    using Stream = beast::basic_stream<Protocol>;
+
+    Stream stream{std::move(socket)};
+    beast::flat_buffer buffer;
+    RequestArena arena;
+    CoroResponse<Stream> slot;
+    std::uint64_t requests = 0;
+
+    beast::error_code ec;
+    auto remote = stream.socket().remote_endpoint(ec);
+
+    try {
+        for (;;) {
+            std::optional<RequestParser> parser;
+            arena.Reset();
+            parser.emplace(std::piecewise_construct, std::make_tuple(arena.GetAllocator()),
+                           std::make_tuple(arena.GetAllocator()));
+            if (!co_await CoReadRequest(stream, buffer, *parser, *limits, connection.GetIdleTimeout())) {
+                break;
+            }
+
+            ++requests;
+            HttpRequest& request = parser->get();
+            std::string client_ip = GetClientIp(request, remote, trust_forwarded);
+            if (websocket::is_upgrade(request) || IsEventStreamRequest(request)) {
+                request_handler.Upgrade(CopyToStringRequest(request), client_ip, std::move(stream),
+                                        std::move(connection));
+                break;
+            }
+
+            connection.BeginRequest();
+            co_await net::async_initiate<const net::use_awaitable_t<>, void()>([&](auto completion) {
+                using Sender = CoroResponseSender<Stream, decltype(completion)>;
+                request_handler(request, client_ip, Sender{slot, stream.get_executor(), std::move(completion)});
+            }, net::use_awaitable);
+
+            // таймаут простоя отсчитывался от начала чтения запроса, а обработчик мог отвечать дольше
+            stream.expires_after(WRITE_TIMEOUT);
+            bool close = false;
+            if (slot.write_other) {
+                close = co_await slot.write_other(stream);
+                slot.write_other = nullptr;
+            } else {
+                co_await http::async_write(stream, slot.response, net::use_awaitable);
+                close = slot.response.need_eof();
+            }
+            connection.EndRequest();
+            if (close || connection.IsDraining()) {
+                stream.socket().shutdown(tcp::socket::shutdown_send, ec);
+                break;
+            }
+        }
+    } catch (const sys::system_error& error) {
+        // клиент, закрывший соединение или не принимающий ответ, - не ошибка сервера
+        if (!IsClientDisconnect(error.code())) {
+            ReportError(error.code(), "write"sv);
+        }
+    }
+
+    AddClosedSessionStats(requests, {});
+}
+
+struct ListenerOptions {
+    // несколько акцепторов на одном порту (SO_REUSEPORT), соединения между ними распределяет ядро
+    bool reuse_port = false;
+    // io_context обслуживается одним потоком, соединениям не нужен strand
+    bool single_threaded = false;
+    // сессии на сопрограммах (RunCoroSession) вместо колбэков SessionBase
+    bool coroutine_sessions = false;
+    // общий для всех акцепторов сервера; если не задан, у акцептора свой с настройками по умолчанию
+    std::shared_ptr<ConnectionManager> connections;
+    // к акцептору подключается только свой обратный прокси, адрес клиента берётся из Forwarded/X-Forwarded-For
+    bool trust_forwarded = false;
+};
+
+// Protocol - tcp или unix_socket
+template <typename Protocol, typename RequestHandler>
+class Listener : public std::enable_shared_from_this<Listener<Protocol, RequestHandler>> {
 public:
     template <typename Handler>
-    Listener(net::io_context& io, const tcp::endpoint& endpoint, Handler&& handler)
+    Listener(net::io_context& io, const typename Protocol::endpoint& endpoint, std::shared_ptr<const RequestLimits> limits,
+             Handler&& handler, ListenerOptions options = {})
         : ioc_(io)
-        , acceptor_(net::make_strand(ioc_))
-        , request_handler_(std::forward<Handler>(handler)) {
+        , acceptor_(MakeExecutor(io, options))
+        , retry_timer_(acceptor_.get_executor())
+        , limits_(std::move(limits))
+        , request_handler_(std::forward<Handler>(handler))
+        , options_(std::move(options)) {
+        if (!options_.connections) {
+            options_.connections = std::make_shared<ConnectionManager>();
+        }
         acceptor_.open(endpoint.protocol());
         acceptor_.set_option(net::socket_base::reuse_address(true));
+        if (options_.reuse_port) {
+            SetReusePort(acceptor_);
+        }
         acceptor_.bind(endpoint);
         acceptor_.listen(net::socket_base::max_listen_connections);
     }
 
     void Run() {
+        // при остановке новые соединения не принимаются
+        // менеджер соединений хранит обработчик, а слушатель - менеджер, поэтому ссылка слабая
+        options_.connections->OnDrain([weak_self = this->weak_from_this()] {
+            auto self = weak_self.lock();
+            if (!self) {
+                return;
+            }
+            net::post(self->acceptor_.get_executor(), [self] {
+                sys::error_code ec;
+                self->acceptor_.close(ec);
+                self->retry_timer_.cancel();
+            });
+        });
         DoAccept();
     }
 
 private:
+    // пауза перед повтором accept, если процессу не хватило дескрипторов или памяти
+    constexpr static auto ACCEPT_RETRY_DELAY = std::chrono::milliseconds{100};
+
     net::io_context& ioc_;
-    tcp::acceptor acceptor_;
+    typename Protocol::acceptor acceptor_;
+    net::steady_timer retry_timer_;
+    std::shared_ptr<const RequestLimits> limits_;
     RequestHandler request_handler_;
+    ListenerOptions options_;
+    handler_memory::HandlerMemory handler_memory_;
+    // место под принимаемое соединение
+    std::optional<Connection> accepting_;
+
+    static net::any_io_executor MakeExecutor(net::io_context& ioc, const ListenerOptions& options) {
+        if (options.single_threaded) {
+            return ioc.get_executor();
+        }
+        return net::make_strand(ioc);
+    }
 
     void DoAccept() {
+        if (!acceptor_.is_open()) {
+            return;
+        }
+        // мест нет: не принимаем, пока не закроется одно из соединений, клиенты ждут в очереди listen
+        accepting_ = options_.connections->TryAcquire([self = this->shared_from_this()] {
+            net::post(self->acceptor_.get_executor(), [self] {
+                self->DoAccept();
+            });
+        });
+        if (!accepting_) {
+            return;
+        }
+
         acceptor_.async_accept(
-            net::make_strand(ioc_),
-            beast::bind_front_handler(&Listener::OnAccept, this->shared_from_this())
+            MakeExecutor(ioc_, options_),
+            handler_memory::MakeAllocHandler(handler_memory_,
+                beast::bind_front_handler(&Listener::OnAccept, this->shared_from_this()))
         );
     }
 
-    void OnAccept(sys::error_code ec, tcp::socket socket) {
+    void OnAccept(sys::error_code ec, typename Protocol::socket socket) {
         using namespace std::literals;
+        Connection connection = std::move(*accepting_);
+        accepting_.reset();
+
+        if (ec == net::error::operation_aborted) {
+            // акцептор закрыт при остановке
+            return;
+        }
         if (ec) {
+            // место освобождается вместе с connection, сокета для сессии нет
             ReportError(ec, "accept"sv);
+            if (ec == net::error::no_descriptors || ec == net::error::no_buffer_space || ec == net::error::no_memory) {
+                retry_timer_.expires_after(ACCEPT_RETRY_DELAY);
+                retry_timer_.async_wait([self = this->shared_from_this()](sys::error_code ec) {
+                    if (!ec) {
+                        self->DoAccept();
+                    }
+                });
+                return;
+            }
+            return DoAccept();
         }
 
-        AsyncRunSession(std::move(socket));
+        AsyncRunSession(std::move(socket), std::move(connection));
         DoAccept();
     }
 
-    void AsyncRunSession(tcp::socket&& socket) {
-        std::make_shared<Session<RequestHandler>>(std::move(socket), request_handler_)->Run();
+    void AsyncRunSession(typename Protocol::socket&& socket, Connection&& connection) {
+        if (options_.coroutine_sessions) {
+            auto executor = socket.get_executor();
+            net::co_spawn(executor,
+                          RunCoroSession<Protocol>(std::move(socket), limits_, std::move(connection),
+                                                   options_.trust_forwarded, request_handler_),
+                          net::detached);
+            return;
+        }
+        std::make_shared<Session<Protocol, RequestHandler>>(std::move(socket), limits_, std::move(connection),
+                                                            options_.trust_forwarded, request_handler_)->Run();
     }
 };
 
-template <typename RequestHandler>
-void ServeHttp(net::io_context& ioc, const tcp::endpoint& endpoint, RequestHandler&& handler) {
-    using MyListener = Listener<std::decay_t<RequestHandler>>;
-    std::make_shared<MyListener>(ioc, endpoint, std::forward<RequestHandler>(handler))->Run();
+// endpoint - tcp::endpoint или unix_socket::endpoint
+template <typename RequestHandler, typename Endpoint = tcp::endpoint>
+void ServeHttp(net::io_context& ioc, const Endpoint& endpoint, RequestLimits limits, RequestHandler&& handler,
+               ListenerOptions options = {}) {
+    using MyListener = Listener<typename Endpoint::protocol_type, std::decay_t<RequestHandler>>;
+    std::make_shared<MyListener>(ioc, endpoint, std::make_shared<const RequestLimits>(std::move(limits)),
+                                 std::forward<RequestHandler>(handler), std::move(options))->Run();
 }
 
 }  // namespace http_server
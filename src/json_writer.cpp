@@ -0,0 +1,189 @@
+#include "json_writer.h"
+
+#include <array>
+#include <charconv>
+#include <cmath>
+#include <stdexcept>
+
+namespace json_writer {
+
+namespace {
+
+constexpr std::string_view HEX_DIGITS = "0123456789abcdef";
+
+template <typename Number>
+void AppendNumber(std::string& out, Number value) {
+    std::array<char, 32> buffer;
+    auto [ptr, ec] = std::to_chars(buffer.data(), buffer.data() + buffer.size(), value);
+    out.append(buffer.data(), ptr);
+}
+
+} // namespace
+
+JsonWriter& JsonWriter::BeginObject() {
+    Open('{');
+    return *this;
+}
+
+JsonWriter& JsonWriter::EndObject() {
+    Close('}');
+    return *this;
+}
+
+JsonWriter& JsonWriter::BeginArray() {
+    Open('[');
+    return *this;
+}
+
+JsonWriter& JsonWriter::EndArray() {
+    Close(']');
+    return *this;
+}
+
+JsonWriter& JsonWriter::Key(std::string_view key) {
+    BeforeValue();
+    WriteEscaped(key);
+    out_.push_back(':');
+    after_key_ = true;
+    return *this;
+}
+
+JsonWriter& JsonWriter::Key(std::uint64_t key) {
+    BeforeValue();
+    out_.push_back('"');
+    AppendNumber(out_, key);
+    out_.append("\":");
+    after_key_ = true;
+    return *this;
+}
+
+JsonWriter& JsonWriter::String(std::string_view value) {
+    BeforeValue();
+    WriteEscaped(value);
+    return *this;
+}
+
+JsonWriter& JsonWriter::Int(std::int64_t value) {
+    BeforeValue();
+    AppendNumber(out_, value);
+    return *this;
+}
+
+JsonWriter& JsonWriter::Uint(std::uint64_t value) {
+    BeforeValue();
+    AppendNumber(out_, value);
+    return *this;
+}
+
+JsonWriter& JsonWriter::Double(double value) {
+    BeforeValue();
+    if (!std::isfinite(value)) {
+        // в JSON нет NaN и бесконечностей
+        out_.append("null");
+        return *this;
+    }
+    AppendNumber(out_, value);
+    return *this;
+}
+
+JsonWriter& JsonWriter::Bool(bool value) {
+    BeforeValue();
+    out_.append(value ? "true" : "false");
+    return *this;
+}
+
+JsonWriter& JsonWriter::Null() {
+    BeforeValue();
+    out_.append("null");
+    return *this;
+}
+
+JsonWriter& JsonWriter::Raw(std::string_view json) {
+    BeforeValue();
+    out_.append(json);
+    return *this;
+}
+
+JsonWriter& JsonWriter::Point(double x, double y) {
+    return BeginArray().Double(x).Double(y).EndArray();
+}
+
+void JsonWriter::BeforeValue() {
+    if (after_key_) {
+        after_key_ = false;
+        return;
+    }
+
+    std::uint64_t level_bit = 1ull << depth_;
+    if (has_items_ & level_bit) {
+        out_.push_back(',');
+    } else {
+        has_items_ |= level_bit;
+    }
+}
+
+void JsonWriter::Open(char bracket) {
+    if (depth_ == MAX_DEPTH) {
+        throw std::length_error("JSON nesting is too deep");
+    }
+    BeforeValue();
+    out_.push_back(bracket);
+    ++depth_;
+    has_items_ &= ~(1ull << depth_);
+}
+
+void JsonWriter::Close(char bracket) {
+    if (depth_ == 0) {
+        throw std::logic_error("Unbalanced JSON container");
+    }
+    --depth_;
+    out_.push_back(bracket);
+}
+
+void JsonWriter::WriteEscaped(std::string_view value) {
+    out_.push_back('"');
+
+    size_t run_start = 0;
+    for (size_t i = 0; i < value.size(); ++i) {
+        auto c = static_cast<unsigned char>(value[i]);
+        if (c >= 0x20 && c != '"' && c != '\\') {
+            continue;
+        }
+
+        out_.append(value.data() + run_start, i - run_start);
+        run_start = i + 1;
+        switch (c) {
+            case '"':
+                out_.append("\\\"");
+                break;
+            case '\\':
+                out_.append("\\\\");
+                break;
+            case '\n':
+                out_.append("\\n");
+                break;
+            case '\r':
+                out_.append("\\r");
+                break;
+            case '\t':
+                out_.append("\\t");
+                break;
+            case '\b':
+                out_.append("\\b");
+                break;
+            case '\f':
+                out_.append("\\f");
+                break;
+            default:
+                out_.append("\\u00");
+                out_.push_back(HEX_DIGITS[c >> 4]);
+                out_.push_back(HEX_DIGITS[c & 0xF]);
+                break;
+        }
+    }
+    out_.append(value.data() + run_start, value.size() - run_start);
+
+    out_.push_back('"');
+}
+
+} // namespace json_writer
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace json_writer {
+
+/*
+ * Потоковая запись JSON сразу в строку ответа без построения json::value.
+ * Запятые и двоеточия расставляются автоматически, числа форматируются через std::to_chars.
+ * Вложенность ограничена MAX_DEPTH уровнями.
+ */
+class JsonWriter {
+public:
+    constexpr static int MAX_DEPTH = 63;
+
+    explicit JsonWriter(std::string& out)
+        : out_(out) {
+    }
+
+    JsonWriter(const JsonWriter&) = delete;
+    JsonWriter& operator=(const JsonWriter&) = delete;
+
+    JsonWriter& BeginObject();
+    JsonWriter& EndObject();
+    JsonWriter& BeginArray();
+    JsonWriter& EndArray();
+
+    JsonWriter& Key(std::string_view key);
+    // числовой ключ ("17") записывается без временной строки
+    JsonWriter& Key(std::uint64_t key);
+
+    JsonWriter& String(std::string_view value);
+    JsonWriter& Int(std::int64_t value);
+    JsonWriter& Uint(std::uint64_t value);
+    JsonWriter& Double(double value);
+    JsonWriter& Bool(bool value);
+    JsonWriter& Null();
+    // уже сериализованный фрагмент JSON
+    JsonWriter& Raw(std::string_view json);
+
+    JsonWriter& Point(double x, double y);
+
+private:
+    std::string& out_;
+    int depth_ = 0;
+    std::uint64_t has_items_ = 0;
+    bool after_key_ = false;
+
+    void BeforeValue();
+    void Open(char bracket);
+    void Close(char bracket);
+    void WriteEscaped(std::string_view value);
+};
+
+} // namespace json_writer
@@ -8,6 +8,7 @@
 #include <boost/log/utility/setup/common_attributes.hpp>
 #include <boost/log/utility/setup/console.hpp>
 
+#include <algorithm>
 #include <chrono>
 #include <string_view>
 
@@ -32,11 +33,41 @@ void LogFormatter(logging::record_view const& rec, logging::formatting_ostream&
     strm << boost::json::serialize(log);
 }
 
-void LogServerStart(unsigned int port, std::string_view address) {
+std::string RedactTarget(std::string_view target) {
+    constexpr std::string_view TOKEN_PARAM = "token="sv;
+
+    size_t query = target.find('?');
+    if (query == std::string_view::npos) {
+        return std::string(target);
+    }
+
+    std::string result(target.substr(0, query + 1));
+    for (size_t begin = query + 1; begin <= target.size();) {
+        size_t end = std::min(target.find('&', begin), target.size());
+        std::string_view param = target.substr(begin, end - begin);
+        if (param.starts_with(TOKEN_PARAM)) {
+            result.append(TOKEN_PARAM).append("***"sv);
+        } else {
+            result.append(param);
+        }
+        if (end < target.size()) {
+            result.push_back('&');
+        }
+        begin = end + 1;
+    }
+    return result;
+}
+
+void LogServerStart(unsigned int port, std::string_view address, std::string_view io_backend,
+                    std::string_view unix_socket) {
     boost::json::value data = {
         {"port", port},
-        {"address", address}
+        {"address", address},
+        {"ioBackend", io_backend}
     };
+    if (!unix_socket.empty()) {
+        data.as_object()["unixSocket"] = unix_socket;
+    }
     BOOST_LOG_TRIVIAL(info) << logging::add_value(log_data, data) << "server started";
 }
 
@@ -61,4 +92,66 @@ void LogServerError(unsigned int error_code, std::string_view error_message, std
     BOOST_LOG_TRIVIAL(info) << logging::add_value(log_data, data) << "error";
 }
 
+void LogQueueWait(std::string_view queue, const priority_strand::PriorityStrand::WaitStats& stats) {
+    using namespace std::chrono;
+
+    auto average = stats.count ? duration_cast<microseconds>(stats.total).count() / static_cast<std::int64_t>(stats.count)
+                               : std::int64_t{0};
+    boost::json::value data = {
+        {"queue", queue},
+        {"count", stats.count},
+        {"avgWaitUs", average},
+        {"maxWaitUs", duration_cast<microseconds>(stats.max).count()}
+    };
+    BOOST_LOG_TRIVIAL(info) << logging::add_value(log_data, data) << "queue wait";
+}
+
+void LogTickerStats(const tick::Ticker::Stats& stats) {
+    using namespace std::chrono;
+
+    boost::json::value data = {
+        {"ticks", stats.ticks},
+        {"overruns", stats.overruns},
+        {"droppedPeriods", stats.dropped_periods},
+        {"errors", stats.errors},
+        {"maxLatenessUs", duration_cast<microseconds>(stats.max_lateness).count()},
+        {"maxHandlerUs", duration_cast<microseconds>(stats.max_handler).count()},
+        {"totalHandlerUs", duration_cast<microseconds>(stats.total_handler).count()}
+    };
+    BOOST_LOG_TRIVIAL(info) << logging::add_value(log_data, data) << "ticker";
+}
+
+void LogSlowTick(const tick_profiler::TickProfiler& profiler) {
+    // фазы в том же виде, что и lastTick в /api/v1/admin/tick-metrics
+    std::string phases;
+    json_writer::JsonWriter writer{phases};
+    tick_profiler::WriteBreakdown(writer, profiler.GetLastTick());
+
+    boost::json::value data = {
+        {"budgetUs", std::chrono::duration_cast<std::chrono::microseconds>(profiler.GetBudget()).count()},
+        {"phases", boost::json::parse(phases)}
+    };
+    BOOST_LOG_TRIVIAL(info) << logging::add_value(log_data, data) << "tick over budget";
+}
+
+void LogOverloadLevel(overload::Level level, double load) {
+    boost::json::value data = {
+        {"level", overload::LevelName(level)},
+        {"load", load}
+    };
+    BOOST_LOG_TRIVIAL(info) << logging::add_value(log_data, data) << "overload level changed";
+}
+
+void LogHandlerAllocations(std::uint64_t requests, const handler_memory::HandlerMemory::Stats& stats) {
+    // память под операции, взятая из кучи в среднем на один запрос
+    double heap_per_request = requests == 0 ? 0. : static_cast<double>(stats.heap) / static_cast<double>(requests);
+    boost::json::value data = {
+        {"requests", requests},
+        {"recycled", stats.recycled},
+        {"heap", stats.heap},
+        {"heapPerRequest", heap_per_request}
+    };
+    BOOST_LOG_TRIVIAL(info) << logging::add_value(log_data, data) << "handler allocations";
+}
+
 } // namespace http_logger
@@ -10,8 +10,15 @@
 #include <boost/log/utility/setup/common_attributes.hpp>
 #include <boost/log/utility/setup/console.hpp>
 
+#include "handler_memory.h"
+#include "overload_watchdog.h"
+#include "priority_strand.h"
+#include "ticker.h"
+#include "tick_profiler.h"
+
 #include <chrono>
 #include <iostream>
+#include <string>
 #include <string_view>
 
 namespace logging = boost::log;
@@ -37,6 +44,8 @@ BOOST_LOG_ATTRIBUTE_KEYWORD(timestamp, "TimeStamp", boost::posix_time::ptime)
 BOOST_LOG_ATTRIBUTE_KEYWORD(log_data, "LogData", boost::json::value)
 
 void LogFormatter(logging::record_view const& rec, logging::formatting_ostream& strm);
+// target запроса для журнала: значение параметра token (токен WebSocket и EventSource) заменено на ***
+std::string RedactTarget(std::string_view target);
 
 template <typename Formatter>
 void InitBoostLogFilter(Formatter&& formatter) {
@@ -59,30 +68,50 @@ public:
 
     template <typename Request, typename Send>
     void operator()(Request&& req, std::string_view client_ip, Send&& send) {
-        DurationMeasure dur;
         LogRequest(client_ip, req);
-        decorated_(std::forward<decltype(req)>(req), [this, send = std::forward<Send>(send),
-                                                      dur = std::move(dur)] (auto&& response) {
-            this->LogResponse(dur.Count(), response);
-            send(response);
-        });
+        decorated_(std::forward<decltype(req)>(req), client_ip,
+                   LoggingSend<std::decay_t<Send>>{std::forward<Send>(send)});
+    }
+
+    template <typename Request, typename Stream, typename Connection>
+    void Upgrade(Request&& req, std::string_view client_ip, Stream&& stream, Connection&& connection) {
+        LogRequest(client_ip, req);
+        decorated_.Upgrade(std::forward<Request>(req), std::forward<Stream>(stream),
+                           std::forward<Connection>(connection));
     }
 
 private:
     RequestHandler& decorated_;
 
+    // пишет в лог ответ и время обработки; TakeResponse соединения доступен обработчику и через обёртку
+    template <typename Send>
+    struct LoggingSend {
+        Send send;
+        DurationMeasure dur;
+
+        template <typename Response>
+        void operator()(Response&& response) const {
+            LogResponse(dur.Count(), response);
+            send(response);
+        }
+
+        auto TakeResponse() const -> decltype(send.TakeResponse()) {
+            return send.TakeResponse();
+        }
+    };
+
     template <typename Request>
     void LogRequest(std::string_view client_ip, Request& request) const {
         boost::json::value data = {
             {"ip", client_ip},
-            {"URI", request.target()},
+            {"URI", RedactTarget(request.target())},
             {"method", http::to_string(request.method())}
         };
         BOOST_LOG_TRIVIAL(info) << logging::add_value(log_data, data) << "request received";
     }
 
     template <typename Response>
-    void LogResponse(std::uint64_t time, Response& response) const {
+    static void LogResponse(std::uint64_t time, Response& response) {
         auto content_type = response[http::field::content_type];
         if (content_type.empty()) {
             content_type = "null";
@@ -98,7 +127,13 @@ private:
 
 
 
-void LogServerStart(unsigned int port, std::string_view address);
+void LogServerStart(unsigned int port, std::string_view address, std::string_view io_backend,
+                    std::string_view unix_socket = {});
 void LogServerEnd(unsigned int return_code, std::string_view exeption_text);
 void LogServerError(unsigned int error_code, std::string_view error_message, std::string_view where);
+void LogQueueWait(std::string_view queue, const priority_strand::PriorityStrand::WaitStats& stats);
+void LogTickerStats(const tick::Ticker::Stats& stats);
+void LogSlowTick(const tick_profiler::TickProfiler& profiler);
+void LogOverloadLevel(overload::Level level, double load);
+void LogHandlerAllocations(std::uint64_t requests, const handler_memory::HandlerMemory::Stats& stats);
 } // namespace http_logger
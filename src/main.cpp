@@ -3,7 +3,9 @@
 #include <boost/archive/binary_iarchive.hpp>
 #include <boost/asio/io_context.hpp>
 #include <boost/asio/signal_set.hpp>
+#include <boost/asio/steady_timer.hpp>
 #include <boost/system/errc.hpp>
+#include <atomic>
 #include <cstdlib>
 #include <fstream>
 #include <iostream>
@@ -12,13 +14,18 @@
 
 #include "app.h"
 #include "cl_parser.h"
+#include "connection_manager.h"
 #include "json_loader.h"
 #include "./leaderboard/leaderboard.h"
 #include "logger.h"
 #include "model.h"
 #include "model_serialization.h"
+#include "priority_strand.h"
+#include "rate_limiter.h"
 #include "retirement_detector.h"
 #include "request_handler.h"
+#include "spectator_broadcast.h"
+#include "state_stream.h"
 #include "ticker.h"
 
 using namespace std::literals;
@@ -117,50 +124,183 @@ int main(int argc, const char* argv[]) {
         
         app.SetListener(retirement_listener.get());
 
+        // подписчики WebSocket получают состояние сессии после каждого тика
+        state_stream::StateHub state_hub;
+        app.SetListener(&state_hub);
+
         // 2. Инициализируем io_context
         const unsigned num_threads = std::thread::hardware_concurrency();
         net::io_context ioc(num_threads);
 
+        // зрители получают те же кадры, их обход выполняется на общем пуле потоков
+        state_stream::SpectatorBroadcaster spectators{ioc.get_executor()};
+        app.SetListener(&spectators);
+
+        /*
+         * В режиме io-context-per-core соединения обслуживаются отдельными io_context, по одному на поток,
+         * и не переходят между потоками. Состояние игры остаётся на strand основного ioc: запросы
+         * передаются туда, а ответы возвращаются на executor соединения.
+         */
+        std::vector<std::unique_ptr<net::io_context>> connection_contexts;
+        if (cl_args.io_context_per_core) {
+            for (unsigned i = 0; i < std::max(1u, num_threads); ++i) {
+                connection_contexts.push_back(std::make_unique<net::io_context>(1));
+            }
+        }
+
+        connection_manager::ConnectionLimits connection_limits;
+        connection_limits.max_connections = cl_args.max_connections;
+        auto connections = std::make_shared<connection_manager::ConnectionManager>(connection_limits);
+
         // 3. Добавляем асинхронный обработчик сигналов SIGINT и SIGTERM
+        auto stop_server = [&ioc, &connection_contexts] {
+            ioc.stop();
+            for (auto& context : connection_contexts) {
+                context->stop();
+            }
+        };
         net::signal_set signals(ioc, SIGINT, SIGTERM);
-        signals.async_wait([&ioc](const boost::system::error_code& ec, [[maybe_unused]] int signal_number) {
-            if (!ec) {
-                ioc.stop();
+        net::steady_timer drain_timer(ioc);
+        signals.async_wait([&, stop_server](const boost::system::error_code& ec, int signal_number) {
+            if (ec) {
+                return;
+            }
+            if (signal_number != SIGTERM) {
+                return stop_server();
             }
+            // новые соединения не принимаются, сервер останавливается, ответив на начатые запросы
+            drain_timer.expires_after(std::chrono::milliseconds{cl_args.drain_timeout});
+            drain_timer.async_wait([stop_server](const boost::system::error_code& ec) {
+                if (!ec) {
+                    stop_server();
+                }
+            });
+            connections->Drain(stop_server);
         });
 
         // 4. Создаём обработчик HTTP-запросов и связываем его с моделью игры
         auto game_state_strand = net::make_strand(ioc);
+        // тики выполняются раньше накопившихся в strand запросов
+        priority_strand::PriorityStrand game_state_queue{game_state_strand};
 
-        auto handler = std::make_shared<http_handler::RequestHandler>(app, ioc, game_state_strand,
-                                                                      std::move(cl_args.static_root), !(static_cast<bool>(cl_args.tick_period)));
+        rate_limiter::RateLimits rate_limits = http_handler::MakeRateLimits();
+        for (const auto& spec : cl_args.rate_limits) {
+            if (!rate_limiter::ParseRateLimit(spec, rate_limiter::Scope::token, rate_limits)) {
+                throw std::runtime_error("Invalid rate limit: "s + spec);
+            }
+        }
+        for (const auto& spec : cl_args.ip_rate_limits) {
+            if (!rate_limiter::ParseRateLimit(spec, rate_limiter::Scope::ip, rate_limits)) {
+                throw std::runtime_error("Invalid rate limit: "s + spec);
+            }
+        }
+
+        auto handler = std::make_shared<http_handler::RequestHandler>(app, ioc, game_state_queue, state_hub, spectators,
+                                                                      std::move(cl_args.static_root), !(static_cast<bool>(cl_args.tick_period)),
+                                                                      std::move(rate_limits));
         http_logger::InitBoostLogFilter(http_logger::LogFormatter);
         http_logger::LogginRequestHandler<http_handler::RequestHandler> logging_handler(*handler);
 
+        std::shared_ptr<tick::Ticker> ticker;
         if (cl_args.tick_period != 0) {
             auto tick_period = std::chrono::milliseconds{cl_args.tick_period};
-            auto ticker = std::make_shared<tick::Ticker>(game_state_strand, tick_period, [&app](std::chrono::milliseconds delta) {
+            tick::Ticker::Options ticker_options;
+            if (auto policy = tick::ParseCatchUpPolicy(cl_args.tick_catch_up)) {
+                ticker_options.policy = *policy;
+            } else {
+                throw std::runtime_error("Unknown tick catch-up policy: "s + cl_args.tick_catch_up);
+            }
+            app.GetTickProfiler().SetBudget(tick_period);
+
+            overload::WatchdogConfig watchdog_config;
+            watchdog_config.max_level = static_cast<overload::Level>(cl_args.max_degradation_level);
+            app.GetWatchdog().SetConfig(watchdog_config);
+
+            ticker = std::make_shared<tick::Ticker>(game_state_queue, tick_period,
+                                                    [&app, level = overload::Level::normal](std::chrono::milliseconds delta) mutable {
                 app.ProcessTick(delta.count());
-            });
+                if (app.GetTickProfiler().IsLastTickOverBudget()) {
+                    http_logger::LogSlowTick(app.GetTickProfiler());
+                }
+                if (auto new_level = app.GetWatchdog().GetLevel(); new_level != level) {
+                    level = new_level;
+                    http_logger::LogOverloadLevel(level, app.GetWatchdog().GetLoad());
+                }
+            }, ticker_options);
+            handler->SetTicker(ticker.get());
             ticker->Start();
         }
 
         // 5. Запустить обработчик HTTP-запросов, делегируя их обработчику запросов
         const auto address = net::ip::make_address("0.0.0.0");
         constexpr net::ip::port_type port = 8080;
-        http_server::ServeHttp(ioc, {address, port}, logging_handler);
+        http_server::RequestLimits request_limits = http_handler::MakeRequestLimits();
+        for (const auto& spec : cl_args.request_limits) {
+            if (!http_server::ParseRouteLimit(spec, request_limits)) {
+                throw std::runtime_error("Invalid request limit: "s + spec);
+            }
+        }
+        http_server::ListenerOptions listener_options{.coroutine_sessions = cl_args.coroutine_sessions,
+                                                      .connections = connections,
+                                                      .trust_forwarded = cl_args.trust_forwarded};
+        if (!cl_args.unix_socket.empty()) {
+            // к Unix-сокету подключается только локальный обратный прокси; SO_REUSEPORT для него не работает,
+            // поэтому в режиме io-context-per-core сокет обслуживает первый из io_context соединений
+            http_server::ListenerOptions unix_options = listener_options;
+            unix_options.trust_forwarded = true;
+            unix_options.single_threaded = !connection_contexts.empty();
+            net::io_context& unix_context = connection_contexts.empty() ? ioc : *connection_contexts.front();
+            // файл сокета от прошлого запуска мешает bind; другой файл по этому пути - ошибка конфигурации
+            if (std::filesystem::is_socket(cl_args.unix_socket)) {
+                std::filesystem::remove(cl_args.unix_socket);
+            } else if (std::filesystem::exists(cl_args.unix_socket)) {
+                throw std::runtime_error("Not a socket: "s + cl_args.unix_socket);
+            }
+            http_server::ServeHttp(unix_context, http_server::unix_socket::endpoint{cl_args.unix_socket},
+                                   request_limits, logging_handler, std::move(unix_options));
+        }
+        if (connection_contexts.empty()) {
+            http_server::ServeHttp(ioc, {address, port}, std::move(request_limits), logging_handler, listener_options);
+        } else {
+            listener_options.reuse_port = true;
+            listener_options.single_threaded = true;
+            for (auto& context : connection_contexts) {
+                http_server::ServeHttp(*context, {address, port}, request_limits, logging_handler, listener_options);
+            }
+        }
 
-        http_logger::LogServerStart(port, address.to_string());
+        http_logger::LogServerStart(port, address.to_string(), http_server::IO_BACKEND, cl_args.unix_socket);
 
         // 6. Запускаем обработку асинхронных операций
-        RunWorkers(std::max(1u, num_threads), [&ioc] {
-            ioc.run();
-        });
+        if (connection_contexts.empty()) {
+            RunWorkers(std::max(1u, num_threads), [&ioc] {
+                ioc.run();
+            });
+        } else {
+            // первый поток обслуживает игру, остальные - каждый свой io_context соединений
+            std::atomic<size_t> next_context = 0;
+            RunWorkers(static_cast<unsigned>(connection_contexts.size()) + 1, [&] {
+                if (size_t index = next_context++; index == 0) {
+                    ioc.run();
+                } else {
+                    connection_contexts[index - 1]->run();
+                }
+            });
+        }
 
         if (listener) {
             listener->Serialize();
         }
 
+        if (ticker) {
+            http_logger::LogTickerStats(ticker->GetStats());
+        }
+
+        auto allocation_stats = http_server::GetHandlerAllocationStats();
+        http_logger::LogHandlerAllocations(allocation_stats.requests, allocation_stats.memory);
+        http_logger::LogQueueWait("tick"sv, game_state_queue.GetWaitStats(priority_strand::Priority::high));
+        http_logger::LogQueueWait("api"sv, game_state_queue.GetWaitStats(priority_strand::Priority::normal));
+
         http_logger::LogServerEnd(0, ""sv);
     } catch (const std::exception& ex) {
         http_logger::LogServerEnd(EXIT_FAILURE, ex.what());
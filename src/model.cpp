@@ -23,6 +23,21 @@ std::string DirectionToString(Direction dir) {
     throw std::runtime_error("Unknown direction status in Dog class"s);
 }
 
+std::optional<Move> ParseMove(std::string_view move) {
+    if (move.empty()) {
+        return Move::stop;
+    } else if (move == "L"sv) {
+        return Move::left;
+    } else if (move == "R"sv) {
+        return Move::right;
+    } else if (move == "U"sv) {
+        return Move::up;
+    } else if (move == "D"sv) {
+        return Move::down;
+    }
+    return std::nullopt;
+}
+
 Road::Road(HorizontalTag, geom::Point start, geom::Coord end_x) noexcept
     : start_{start}
     , end_{end_x, start.y} {
@@ -298,6 +313,10 @@ game_obj::Bag<Loot>* Dog::GetBag() {
     return &bag_;
 }
 
+const game_obj::Bag<Loot>* Dog::GetBag() const {
+    return &bag_;
+}
+
 void Dog::AddScore(std::uint16_t score_to_add) {
     score_ += score_to_add;
 }
@@ -392,6 +411,7 @@ Dog* GameSession::AddDog(std::string_view name) {
     auto dog = std::make_shared<Dog>(Dog::Id{next_dog_id_++}, std::string(name), dog_pos, default_speed, map_->GetBagCapacity());
     auto dog_id = dog->GetId();
     dogs_.emplace(dog_id, dog);
+    dog_versions_[dog_id] = GetChangeVersion();
     items_gatherer_provider_.AddGatherer(dog.get());
     return dogs_.at(dog_id).get();
 }
@@ -399,6 +419,8 @@ Dog* GameSession::AddDog(std::string_view name) {
 void GameSession::DeleteDog(const Dog::Id& id) {
     items_gatherer_provider_.EraseGatherer(dogs_.at(id).get());
     dogs_.erase(id);
+    dog_versions_.erase(id);
+    removed_dogs_.emplace_back(GetChangeVersion(), id);
 }
 
 const Dog* GameSession::GetDog(Dog::Id id) const {
@@ -419,12 +441,127 @@ const GameSession::IdToLootIndex& GameSession::GetAllLoot() const {
 
 void GameSession::EraseLoot(Loot::Id loot_id) {
     loot_.erase(loot_id);
+    loot_versions_.erase(loot_id);
+    removed_loot_.emplace_back(GetChangeVersion(), loot_id);
+}
+
+void GameSession::MarkDogChanged(Dog::Id id) {
+    if (dogs_.contains(id)) {
+        dog_versions_[id] = GetChangeVersion();
+    }
+}
+
+void GameSession::ApplyMove(Dog::Id id, Move move) {
+    auto it = dogs_.find(id);
+    if (it == dogs_.end()) {
+        return; // игрок успел покинуть игру
+    }
+    Dog* dog = it->second.get();
+
+    double map_speed = map_->GetSpeed();
+    switch (move) {
+        case Move::stop:
+            dog->Stop();
+            break;
+        case Move::left:
+            dog->SetSpeed({-map_speed, 0});
+            dog->SetDirection(Direction::WEST);
+            break;
+        case Move::right:
+            dog->SetSpeed({map_speed, 0});
+            dog->SetDirection(Direction::EAST);
+            break;
+        case Move::up:
+            dog->SetSpeed({0, -map_speed});
+            dog->SetDirection(Direction::NORTH);
+            break;
+        case Move::down:
+            dog->SetSpeed({0, map_speed});
+            dog->SetDirection(Direction::SOUTH);
+            break;
+    }
+    MarkDogChanged(id);
+}
+
+void GameSession::EnqueueMove(Dog::Id id, Move move) const {
+    input_queue_.Push({id, move});
+}
+
+void GameSession::ApplyQueuedMoves() {
+    input_queue_.Drain([this](const MoveCommand& command) {
+        ApplyMove(command.dog_id, command.move);
+    });
 }
 
 void GameSession::UpdateState(std::int64_t tick) {
-    UpdateDogsState(tick);
-    GenerateLoot(tick);
-    HandleCollisions();
+    UpdateState(tick, [](TickPhase, auto&& run) {
+        run();
+    });
+}
+
+bool GameSession::IsIdle() const {
+    return std::all_of(dogs_.begin(), dogs_.end(), [](const auto& dog) {
+        return dog.second->IsStopped();
+    });
+}
+
+void GameSession::FinishTick() {
+    ++version_;
+    ForgetOldRemovals();
+}
+
+std::uint64_t GameSession::GetVersion() const noexcept {
+    return version_;
+}
+
+bool GameSession::CanMakeDelta(std::uint64_t since_version) const noexcept {
+    return since_version <= version_ && version_ - since_version <= DELTA_HISTORY_DEPTH;
+}
+
+GameSession::StateDelta GameSession::MakeDelta(std::uint64_t since_version) const {
+    if (!CanMakeDelta(since_version)) {
+        throw std::out_of_range("State version "s + std::to_string(since_version) + " is too old for delta"s);
+    }
+
+    StateDelta delta;
+    for (const auto& [id, dog] : dogs_) {
+        if (auto it = dog_versions_.find(id); it == dog_versions_.end() || it->second > since_version) {
+            delta.changed_dogs.push_back(dog.get());
+        }
+    }
+    for (const auto& [id, loot] : loot_) {
+        if (auto it = loot_versions_.find(id); it == loot_versions_.end() || it->second > since_version) {
+            delta.spawned_loot.push_back(loot.get());
+        }
+    }
+    for (const auto& [version, id] : removed_dogs_) {
+        if (version > since_version) {
+            delta.removed_dogs.push_back(id);
+        }
+    }
+    for (const auto& [version, id] : removed_loot_) {
+        if (version > since_version) {
+            delta.removed_loot.push_back(id);
+        }
+    }
+    return delta;
+}
+
+std::uint64_t GameSession::GetChangeVersion() const noexcept {
+    return version_ + 1;
+}
+
+void GameSession::ForgetOldRemovals() {
+    if (version_ <= DELTA_HISTORY_DEPTH) {
+        return;
+    }
+    std::uint64_t oldest_version = version_ - DELTA_HISTORY_DEPTH;
+    while (!removed_dogs_.empty() && removed_dogs_.front().first <= oldest_version) {
+        removed_dogs_.pop_front();
+    }
+    while (!removed_loot_.empty() && removed_loot_.front().first <= oldest_version) {
+        removed_loot_.pop_front();
+    }
 }
 
 std::uint32_t GameSession::GetNextDogId() const {
@@ -438,13 +575,15 @@ std::uint32_t GameSession::GetNextLootId() const {
 void GameSession::Restore(IdToDogIndex&& dogs, std::uint32_t next_dog_id, IdToLootIndex&& loot, std::uint32_t next_loot_id) {
     dogs_ = std::forward<IdToDogIndex>(dogs);
     next_dog_id_ = next_dog_id;
-    for (auto& [_, dog] : dogs_) {
+    for (auto& [id, dog] : dogs_) {
         items_gatherer_provider_.AddGatherer(dog.get());
+        dog_versions_[id] = GetChangeVersion();
     }
 
     loot_ = std::forward<IdToLootIndex>(loot);
-    for (auto [_, loot] : loot_) {
+    for (auto [id, loot] : loot_) {
         items_gatherer_provider_.PushBackLoot(loot.get());
+        loot_versions_[id] = GetChangeVersion();
     }
     next_loot_id_ = next_loot_id;
 }
@@ -454,10 +593,11 @@ void GameSession::UpdateDogsState(std::int64_t tick) {
     double ms_convertion = 0.001;
     double tick_multy = static_cast<double>(tick) * ms_convertion;
 
-    for (auto [_, dog] : dogs_) {
+    for (auto [id, dog] : dogs_) {
         if (dog->IsStopped()) {
             continue;
         }
+        dog_versions_[id] = GetChangeVersion();
 
         auto cur_dog_pos = dog->GetPosition();
         auto dog_speed = dog->GetSpeed();
@@ -514,14 +654,18 @@ void GameSession::UpdateDogsState(std::int64_t tick) {
     }
 }
 
-void GameSession::HandleCollisions() {
-    auto gather_events = collision_detector::FindGatherEvents(items_gatherer_provider_);
+void GameSession::FindGatherEvents() {
+    gather_events_ = collision_detector::FindGatherEvents(items_gatherer_provider_);
+}
 
+void GameSession::ApplyGatherEvents() {
     std::vector<size_t> items_to_erase;
-    for (const auto& event : gather_events) {
+    for (const auto& event : gather_events_) {
         game_obj::Bag<Loot>* gatherer_bag = items_gatherer_provider_.GetDog(event.gatherer_id)->GetBag();
+        const Dog::Id& gatherer_id = items_gatherer_provider_.GetDog(event.gatherer_id)->GetId();
         if (std::holds_alternative<const Office*>(items_gatherer_provider_.GetRawLootVal(event.item_id))) {
             if (!gatherer_bag->Empty()) {
+                dog_versions_[gatherer_id] = GetChangeVersion();
                 for (size_t i = 0; i < gatherer_bag->GetSize(); ++i) {
                     auto loot = gatherer_bag->TakeTopLoot();
                     items_gatherer_provider_.GetDog(event.gatherer_id)->AddScore(map_->GetLootScore(loot.type));
@@ -531,6 +675,7 @@ void GameSession::HandleCollisions() {
             if (std::find(items_to_erase.begin(), items_to_erase.end(), event.item_id) == items_to_erase.end()) {
                 const Loot* taking_loot = std::get<const Loot*>(items_gatherer_provider_.GetRawLootVal(event.item_id));
                 if (gatherer_bag->PickUpLoot(*taking_loot)) {
+                    dog_versions_[gatherer_id] = GetChangeVersion();
                     items_to_erase.push_back(event.item_id);
                 }
             }
@@ -538,9 +683,10 @@ void GameSession::HandleCollisions() {
     }
     // убираем из provider и session весь лишний лут
     for (size_t id : items_to_erase) {
-        loot_.erase(std::get<const Loot*>(items_gatherer_provider_.GetRawLootVal(id))->id);
+        EraseLoot(std::get<const Loot*>(items_gatherer_provider_.GetRawLootVal(id))->id);
         items_gatherer_provider_.EraseLoot(id);
     }
+    gather_events_.clear();
 }
 
 void GameSession::GenerateLoot(std::int64_t tick) {
@@ -552,6 +698,7 @@ void GameSession::GenerateLoot(std::int64_t tick) {
     for (; loot_counter != 0; --loot_counter) {
         auto loot_ptr = std::make_shared<Loot>(Loot::Id{next_loot_id_++}, static_cast<uint8_t>(dist(rng)), map_->GetRandomPoint());
         loot_.insert({loot_ptr->id, loot_ptr});
+        loot_versions_[loot_ptr->id] = GetChangeVersion();
         items_gatherer_provider_.PushBackLoot(loot_ptr.get());
     }
 }
@@ -647,12 +794,4 @@ bool Game::IsDogSpawnRandom() const {
     return random_dog_spawn_;
 }
 
-
-void Game::UpdateState(std::int64_t tick) {
-    for (auto& [_, map_sessions] : sessions_) {
-        for (auto session : map_sessions) {
-            session->UpdateState(tick);
-        }
-    }
-}
 }  // namespace model
@@ -8,6 +8,7 @@
 #include <map>
 #include <memory>
 #include <numeric>
+#include <optional>
 #include <random>
 #include <string>
 #include <string_view>
@@ -20,6 +21,7 @@
 #include "game_objects.h"
 #include "geom.h"
 #include "loot_generator.h"
+#include "mpsc_queue.h"
 #include "tagged.h"
 
 namespace model {
@@ -30,6 +32,19 @@ enum class Direction {
 
 std::string DirectionToString(Direction dir);
 
+// команда движения игрока
+enum class Move : std::uint8_t {
+    stop, left, right, up, down
+};
+
+// фазы тика игровой сессии в порядке выполнения
+enum class TickPhase : std::uint8_t {
+    input_apply, movement, loot_spawn, gather, scoring
+};
+
+// "" - остановка, "L", "R", "U", "D" - направление; иначе пустой optional
+std::optional<Move> ParseMove(std::string_view move);
+
 class Road {
     struct HorizontalTag {
         explicit HorizontalTag() = default;
@@ -202,6 +217,7 @@ public:
     bool IsStopped() const;
 
     game_obj::Bag<Loot>* GetBag();
+    const game_obj::Bag<Loot>* GetBag() const;
     void AddScore(std::uint16_t score_to_add);
     std::uint16_t GetScore() const;
 
@@ -254,6 +270,21 @@ public:
 
     using IdToLootIndex = std::map<Loot::Id, std::shared_ptr<Loot>>;
 
+    struct MoveCommand {
+        Dog::Id dog_id;
+        Move move;
+    };
+
+    struct StateDelta {
+        std::vector<const Dog*> changed_dogs;
+        std::vector<const Loot*> spawned_loot;
+        std::vector<Dog::Id> removed_dogs;
+        std::vector<Loot::Id> removed_loot;
+    };
+
+    // сколько последних версий состояния можно восстановить дельтой
+    constexpr static std::uint64_t DELTA_HISTORY_DEPTH = 256;
+
     explicit GameSession(const Map* map, bool random_dog_spawn, const LootConfig& loot_config)
         : map_(map)
         , random_dog_spawn_(random_dog_spawn)
@@ -279,9 +310,55 @@ public:
     const IdToLootIndex& GetAllLoot() const;
 
     void EraseLoot(Loot::Id loot_id);
+    void MarkDogChanged(Dog::Id id);
+
+    // фазы тика: команды игроков, движение, появление лута, поиск столкновений, подбор и сдача лута
+    void ApplyQueuedMoves();
+    void UpdateDogsState(std::int64_t tick);
+    void GenerateLoot(std::int64_t tick);
+    void FindGatherEvents();
+    void ApplyGatherEvents();
+    void FinishTick();
+
+    // нет собак или все стоят
+    bool IsIdle() const;
+
+    void ApplyMove(Dog::Id id, Move move);
+    // из любого потока; команда применится в начале следующего тика
+    void EnqueueMove(Dog::Id id, Move move) const;
+
+    /*
+     * Все фазы тика по порядку. run_phase(phase, fn) обязан вызвать fn, например замерив его длительность.
+     * С skip_idle_loot лут не появляется, пока все собаки стоят.
+     */
+    template <typename RunPhase>
+    void UpdateState(std::int64_t tick, RunPhase&& run_phase, bool skip_idle_loot = false) {
+        run_phase(TickPhase::input_apply, [this] {
+            ApplyQueuedMoves();
+        });
+        run_phase(TickPhase::movement, [this, tick] {
+            UpdateDogsState(tick);
+        });
+        if (!skip_idle_loot || !IsIdle()) {
+            run_phase(TickPhase::loot_spawn, [this, tick] {
+                GenerateLoot(tick);
+            });
+        }
+        run_phase(TickPhase::gather, [this] {
+            FindGatherEvents();
+        });
+        run_phase(TickPhase::scoring, [this] {
+            ApplyGatherEvents();
+        });
+        FinishTick();
+    }
 
     void UpdateState(std::int64_t tick);
 
+    std::uint64_t GetVersion() const noexcept;
+    bool CanMakeDelta(std::uint64_t since_version) const noexcept;
+    StateDelta MakeDelta(std::uint64_t since_version) const;
+
     std::uint32_t GetNextDogId() const;
     std::uint32_t GetNextLootId() const;
 
@@ -298,9 +375,23 @@ private:
     loot_gen::LootGenerator loot_generator_;
     LootOfficeDogProvider items_gatherer_provider_{map_->GetOffices()};
 
-    void UpdateDogsState(std::int64_t tick);
-    void HandleCollisions();
-    void GenerateLoot(std::int64_t tick);
+    /* версия увеличивается на каждом тике; изменения между тиками помечаются
+     следующей версией, поэтому клиент, получивший версию N, увидит их в дельте от N
+     */
+    std::uint64_t version_ = 0;
+    std::unordered_map<Dog::Id, std::uint64_t, DogIdHasher> dog_versions_;
+    std::map<Loot::Id, std::uint64_t> loot_versions_;
+    std::deque<std::pair<std::uint64_t, Dog::Id>> removed_dogs_;
+    std::deque<std::pair<std::uint64_t, Loot::Id>> removed_loot_;
+
+    // команды игроков не меняют состояние сессии до тика, поэтому очередь доступна и константной сессии
+    mutable util::MpscQueue<MoveCommand> input_queue_;
+
+    std::uint64_t GetChangeVersion() const noexcept;
+    void ForgetOldRemovals();
+
+    // события между фазами FindGatherEvents и ApplyGatherEvents
+    std::vector<collision_detector::GatheringEvent> gather_events_;
 };
 
 class Game {
@@ -339,8 +430,6 @@ public:
 
     bool IsDogSpawnRandom() const;
 
-    void UpdateState(std::int64_t tick);
-
 private:
 
     std::vector<Map> maps_;
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+
+namespace util {
+
+/*
+ * Очередь без блокировок: много производителей, один потребитель.
+ * Производители добавляют узел в стек одним CAS, потребитель забирает весь стек
+ * одной операцией exchange и разворачивает его, поэтому элементы отдаются в порядке добавления,
+ * а проблемы ABA не возникает.
+ */
+template <typename T>
+class MpscQueue {
+public:
+    MpscQueue() = default;
+
+    // только пока очередью никто не пользуется
+    MpscQueue(MpscQueue&& other) noexcept
+        : head_(other.head_.exchange(nullptr, std::memory_order_acquire)) {
+    }
+
+    MpscQueue(const MpscQueue&) = delete;
+    MpscQueue& operator=(const MpscQueue&) = delete;
+    MpscQueue& operator=(MpscQueue&&) = delete;
+
+    ~MpscQueue() {
+        Delete(head_.exchange(nullptr, std::memory_order_acquire));
+    }
+
+    // из любого потока
+    void Push(T value) {
+        Node* node = new Node{std::move(value), head_.load(std::memory_order_relaxed)};
+        while (!head_.compare_exchange_weak(node->next, node, std::memory_order_release,
+                                            std::memory_order_relaxed)) {
+        }
+    }
+
+    // только из потока потребителя; возвращает количество обработанных элементов
+    template <typename Handler>
+    size_t Drain(Handler&& handler) {
+        Node* node = head_.exchange(nullptr, std::memory_order_acquire);
+
+        Node* first = nullptr;
+        while (node) {
+            Node* next = node->next;
+            node->next = first;
+            first = node;
+            node = next;
+        }
+
+        size_t count = 0;
+        try {
+            while (first) {
+                Node* current = first;
+                first = first->next;
+                T value = std::move(current->value);
+                delete current;
+                handler(std::move(value));
+                ++count;
+            }
+        } catch (...) {
+            Delete(first);
+            throw;
+        }
+        return count;
+    }
+
+    bool Empty() const noexcept {
+        return head_.load(std::memory_order_acquire) == nullptr;
+    }
+
+private:
+    struct Node {
+        T value;
+        Node* next = nullptr;
+    };
+
+    std::atomic<Node*> head_ = nullptr;
+
+    static void Delete(Node* node) noexcept {
+        while (node) {
+            delete std::exchange(node, node->next);
+        }
+    }
+};
+
+}  // namespace util
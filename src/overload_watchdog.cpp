@@ -0,0 +1,63 @@
+#include "overload_watchdog.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+namespace overload {
+
+using namespace std::literals;
+
+std::string_view LevelName(Level level) {
+    switch (level) {
+        case Level::normal:
+            return "normal"sv;
+        case Level::reduced_snapshots:
+            return "reducedSnapshots"sv;
+        case Level::skip_idle_loot:
+            return "skipIdleLoot"sv;
+        case Level::throttle_polls:
+            return "throttlePolls"sv;
+        case Level::shed_joins:
+            return "shedJoins"sv;
+    }
+    throw std::invalid_argument("Unknown overload level"s);
+}
+
+void Watchdog::OnTick(Clock::duration tick_time, Clock::duration budget) {
+    ++tick_number_;
+    if (budget <= Clock::duration{}) {
+        return;
+    }
+
+    auto recovery_step = std::chrono::ceil<std::chrono::seconds>(budget * config_.recover_after);
+    retry_after_.store(std::max(recovery_step.count(), std::chrono::seconds::rep{1}), std::memory_order_relaxed);
+
+    double load = std::chrono::duration<double>(tick_time) / std::chrono::duration<double>(budget);
+    load_ += (load - load_) * config_.smoothing;
+
+    auto level = static_cast<std::uint8_t>(GetLevel());
+    if (load_ > config_.overload_load) {
+        under_ticks_ = 0;
+        if (++over_ticks_ >= config_.escalate_after && level < static_cast<std::uint8_t>(config_.max_level)) {
+            level_.store(static_cast<Level>(level + 1), std::memory_order_relaxed);
+            over_ticks_ = 0;
+        }
+    } else if (load_ < config_.recover_load) {
+        over_ticks_ = 0;
+        if (++under_ticks_ >= config_.recover_after && level > 0) {
+            level_.store(static_cast<Level>(level - 1), std::memory_order_relaxed);
+            under_ticks_ = 0;
+        }
+    } else {
+        over_ticks_ = 0;
+        under_ticks_ = 0;
+    }
+}
+
+bool Watchdog::ShouldPublishSnapshot() const noexcept {
+    return !IsAtLeast(Level::reduced_snapshots) || config_.snapshot_period <= 1
+        || tick_number_ % config_.snapshot_period == 0;
+}
+
+} // namespace overload
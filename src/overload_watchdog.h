@@ -0,0 +1,87 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string_view>
+
+namespace overload {
+
+// уровни деградации; каждый следующий включает все предыдущие
+enum class Level : std::uint8_t {
+    normal,
+    reduced_snapshots,  // состояние публикуется не каждый тик
+    skip_idle_loot,     // лут не генерируется в сессиях, где все собаки стоят
+    throttle_polls,     // опрос /game/state без waitFor получает 429
+    shed_joins          // опрос состояния и вход в игру получают 503
+};
+
+constexpr Level MAX_LEVEL = Level::shed_joins;
+
+std::string_view LevelName(Level level);
+
+struct WatchdogConfig {
+    // загрузка - сглаженное отношение времени тика к его периоду
+    double overload_load = 0.9;
+    double recover_load = 0.6;
+    double smoothing = 0.2;
+    // сколько тиков подряд загрузка должна держаться выше или ниже порога для смены уровня
+    unsigned escalate_after = 10;
+    unsigned recover_after = 50;
+    // на уровне reduced_snapshots состояние публикуется каждый N-й тик
+    unsigned snapshot_period = 2;
+    Level max_level = MAX_LEVEL;
+};
+
+/*
+ * Следит за временем тиков и при устойчивой перегрузке по одному повышает уровень деградации,
+ * а когда нагрузка спадает - так же по одному понижает. Уровень меняется только на strand игры,
+ * читать его можно из любого потока.
+ */
+class Watchdog {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    Watchdog() = default;
+    explicit Watchdog(WatchdogConfig config)
+        : config_(config) {
+    }
+
+    void SetConfig(WatchdogConfig config) noexcept {
+        config_ = config;
+    }
+
+    // budget == 0 - тики ручные, деградация не нужна
+    void OnTick(Clock::duration tick_time, Clock::duration budget);
+
+    Level GetLevel() const noexcept {
+        return level_.load(std::memory_order_relaxed);
+    }
+
+    bool IsAtLeast(Level level) const noexcept {
+        return GetLevel() >= level;
+    }
+
+    // публиковать ли состояние на текущем тике
+    bool ShouldPublishSnapshot() const noexcept;
+
+    double GetLoad() const noexcept {
+        return load_;
+    }
+
+    // для Retry-After отказов из-за перегрузки: время одного шага восстановления, не меньше секунды
+    std::chrono::seconds GetRetryAfter() const noexcept {
+        return std::chrono::seconds{retry_after_.load(std::memory_order_relaxed)};
+    }
+
+private:
+    WatchdogConfig config_;
+    std::atomic<Level> level_ = Level::normal;
+    std::atomic<std::chrono::seconds::rep> retry_after_ = 1;
+    double load_ = 0.;
+    unsigned over_ticks_ = 0;
+    unsigned under_ticks_ = 0;
+    std::uint64_t tick_number_ = 0;
+};
+
+} // namespace overload
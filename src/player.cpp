@@ -29,27 +29,27 @@ Token PlayerTokens::GenerateUniqueToken() {
 }
 
 Token PlayerTokens::AddPlayer(Player* player) {
+    std::unique_lock lock{mutex_};
     auto token = GenerateUniqueToken();
     token_to_player_[token] = player;
     return token;
 }
 
 void PlayerTokens::DeletePlayer(const Token& token) {
+    std::unique_lock lock{mutex_};
     token_to_player_.erase(token);
 }
 
 Player* PlayerTokens::FindPlayerByToken(const Token& token) {
-    if (token_to_player_.contains(token)) {
-        return token_to_player_.at(token);
-    }
-    return nullptr;
+    std::shared_lock lock{mutex_};
+    auto it = token_to_player_.find(token);
+    return it != token_to_player_.end() ? it->second : nullptr;
 }
 
 const Player* PlayerTokens::FindPlayerByToken(const Token& token) const {
-    if (token_to_player_.contains(token)) {
-        return token_to_player_.at(token);
-    }
-    return nullptr;
+    std::shared_lock lock{mutex_};
+    auto it = token_to_player_.find(token);
+    return it != token_to_player_.end() ? it->second : nullptr;
 }
 
 Player& Players::Add(model::Dog* dog, const model::GameSession* session) {
@@ -1,7 +1,9 @@
 #pragma once
 
+#include <mutex>
 #include <numeric>
 #include <random>
+#include <shared_mutex>
 #include <unordered_map>
 #include <vector>
 
@@ -47,6 +49,7 @@ public:
     }
 
     PlayerTokens& operator=(PlayerTokens&& other) {
+        std::unique_lock lock{mutex_};
         token_to_player_ = std::move(other.token_to_player_);
         return *this;
     }
@@ -59,6 +62,18 @@ public:
     Player* FindPlayerByToken(const Token& token);
     const Player* FindPlayerByToken(const Token& token) const;
 
+    // из любого потока: visitor вызывается, пока игрока нельзя удалить; false - токен не найден
+    template <typename Visitor>
+    bool VisitPlayer(const Token& token, Visitor&& visitor) const {
+        std::shared_lock lock{mutex_};
+        auto it = token_to_player_.find(token);
+        if (it == token_to_player_.end()) {
+            return false;
+        }
+        visitor(static_cast<const Player&>(*it->second));
+        return true;
+    }
+
 private:
     std::random_device random_device_;
     std::mt19937_64 generator1_{[this] {
@@ -73,6 +88,8 @@ private:
     using TokenHasher = util::TaggedHasher<Token>;
     using TokenToPlayer = std::unordered_map<Token, Player*, TokenHasher>;
 
+    // таблицу меняет только strand игры, но читают её и потоки ввода
+    mutable std::shared_mutex mutex_;
     TokenToPlayer token_to_player_;
 
     Token GenerateUniqueToken();
@@ -0,0 +1,62 @@
+#include "priority_strand.h"
+
+#include <boost/asio/post.hpp>
+
+#include <algorithm>
+
+namespace priority_strand {
+
+using namespace std::literals;
+using namespace std::chrono;
+
+void PriorityStrand::Post(Priority priority, Task task) {
+    {
+        std::lock_guard lock{mutex_};
+        queues_[static_cast<size_t>(priority)].push_back({std::move(task), Clock::now()});
+    }
+    net::post(strand_, [this] {
+        RunNext();
+    });
+}
+
+PriorityStrand::WaitStats PriorityStrand::GetWaitStats(Priority priority) const {
+    std::lock_guard lock{mutex_};
+    return stats_[static_cast<size_t>(priority)];
+}
+
+void PriorityStrand::RunNext() {
+    Task task;
+    {
+        std::lock_guard lock{mutex_};
+        // насосов ровно столько же, сколько задач, поэтому очередь здесь не пуста
+        auto queue = std::find_if(queues_.begin(), queues_.end(), [](const auto& queue) {
+            return !queue.empty();
+        });
+        if (queue == queues_.end()) {
+            return;
+        }
+
+        auto wait = Clock::now() - queue->front().enqueued;
+        WaitStats& stats = stats_[queue - queues_.begin()];
+        ++stats.count;
+        stats.total += wait;
+        stats.max = std::max(stats.max, wait);
+        stats.last = wait;
+
+        task = std::move(queue->front().task);
+        queue->pop_front();
+    }
+    task();
+}
+
+void WriteWaitStats(json_writer::JsonWriter& writer, const PriorityStrand::WaitStats& stats) {
+    auto total = duration_cast<microseconds>(stats.total).count();
+    writer.BeginObject()
+        .Key("count"sv).Uint(stats.count)
+        .Key("avgWaitUs"sv).Int(stats.count ? total / static_cast<std::int64_t>(stats.count) : 0)
+        .Key("maxWaitUs"sv).Int(duration_cast<microseconds>(stats.max).count())
+        .Key("lastWaitUs"sv).Int(duration_cast<microseconds>(stats.last).count())
+        .EndObject();
+}
+
+} // namespace priority_strand
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/strand.hpp>
+
+#include "json_writer.h"
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+
+namespace priority_strand {
+
+namespace net = boost::asio;
+
+enum class Priority {
+    high,   // тик и публикация состояния
+    normal  // запросы API
+};
+
+/*
+ * Обёртка над strand игры с двумя очередями. На каждую задачу в strand ставится один "насос",
+ * который выполняет самую приоритетную из ожидающих задач, поэтому тик, пришедший после
+ * тысяч запросов, выполняется следующим, а не в конце очереди strand.
+ */
+class PriorityStrand {
+public:
+    using Strand = net::strand<net::io_context::executor_type>;
+    using Clock = std::chrono::steady_clock;
+    using Task = std::function<void()>;
+
+    // время ожидания задач в очереди
+    struct WaitStats {
+        std::uint64_t count = 0;
+        Clock::duration total{};
+        Clock::duration max{};
+        Clock::duration last{};
+    };
+
+    explicit PriorityStrand(Strand& strand)
+        : strand_(strand) {
+    }
+
+    PriorityStrand(const PriorityStrand&) = delete;
+    PriorityStrand& operator=(const PriorityStrand&) = delete;
+
+    // из любого потока; задача выполнится на strand
+    void Post(Priority priority, Task task);
+
+    Strand& GetStrand() noexcept {
+        return strand_;
+    }
+
+    WaitStats GetWaitStats(Priority priority) const;
+
+private:
+    struct QueuedTask {
+        Task task;
+        Clock::time_point enqueued;
+    };
+
+    constexpr static size_t PRIORITY_COUNT = 2;
+
+    Strand& strand_;
+
+    mutable std::mutex mutex_;
+    std::array<std::deque<QueuedTask>, PRIORITY_COUNT> queues_;
+    std::array<WaitStats, PRIORITY_COUNT> stats_;
+
+    void RunNext();
+};
+
+// {"count", "avgWaitUs", "maxWaitUs", "lastWaitUs"}, как в журнале при остановке сервера
+void WriteWaitStats(json_writer::JsonWriter& writer, const PriorityStrand::WaitStats& stats);
+
+} // namespace priority_strand
@@ -0,0 +1,150 @@
+#include "rate_limiter.h"
+
+#include <algorithm>
+#include <charconv>
+#include <functional>
+
+namespace rate_limiter {
+
+using namespace std::literals;
+
+void RateLimits::SetRouteBudget(std::string path, RouteBudget budget) {
+    for (auto& [route_path, route_budget] : routes_) {
+        if (route_path == path) {
+            route_budget = budget;
+            return;
+        }
+    }
+    routes_.emplace_back(std::move(path), budget);
+}
+
+std::pair<size_t, const RouteBudget&> RateLimits::Find(std::string_view target) const {
+    std::string_view path = target.substr(0, target.find('?'));
+    for (size_t i = 0; i < routes_.size(); ++i) {
+        if (routes_[i].first == path) {
+            return {i, routes_[i].second};
+        }
+    }
+    return {routes_.size(), default_budget_};
+}
+
+bool ParseRateLimit(std::string_view spec, Scope scope, RateLimits& limits) {
+    auto read_number = [](std::string_view text, double& value) {
+        auto [end, ec] = std::from_chars(text.data(), text.data() + text.size(), value);
+        return ec == std::errc{} && end == text.data() + text.size() && value >= 0.;
+    };
+
+    auto eq = spec.rfind('=');
+    if (eq == std::string_view::npos || (!spec.starts_with('/') && spec.substr(0, eq) != "*"sv)) {
+        return false;
+    }
+
+    std::string_view path = spec.substr(0, eq);
+    RouteBudget budget = limits.Find(path == "*"sv ? ""sv : path).second;
+    Budget& scoped = scope == Scope::token ? budget.per_token : budget.per_ip;
+    std::string_view values = spec.substr(eq + 1);
+    auto colon = values.find(':');
+    if (!read_number(values.substr(0, colon), scoped.rate)) {
+        return false;
+    }
+    // без явного значения подряд можно сделать запросы за одну секунду
+    scoped.burst = std::max(1., scoped.rate);
+    if (colon != std::string_view::npos && (!read_number(values.substr(colon + 1), scoped.burst) || scoped.burst < 1.)) {
+        return false;
+    }
+
+    if (path == "*"sv) {
+        limits.SetDefaultBudget(budget);
+    } else {
+        limits.SetRouteBudget(std::string{path}, budget);
+    }
+    return true;
+}
+
+RateLimiter::Decision RateLimiter::Admit(std::string_view target, std::string_view token, std::string_view ip,
+                                         Clock::time_point now) {
+    auto [route, budget] = limits_.Find(target);
+
+    auto deny = [](Clock::duration wait) {
+        auto seconds = std::chrono::ceil<std::chrono::seconds>(wait);
+        return Decision{false, std::max(seconds, 1s)};
+    };
+
+    std::uint64_t ip_key = 0;
+    if (budget.per_ip.IsLimited()) {
+        ip_key = MakeKey(Scope::ip, route, ip);
+        if (auto wait = Take(ip_key, budget.per_ip, now); wait != Clock::duration::zero()) {
+            return deny(wait);
+        }
+    }
+    if (!token.empty() && budget.per_token.IsLimited()) {
+        if (auto wait = Take(MakeKey(Scope::token, route, token), budget.per_token, now);
+            wait != Clock::duration::zero()) {
+            // отклонённый запрос не расходует бюджет адреса
+            if (budget.per_ip.IsLimited()) {
+                Refund(ip_key, budget.per_ip);
+            }
+            return deny(wait);
+        }
+    }
+    return {};
+}
+
+size_t RateLimiter::GetBucketCount() const {
+    size_t count = 0;
+    for (const auto& shard : shards_) {
+        std::lock_guard lock{shard.mutex};
+        count += shard.buckets.size();
+    }
+    return count;
+}
+
+std::uint64_t RateLimiter::MakeKey(Scope scope, size_t route, std::string_view value) {
+    std::uint64_t hash = std::hash<std::string_view>{}(value);
+    std::uint64_t salt = route * 2 + (scope == Scope::token ? 1 : 0);
+    return hash ^ (salt + 0x9e3779b97f4a7c15ull + (hash << 6) + (hash >> 2));
+}
+
+RateLimiter::Clock::duration RateLimiter::Take(std::uint64_t key, const Budget& budget, Clock::time_point now) {
+    using Seconds = std::chrono::duration<double>;
+
+    Shard& shard = shards_[key % SHARD_COUNT];
+    std::lock_guard lock{shard.mutex};
+
+    auto it = shard.buckets.find(key);
+    if (it == shard.buckets.end()) {
+        if (shard.buckets.size() >= SWEEP_THRESHOLD && now >= shard.next_sweep) {
+            std::erase_if(shard.buckets, [now](const auto& item) {
+                return item.second.full_at <= now;
+            });
+            shard.next_sweep = now + SWEEP_INTERVAL;
+        }
+        it = shard.buckets.emplace(key, Bucket{budget.burst, now, now}).first;
+    }
+
+    Bucket& bucket = it->second;
+    double elapsed = std::chrono::duration_cast<Seconds>(now - bucket.updated).count();
+    bucket.tokens = std::min(budget.burst, bucket.tokens + std::max(0., elapsed) * budget.rate);
+    bucket.updated = std::max(bucket.updated, now);
+
+    Clock::duration wait = Clock::duration::zero();
+    if (bucket.tokens >= 1.) {
+        bucket.tokens -= 1.;
+    } else {
+        wait = std::chrono::duration_cast<Clock::duration>(Seconds{(1. - bucket.tokens) / budget.rate});
+        wait = std::max(wait, Clock::duration{1});
+    }
+    bucket.full_at = bucket.updated
+        + std::chrono::duration_cast<Clock::duration>(Seconds{(budget.burst - bucket.tokens) / budget.rate});
+    return wait;
+}
+
+void RateLimiter::Refund(std::uint64_t key, const Budget& budget) {
+    Shard& shard = shards_[key % SHARD_COUNT];
+    std::lock_guard lock{shard.mutex};
+    if (auto it = shard.buckets.find(key); it != shard.buckets.end()) {
+        it->second.tokens = std::min(budget.burst, it->second.tokens + 1.);
+    }
+}
+
+} // namespace rate_limiter
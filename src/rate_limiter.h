@@ -0,0 +1,124 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace rate_limiter {
+
+struct Budget {
+    // запросов в секунду; 0 - без ограничения
+    double rate = 0.;
+    // сколько запросов подряд можно сделать после простоя
+    double burst = 1.;
+
+    bool IsLimited() const noexcept {
+        return rate > 0.;
+    }
+};
+
+// бюджеты маршрута для одного токена игрока и для одного адреса клиента
+struct RouteBudget {
+    Budget per_token;
+    Budget per_ip;
+};
+
+/*
+ * Бюджеты запросов по пути (без query). Остальные пути делят общие корзины с бюджетом по умолчанию.
+ */
+class RateLimits {
+public:
+    explicit RateLimits(RouteBudget default_budget = {})
+        : default_budget_(default_budget) {
+    }
+
+    void SetDefaultBudget(RouteBudget budget) noexcept {
+        default_budget_ = budget;
+    }
+
+    void SetRouteBudget(std::string path, RouteBudget budget);
+
+    // номер маршрута разделяет корзины разных маршрутов; у бюджета по умолчанию он равен числу маршрутов
+    std::pair<size_t, const RouteBudget&> Find(std::string_view target) const;
+
+private:
+    RouteBudget default_budget_;
+    // маршрутов с отдельными бюджетами немного, линейный поиск быстрее хеширования
+    std::vector<std::pair<std::string, RouteBudget>> routes_;
+};
+
+enum class Scope {
+    token,
+    ip
+};
+
+// "<путь>=<запросов в секунду>[:<подряд>]", путь "*" - бюджет по умолчанию
+bool ParseRateLimit(std::string_view spec, Scope scope, RateLimits& limits);
+
+/*
+ * Корзины маркеров по токену игрока и по адресу клиента. Вызывается в потоках ввода-вывода до передачи
+ * запроса на strand игры, поэтому корзины разбиты на части под своими мьютексами. Корзина, которая
+ * успела снова наполниться, ничего не помнит и удаляется, когда корзин в части становится много.
+ * Новый ключ добавляет узел в хеш-таблицу части, а перебор части для удаления корзин идёт
+ * не чаще раза в SWEEP_INTERVAL, иначе поток новых (например, выдуманных) токенов перебирал бы её
+ * под мьютексом на каждом запросе.
+ */
+class RateLimiter {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    constexpr static size_t SHARD_COUNT = 16;
+    constexpr static size_t SWEEP_THRESHOLD = 4096;
+    constexpr static Clock::duration SWEEP_INTERVAL = std::chrono::seconds{1};
+
+    struct Decision {
+        bool allowed = true;
+        // для Retry-After, не меньше секунды
+        std::chrono::seconds retry_after{0};
+    };
+
+    explicit RateLimiter(RateLimits limits)
+        : limits_(std::move(limits)) {
+    }
+
+    RateLimiter(const RateLimiter&) = delete;
+    RateLimiter& operator=(const RateLimiter&) = delete;
+
+    // пустой token - запрос без токена, ограничивается только по адресу
+    Decision Admit(std::string_view target, std::string_view token, std::string_view ip,
+                   Clock::time_point now = Clock::now());
+
+    size_t GetBucketCount() const;
+
+private:
+    struct Bucket {
+        double tokens = 0.;
+        Clock::time_point updated;
+        // после этого момента корзина полна и её можно забыть
+        Clock::time_point full_at;
+    };
+
+    struct Shard {
+        mutable std::mutex mutex;
+        // ключ - хеш области, маршрута и значения; совпадение хешей лишь объединяет две корзины
+        std::unordered_map<std::uint64_t, Bucket> buckets;
+        Clock::time_point next_sweep{};
+    };
+
+    RateLimits limits_;
+    std::array<Shard, SHARD_COUNT> shards_;
+
+    static std::uint64_t MakeKey(Scope scope, size_t route, std::string_view value);
+    // 0 - запрос допущен, иначе через сколько в корзине появится маркер
+    Clock::duration Take(std::uint64_t key, const Budget& budget, Clock::time_point now);
+    void Refund(std::uint64_t key, const Budget& budget);
+};
+
+} // namespace rate_limiter
@@ -1,57 +1,6 @@
 #include "request_handler.h"
 
-namespace extra_data {
-void tag_invoke(json::value_from_tag, json::value& jv, const LootType& loot_type) {
-    jv = {loot_type.loot_info};
-}
-} // namespace extra_data
-
-namespace model {
-
-namespace json = boost::json;
-
-void tag_invoke(json::value_from_tag, json::value& jv, const Building& building) {
-    auto bounds = building.GetBounds();
-    jv = {
-        {"x", bounds.position.x}, {"y", bounds.position.y},
-        {"w", bounds.size.width}, {"h", bounds.size.height}
-    };
-}
-
-void tag_invoke(json::value_from_tag, json::value& jv, const Office& office) {
-    auto position = office.GetPosition();
-    auto offset = office.GetOffset();
-    jv = {
-        {"id", *office.GetId()}, {"x", position.x}, {"y", position.y},
-        {"offsetX", offset.dx}, {"offsetY", offset.dy}
-    };
-}
-
-void tag_invoke(json::value_from_tag, json::value& jv, const model::Road& road) {
-    auto start = road.GetStart();
-    auto end = road.GetEnd();
-    if (road.IsVertical()) {
-        jv = {
-            {"x0", start.x}, {"y0", start.y}, {"y1", end.y}
-        };
-    } else {
-        jv = {
-            {"x0", start.x}, {"y0", start.y}, {"x1", end.x}
-        };
-    }
-}
-
-void tag_invoke(json::value_from_tag, json::value& jv, const model::Map& map) {
-    jv = {
-        {"id", *map.GetId()},
-        {"name", map.GetName()},
-        {"roads", json::value_from(map.GetRoads())},
-        {"buildings", json::value_from(map.GetBuildings())},
-        {"offices", json::value_from(map.GetOffices())},
-        {"lootTypes", json::value_from(map.GetLootTypes())}
-    };
-}
-} // namespace model
+#include "json_writer.h"
 
 namespace http_handler {
 
@@ -155,6 +104,27 @@ std::string Uri::EncodeUri(std::string_view uri) const {
     return encoded_uri;
 }
 
+http_server::RequestLimits MakeRequestLimits() {
+    http_server::RequestLimits limits;
+    limits.SetRouteLimit("/api/v1/game/player/action"s, {.max_body = 256, .max_header = 4 * 1024});
+    limits.SetRouteLimit("/api/v1/game/join"s, {.max_body = 1024, .max_header = 4 * 1024});
+    limits.SetRouteLimit("/api/v1/game/tick"s, {.max_body = 256, .max_header = 4 * 1024});
+    return limits;
+}
+
+rate_limiter::RateLimits MakeRateLimits() {
+    // за одним адресом (NAT) может быть много игроков, поэтому бюджет адреса больше бюджета токена
+    rate_limiter::RateLimits limits{{.per_token = {.rate = 50., .burst = 100.}, .per_ip = {.rate = 500., .burst = 1000.}}};
+    // опрос состояния раз в тик и повторы после обрыва
+    limits.SetRouteBudget("/api/v1/game/state"s,
+                          {.per_token = {.rate = 30., .burst = 60.}, .per_ip = {.rate = 300., .burst = 600.}});
+    limits.SetRouteBudget("/api/v1/game/player/action"s,
+                          {.per_token = {.rate = 50., .burst = 100.}, .per_ip = {.rate = 500., .burst = 1000.}});
+    // вход создаёт игрока, токена у запроса ещё нет
+    limits.SetRouteBudget("/api/v1/game/join"s, {.per_ip = {.rate = 5., .burst = 20.}});
+    return limits;
+}
+
 std::string_view GetMimeType(Extention extention) {
     if (extention == Extention::htm
         || extention == Extention::html) return ContentType::TXT_HTML;
@@ -179,7 +149,58 @@ std::string_view GetMimeType(Extention extention) {
 }
 
 std::string ParseMapToJson(const model::Map* map) {
-    return json::serialize(json::value_from(*map));
+    std::string body;
+    json_writer::JsonWriter writer{body};
+
+    writer.BeginObject()
+        .Key("id"sv).String(*map->GetId())
+        .Key("name"sv).String(map->GetName());
+
+    writer.Key("roads"sv).BeginArray();
+    for (const model::Road& road : map->GetRoads()) {
+        auto start = road.GetStart();
+        auto end = road.GetEnd();
+        writer.BeginObject().Key("x0"sv).Int(start.x).Key("y0"sv).Int(start.y);
+        if (road.IsVertical()) {
+            writer.Key("y1"sv).Int(end.y);
+        } else {
+            writer.Key("x1"sv).Int(end.x);
+        }
+        writer.EndObject();
+    }
+    writer.EndArray();
+
+    writer.Key("buildings"sv).BeginArray();
+    for (const model::Building& building : map->GetBuildings()) {
+        const auto& bounds = building.GetBounds();
+        writer.BeginObject()
+            .Key("x"sv).Int(bounds.position.x).Key("y"sv).Int(bounds.position.y)
+            .Key("w"sv).Int(bounds.size.width).Key("h"sv).Int(bounds.size.height)
+            .EndObject();
+    }
+    writer.EndArray();
+
+    writer.Key("offices"sv).BeginArray();
+    for (const model::Office& office : map->GetOffices()) {
+        auto position = office.GetPosition();
+        auto offset = office.GetOffset();
+        writer.BeginObject()
+            .Key("id"sv).String(*office.GetId())
+            .Key("x"sv).Int(position.x).Key("y"sv).Int(position.y)
+            .Key("offsetX"sv).Int(offset.dx).Key("offsetY"sv).Int(offset.dy)
+            .EndObject();
+    }
+    writer.EndArray();
+
+    // описания типов трофеев приходят из конфига как есть
+    writer.Key("lootTypes"sv).BeginArray();
+    for (const extra_data::LootType& loot_type : map->GetLootTypes()) {
+        writer.Raw(json::serialize(loot_type.loot_info));
+    }
+    writer.EndArray();
+
+    writer.EndObject();
+    return body;
 }
 
 std::unordered_map<std::string, std::string> ParseQuery(std::string_view query) {
@@ -200,132 +221,138 @@ std::unordered_map<std::string, std::string> ParseQuery(std::string_view query)
     return query_map;
 }
 
-void ApiRequestHandler::ProcessApiMaps(StringResponse& response,
-                                       std::string_view target) const {
-    size_t target_legth = 12;
-    if (target.size() > target_legth && target[target_legth] != '/') {
-        MakeErrorApiResponse(response, ApiRequestHandler::ErrorCode::bad_request, "Bad request");
-        return;
+void ApiRequestHandler::ProcessApiMaps(StringResponse& response) const {
+    response.body().clear();
+    json_writer::JsonWriter writer{response.body()};
+    writer.BeginArray();
+    for (const auto& map : app_.ListMaps()) {
+        writer.BeginObject().Key("id"sv).String(*map.GetId()).Key("name"sv).String(map.GetName()).EndObject();
     }
+    writer.EndArray();
 
-    if (target.size() > target_legth +1) {
-        std::string map_name(target.begin() + target_legth + 1,
-            *(target.end() - 1) == '/' ? target.end() - 1 : target.end());
-
-        try {
-            const model::Map* map = app_.FindMap(model::Map::Id(map_name));
-            response.body() = ParseMapToJson(map);
-        } catch (const app::GetMapError& error) {
-            switch (error.reason) {
-                case app::GetMapErrorReason::mapNotFound:
-                    MakeErrorApiResponse(response, ApiRequestHandler::ErrorCode::map_not_found, error.what());
-                    return;
-            }
-        }
-    } else {
-        json::array maps_json;
-        const model::Game::Maps& maps = app_.ListMaps();
-        for (const auto& map : maps) {
-            maps_json.push_back({
-                {"id", *map.GetId()}, {"name", map.GetName()}
-                                });
-        }
-        response.body() = json::serialize(json::value(std::move(maps_json)));
+    response.set(http::field::content_type, ContentType::APP_JSON);
+    response.content_length(response.body().size());
+    response.result(http::status::ok);
+}
+
+void ApiRequestHandler::ProcessApiTickMetrics(StringResponse& response) const {
+    response.body().clear();
+    json_writer::JsonWriter writer{response.body()};
+    writer.BeginObject();
+    tick_profiler::WriteProfileFields(writer, app_.GetTickProfiler());
+    // счётчики тикера меняются только на strand игры, на котором выполняется и этот запрос
+    if (ticker_ != nullptr) {
+        writer.Key("ticker"sv);
+        tick::WriteStats(writer, ticker_->GetStats());
     }
+    if (queue_ != nullptr) {
+        writer.Key("queueWait"sv).BeginObject().Key("tick"sv);
+        priority_strand::WriteWaitStats(writer, queue_->GetWaitStats(priority_strand::Priority::high));
+        writer.Key("api"sv);
+        priority_strand::WriteWaitStats(writer, queue_->GetWaitStats(priority_strand::Priority::normal));
+        writer.EndObject();
+    }
+    writer.EndObject();
 
     response.set(http::field::content_type, ContentType::APP_JSON);
     response.content_length(response.body().size());
     response.result(http::status::ok);
 }
 
+void ApiRequestHandler::ProcessApiMap(StringResponse& response, const std::string& map_id) const {
+    try {
+        const model::Map* map = app_.FindMap(model::Map::Id(map_id));
+        response.body() = ParseMapToJson(map);
+    } catch (const app::GetMapError& error) {
+        switch (error.reason) {
+            case app::GetMapErrorReason::mapNotFound:
+                MakeErrorApiResponse(response, ApiRequestHandler::ErrorCode::map_not_found, error.what());
+                return;
+        }
+    }
 
+    response.set(http::field::content_type, ContentType::APP_JSON);
+    response.content_length(response.body().size());
+    response.result(http::status::ok);
+}
+
+StateResponse ApiRequestHandler::MakeGameStateResponse(StringResponse&& string_response, std::string_view token,
+                                                     std::optional<std::uint64_t> since_version,
+                                                     snapshot::Encoding encoding) const {
+    StateResponse response{std::move(string_response.base())};
+    response.body() = since_version ? app_.GetGameStateDelta(token, *since_version, encoding)
+                                    : app_.GetGameStateSnapshot(token, encoding);
+
+    // версия для следующего запроса с waitFor или since
+    response.set("X-Game-State-Version", std::to_string(app_.GetPlayerGameSession(token)->GetVersion()));
+    response.set(http::field::content_type, encoding == snapshot::Encoding::binary ? ContentType::APP_BINARY
+                                                                                   : ContentType::APP_JSON);
+    response.content_length(SnapshotBody::size(response.body()));
+    response.result(http::status::ok);
+    return response;
+}
 
 void ApiRequestHandler::MakeErrorApiResponse(StringResponse& response, ApiRequestHandler::ErrorCode code,
                                              std::string_view message) const {
     using ec = ApiRequestHandler::ErrorCode;
     response.set(http::field::content_type, ContentType::APP_JSON);
 
+    std::string_view error_code;
     switch (code) {
         case ec::map_not_found:
-        {
             response.result(http::status::not_found);
-            json::value jv = {
-                {"code", "mapNotFound"},
-                {"message", message}
-            };
-            response.body() = json::serialize(jv);
+            error_code = "mapNotFound"sv;
             break;
-        }
 
         case ec::invalid_method_get_head:
-        {
             response.result(http::status::method_not_allowed);
-            json::value jv = {
-                {"code", "invalidMethod"},
-                {"message", message}
-            };
-            response.body() = json::serialize(jv);
+            error_code = "invalidMethod"sv;
             response.set(http::field::allow, "GET, HEAD");
             break;
-        }
 
         case ec::invalid_method_post:
-        {
             response.result(http::status::method_not_allowed);
-            json::value jv = {
-                {"code", "invalidMethod"},
-                {"message", message}
-            };
-            response.body() = json::serialize(jv);
+            error_code = "invalidMethod"sv;
             response.set(http::field::cache_control, "no-cache");
             response.set(http::field::allow, "POST");
             break;
-        }
 
         case ec::bad_request:
-        {
             response.result(http::status::bad_request);
-            json::value jv = {
-                {"code", "badRequest"},
-                {"message", message}
-            };
-            response.body() = json::serialize(jv);
+            error_code = "badRequest"sv;
             break;
-        }
 
         case ec::invalid_token:
-        {
             response.result(http::status::unauthorized);
-            json::value jv = {
-                {"code", "invalidToken"},
-                {"message", message}
-            };
-            response.body() = json::serialize(jv);
+            error_code = "invalidToken"sv;
             break;
-        }
 
         case ec::invalid_argument:
-        {
             response.result(http::status::bad_request);
-            json::value jv = {
-                {"code", "invalidArgument"},
-                {"message", message}
-            };
-            response.body() = json::serialize(jv);
+            error_code = "invalidArgument"sv;
             break;
-        }
 
         case ec::unknown_token:
-        {
             response.result(http::status::unauthorized);
-            json::value jv = {
-                {"code", "unknownToken"},
-                {"message", message}
-            };
-            response.body() = json::serialize(jv);
+            error_code = "unknownToken"sv;
+            break;
+
+        case ec::too_many_requests:
+            response.result(http::status::too_many_requests);
+            error_code = "tooManyRequests"sv;
+            response.set(http::field::retry_after, "1");
+            break;
+
+        case ec::service_unavailable:
+            response.result(http::status::service_unavailable);
+            error_code = "serviceUnavailable"sv;
+            response.set(http::field::retry_after, "1");
             break;
-        }
     }
+
+    response.body().clear();
+    json_writer::JsonWriter writer{response.body()};
+    writer.BeginObject().Key("code"sv).String(error_code).Key("message"sv).String(message).EndObject();
     response.content_length(response.body().size());
 }
 
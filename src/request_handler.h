@@ -2,22 +2,36 @@
 
 #include <boost/json.hpp>
 #include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/steady_timer.hpp>
 #include <boost/asio/strand.hpp>
 
+#include "api_router.h"
 #include "app.h"
+#include "game_state_binary.h"
 #include "http_server.h"
+#include "json_writer.h"
 #include "logger.h"
 #include "model.h"
 #include "player.h"
+#include "priority_strand.h"
+#include "rate_limiter.h"
+#include "spectator_broadcast.h"
+#include "event_stream_session.h"
+#include "state_stream.h"
+#include "ticker.h"
+#include "websocket_session.h"
 
 #include <algorithm>
 #include <cassert>
+#include <chrono>
 #include <filesystem>
+#include <functional>
 #include <iomanip>
 #include <memory>
 #include <optional>
 #include <string_view>
 #include <unordered_map>
+#include <utility>
 
 namespace http_handler {
 
@@ -26,6 +40,7 @@ namespace net = boost::asio;
 namespace beast = boost::beast;
 namespace http = beast::http;
 namespace json = boost::json;
+namespace websocket = beast::websocket;
 
 using Strand = net::strand<net::io_context::executor_type>;
 
@@ -81,99 +96,330 @@ void FillBasicInfo(Request& req, Response& response) {
     response.keep_alive(req.keep_alive());
 }
 
+// соединение может отдать ответ с уже выделенной памятью под тело
+template <typename Send>
+http::response<http::string_body> MakeStringResponse(const Send& send) {
+    if constexpr (requires { send.TakeResponse(); }) {
+        return send.TakeResponse();
+    } else {
+        return {};
+    }
+}
+
 std::string_view GetMimeType(Extention extention);
+// лимиты размера запросов API по умолчанию: тела действий и входа в игру - короткие JSON
+http_server::RequestLimits MakeRequestLimits();
+// бюджеты частоты запросов API по умолчанию
+rate_limiter::RateLimits MakeRateLimits();
 std::string ParseMapToJson(const model::Map* map);
 std::unordered_map<std::string, std::string> ParseQuery(std::string_view query);
 
+using QueryParams = std::unordered_map<std::string, std::string>;
+
+// false, если параметр передан, но не разбирается как T; отсутствующий параметр не меняет value
+template <typename T>
+bool ReadQueryParam(const QueryParams& params, const std::string& name, T& value) {
+    auto it = params.find(name);
+    if (it == params.end()) {
+        return true;
+    }
+    auto parsed = api_router::ParseParam<T>(it->second);
+    if (!parsed) {
+        return false;
+    }
+    value = std::move(*parsed);
+    return true;
+}
+
+template <typename T>
+bool ReadQueryParam(const QueryParams& params, const std::string& name, std::optional<T>& value) {
+    T parsed{};
+    if (!params.contains(name)) {
+        return true;
+    }
+    if (!ReadQueryParam(params, name, parsed)) {
+        return false;
+    }
+    value = std::move(parsed);
+    return true;
+}
+
+template <typename Request>
+QueryParams GetQueryParams(const Request& request) {
+    std::string_view target = request.target();
+    if (size_t delim_params = target.find('?'); delim_params != std::string_view::npos) {
+        return ParseQuery(target.substr(delim_params + 1));
+    }
+    return {};
+}
+
+template <typename Request>
+bool IsBinaryRequested(const Request& request, const QueryParams& params) {
+    using namespace std::literals;
+
+    if (auto it = params.find("format"s); it != params.end()) {
+        return it->second == "binary"sv;
+    }
+    std::string_view accept = request[http::field::accept];
+    return accept.find(ContentType::APP_BINARY) != std::string_view::npos;
+}
+
 using StringResponse = http::response<http::string_body>;
 using FileResponse = http::response<http::file_body>;
 
+// тело ответа ссылается на общий буфер снимка состояния и не копирует его
+struct SnapshotBody {
+    using value_type = snapshot::Buffer;
+
+    static std::uint64_t size(const value_type& body) {
+        return body ? body->size() : 0;
+    }
+
+    class writer {
+    public:
+        using const_buffers_type = net::const_buffer;
+
+        template <bool isRequest, typename Fields>
+        writer([[maybe_unused]] const http::header<isRequest, Fields>& header, const value_type& body)
+            : body_(body) {
+        }
+
+        void init(beast::error_code& ec) {
+            ec = {};
+        }
+
+        boost::optional<std::pair<const_buffers_type, bool>> get(beast::error_code& ec) {
+            ec = {};
+            if (!body_) {
+                return boost::none;
+            }
+            return {{net::buffer(*body_), false}};
+        }
+
+    private:
+        const value_type& body_;
+    };
+};
+
+using StateResponse = http::response<SnapshotBody>;
+
+// всё, что нужно соединениям, которые после апгрейда получают кадры состояния
+struct StreamingContext {
+    Strand& game_strand;
+    state_stream::StateHub& state_hub;
+    state_stream::SpectatorBroadcaster& spectators;
+};
+
 class ApiRequestHandler : public std::enable_shared_from_this<ApiRequestHandler> {
 public:
+    // действий в одном пакетном запросе
+    constexpr static size_t MAX_BATCH_SIZE = 10'000;
 
-    explicit ApiRequestHandler(app::Application& app, bool manual_update)
+    // queue - очередь strand игры, её время ожидания попадает в /api/v1/admin/tick-metrics
+    ApiRequestHandler(app::Application& app, StreamingContext streaming, bool manual_update,
+                      const priority_strand::PriorityStrand* queue = nullptr)
         : app_(app)
-        , manual_update_(manual_update) {
+        , streaming_(streaming)
+        , manual_update_(manual_update)
+        , queue_(queue) {
     }
 
     ApiRequestHandler(const ApiRequestHandler&) = delete;
     ApiRequestHandler& operator=(const ApiRequestHandler&) = delete;
 
+    // тикер создаётся после обработчика, до начала приёма соединений; без него тики ручные
+    void SetTicker(const tick::Ticker* ticker) {
+        ticker_ = ticker;
+    }
+
     template <typename Request, typename Send>
     void operator() (Request&& req, Send&& send) {
         SendApiResponse(std::forward<Request>(req), std::forward<Send>(send), req.target());
     }
 
+    // запросу не нужен strand игры: действие игрока только ставится в очередь сессии
+    bool CanHandleOffStrand(std::string_view target) const {
+        if (manual_update_) {
+            return false;
+        }
+        auto match = api_router::API_ROUTER.Match(api_router::SplitTarget(target).first);
+        return match && match->route == api_router::Route::action;
+    }
+
+    // токен для ограничения частоты, без проверки, что игрок существует; пусто, если заголовка нет или он неверный
+    template <typename Request>
+    std::string_view PeekToken(const Request& request) const {
+        if (!request.count(http::field::authorization)) {
+            return {};
+        }
+        try {
+            return GetRawTokenValue(request);
+        } catch (const ErrorCode) {
+            return {};
+        }
+    }
+
+    template <typename Request, typename Send>
+    void SendTooManyRequests(const Request& req, Send&& send, std::chrono::seconds retry_after) const {
+        using namespace std::literals;
+
+        StringResponse response = MakeStringResponse(send);
+        FillBasicInfo(req, response);
+        response.set(http::field::cache_control, "no-cache");
+        MakeErrorApiResponse(response, ErrorCode::too_many_requests, "Too many requests"sv);
+        response.set(http::field::retry_after, std::to_string(retry_after.count()));
+        send(response);
+    }
+
+    // вызывается на strand игры: WebSocket или text/event-stream
+    void Upgrade(http::request<http::string_body>&& req, beast::tcp_stream&& stream,
+                 state_stream::Connection&& connection) {
+        using namespace std::literals;
+
+        StringResponse response;
+        FillBasicInfo(req, response);
+        response.set(http::field::cache_control, "no-cache");
+
+        auto reject = [&](ErrorCode code, std::string_view message) {
+            MakeErrorApiResponse(response, code, message);
+            state_stream::RejectUpgrade(std::move(stream), std::move(connection), std::move(response));
+        };
+
+        auto match = api_router::API_ROUTER.Match(api_router::SplitTarget(req.target()).first);
+        bool is_websocket = websocket::is_upgrade(req);
+        if (!match || is_websocket != (match->route == api_router::Route::websocket)
+            || (!is_websocket && match->route != api_router::Route::state_stream
+                && match->route != api_router::Route::spectate)) {
+            return reject(ErrorCode::bad_request, "Bad request"sv);
+        }
+
+        if (match->route == api_router::Route::spectate) {
+            // зрителю токен не нужен, достаточно существующей карты
+            model::Map::Id map_id{*api_router::GetPathParam<std::string>(*match, 0)};
+            try {
+                app_.FindMap(map_id);
+            } catch (const app::GetMapError& error) {
+                return reject(ErrorCode::map_not_found, error.what());
+            }
+            auto channel = streaming_.spectators.GetChannel(map_id);
+            std::make_shared<state_stream::SpectatorSession>(std::move(stream), std::move(connection),
+                                                             std::move(channel))
+                ->Run(req.version());
+            return;
+        }
+
+        QueryParams params = GetQueryParams(req);
+        state_stream::WebSocketSession::Options ws_options;
+        state_stream::EventStreamSession::Options sse_options;
+        if (is_websocket) {
+            ws_options.encoding = IsBinaryRequested(req, params) ? snapshot::Encoding::binary
+                                                                 : snapshot::Encoding::json;
+            ws_options.manual_update = manual_update_;
+            if (!ReadQueryParam(params, "every"s, ws_options.every_nth_tick) || ws_options.every_nth_tick == 0) {
+                return reject(ErrorCode::invalid_argument, "Invalid frame period"sv);
+            }
+        } else if (!ReadQueryParam(params, "fps"s, sse_options.max_fps)) {
+            return reject(ErrorCode::invalid_argument, "Invalid frame rate"sv);
+        }
+
+        // браузерные WebSocket и EventSource не умеют передавать заголовок Authorization,
+        // поэтому токен можно передать в запросе
+        std::string token;
+        if (auto it = params.find("token"s); it != params.end() && !req.count(http::field::authorization)) {
+            token = it->second;
+        } else {
+            try {
+                token = GetRawTokenValue(req);
+            } catch (const ErrorCode) {
+                return reject(ErrorCode::invalid_token, "Authorization header is required"sv);
+            }
+        }
+
+        if (!app_.IsTokenValid(token)) {
+            return reject(ErrorCode::unknown_token, "Player token has not been found"sv);
+        }
+
+        const model::GameSession* session = app_.GetPlayerGameSession(token);
+        if (is_websocket) {
+            std::make_shared<state_stream::WebSocketSession>(std::move(stream), std::move(connection), app_,
+                                                             streaming_.game_strand, streaming_.state_hub,
+                                                             std::move(token), session, ws_options)
+                ->Run(std::move(req));
+        } else {
+            std::make_shared<state_stream::EventStreamSession>(std::move(stream), std::move(connection),
+                                                               streaming_.game_strand, streaming_.state_hub,
+                                                               session, sse_options)->Run(req.version());
+        }
+    }
+
+    // сессии WebSocket, SSE и зрителей работают с TCP-соединением, через Unix-сокет прокси их не проводит
+    void Upgrade(http::request<http::string_body>&& req,
+                 beast::basic_stream<net::local::stream_protocol>&& stream, state_stream::Connection&& connection) {
+        using namespace std::literals;
+
+        StringResponse response;
+        FillBasicInfo(req, response);
+        response.set(http::field::cache_control, "no-cache");
+        MakeErrorApiResponse(response, ErrorCode::bad_request, "Streaming is served over TCP only"sv);
+        state_stream::RejectUpgrade(std::move(stream), std::move(connection), std::move(response));
+    }
+
 private:
+    // ожидание следующего тика в long-poll запросе состояния
+    constexpr static std::chrono::seconds LONG_POLL_TIMEOUT{25};
+
     app::Application& app_;
+    StreamingContext streaming_;
     bool manual_update_;
+    const priority_strand::PriorityStrand* queue_;
+    const tick::Ticker* ticker_ = nullptr;
 
     template <typename Request, typename Send>
     void SendApiResponse(Request&& req, Send&& send, std::string_view target) {
         using namespace std::literals;
 
-        StringResponse response;
+        StringResponse response = MakeStringResponse(send);
         FillBasicInfo(req, response);
         response.set(http::field::cache_control, "no-cache");
         try {
-
-            if (target.substr(0, 12) == "/api/v1/maps"sv) {
-                switch (req.method()) {
-                    case http::verb::get:
-                    case http::verb::head:
-                        ProcessApiMaps(response, target);
+            auto match = api_router::API_ROUTER.Match(api_router::SplitTarget(target).first);
+            if (!match) {
+                MakeErrorApiResponse(response, ApiRequestHandler::ErrorCode::bad_request, "Bad request"sv);
+            } else if (!match->IsMethodAllowed(req.method())) {
+                MakeErrorApiResponse(response, (match->methods & api_router::Method::POST)
+                                                   ? ApiRequestHandler::ErrorCode::invalid_method_post
+                                                   : ApiRequestHandler::ErrorCode::invalid_method_get_head,
+                                     "Invalid method"sv);
+            } else {
+                switch (match->route) {
+                    case api_router::Route::maps:
+                        ProcessApiMaps(response);
                         break;
-                    default:
-                        MakeErrorApiResponse(response, ApiRequestHandler::ErrorCode::invalid_method_get_head,
-                                             "Invalid method"sv);
+                    case api_router::Route::map:
+                        ProcessApiMap(response, *api_router::GetPathParam<std::string>(*match, 0));
                         break;
-                }
-            } else if (target.substr(0, 20) == "/api/v1/game/players"sv) {
-                switch (req.method()) {
-                    case http::verb::get:
-                    case http::verb::head:
-                        ProcessApiPlayers(req, response);
+                    case api_router::Route::tick_metrics:
+                        ProcessApiTickMetrics(response);
                         break;
-                    default:
-                        MakeErrorApiResponse(response, ApiRequestHandler::ErrorCode::invalid_method_get_head,
-                                             "Invalid method"sv);
+                    case api_router::Route::players:
+                        ProcessApiPlayers(req, response);
                         break;
-                }
-            } else if (target.substr(0, 17) == "/api/v1/game/join"sv) {
-                switch (req.method()) {
-                    case http::verb::post:
+                    case api_router::Route::join:
                         ProcessApiJoin(req, response);
                         break;
-                    default:
-                        MakeErrorApiResponse(response, ApiRequestHandler::ErrorCode::invalid_method_post,
-                                             "Only POST method is expected"sv);
-                        break;
-                }
-            } else if (target.substr(0, 18) == "/api/v1/game/state"sv) {
-                switch (req.method()) {
-                    case http::verb::get:
-                    case http::verb::head:
-                        ProcessApiGameState(req, response);
-                        break;
-                    default:
-                        MakeErrorApiResponse(response, ApiRequestHandler::ErrorCode::invalid_method_get_head,
-                                             "Invalid method"sv);
+                    case api_router::Route::state:
+                        if (ProcessApiGameState(req, response, send)) {
+                            // состояние уже отправлено или уйдёт после следующего тика
+                            return;
+                        }
                         break;
-                }
-            } else if (target.substr(0, 26) == "/api/v1/game/player/action"sv) {
-                switch (req.method()) {
-                    case http::verb::post:
+                    case api_router::Route::action:
                         ProcessApiAction(req, response);
                         break;
-
-                    default:
-                        MakeErrorApiResponse(response, ApiRequestHandler::ErrorCode::invalid_method_post,
-                                             "Invalid method"sv);
+                    case api_router::Route::batch:
+                        ProcessApiBatch(req, response);
                         break;
-                }
-            } else if (target.substr(0, 17) == "/api/v1/game/tick"sv) {
-                switch (req.method()) {
-                    case http::verb::post:
+                    case api_router::Route::tick:
                         if (manual_update_) {
                             ProcessApiTick(req, response);
                         } else {
@@ -181,25 +427,19 @@ private:
                                                  "Invalid endpoint"sv);
                         }
                         break;
-
-                    default:
-                        MakeErrorApiResponse(response, ApiRequestHandler::ErrorCode::invalid_method_post,
-                                             "Invalid method"sv);
-                        break;
-                }
-            } else if (target.substr(0, 20) == "/api/v1/game/records"sv) {
-                switch (req.method()) {
-                    case http::verb::get:
-                    case http::verb::head:
+                    case api_router::Route::records:
                         ProcessGetRecords(req, response);
                         break;
-                    default:
-                        MakeErrorApiResponse(response, ApiRequestHandler::ErrorCode::invalid_method_get_head,
-                                             "Invalid method"sv);
+                    case api_router::Route::state_stream:
+                    case api_router::Route::spectate:
+                        MakeErrorApiResponse(response, ApiRequestHandler::ErrorCode::bad_request,
+                                             "Accept: text/event-stream is required"sv);
+                        break;
+                    case api_router::Route::websocket:
+                        MakeErrorApiResponse(response, ApiRequestHandler::ErrorCode::bad_request,
+                                             "WebSocket upgrade is required"sv);
+                        break;
                 }
-            } else {
-                MakeErrorApiResponse(response, ApiRequestHandler::ErrorCode::bad_request,
-                                     "Bad request"sv);
             }
         } catch (...) {
             MakeErrorApiResponse(response, ApiRequestHandler::ErrorCode::bad_request,
@@ -210,19 +450,33 @@ private:
         send(response);
     }
 
-    void ProcessApiMaps(StringResponse& response, std::string_view target) const;
+    void ProcessApiMaps(StringResponse& response) const;
+    void ProcessApiMap(StringResponse& response, const std::string& map_id) const;
+    void ProcessApiTickMetrics(StringResponse& response) const;
 
     template <typename Request>
     void ProcessApiPlayers(Request& request, StringResponse& response) const {
+        using namespace std::literals;
+
+        bool binary = IsBinaryRequested(request, GetQueryParams(request));
 
-        ExecuteAuthorized(request, response, [self = shared_from_this(), &response](std::string_view token) {
+        ExecuteAuthorized(request, response, [self = shared_from_this(), &response, binary](std::string_view token) {
             const auto& players = self->app_.ListPlayers(token);
-            json::object players_on_map_json;
-            for (const auto& [id, player] : players) {
-                players_on_map_json[std::to_string(*id)] = {{"name", player->GetName()}};
+            if (binary) {
+                response.body() = snapshot::EncodePlayersBinary(players);
+                response.set(http::field::content_type, ContentType::APP_BINARY);
+                response.content_length(response.body().size());
+                response.result(http::status::ok);
+                return;
             }
 
-            response.body() = json::serialize(json::value(std::move(players_on_map_json)));
+            response.body().clear();
+            json_writer::JsonWriter writer{response.body()};
+            writer.BeginObject();
+            for (const auto& [id, player] : players) {
+                writer.Key(*id).BeginObject().Key("name"sv).String(player->GetName()).EndObject();
+            }
+            writer.EndObject();
 
             response.set(http::field::content_type, ContentType::APP_JSON);
             response.content_length(response.body().size());
@@ -230,10 +484,22 @@ private:
         });
     }
 
+    // раньше, чем уровень перегрузки может снизиться, повторять запрос нет смысла
+    void SetOverloadRetryAfter(StringResponse& response) const {
+        response.set(http::field::retry_after, std::to_string(app_.GetWatchdog().GetRetryAfter().count()));
+    }
+
     template <typename Request>
     void ProcessApiJoin(Request& request, StringResponse& response) {
         using namespace std::literals;
 
+        // новые игроки только добавили бы нагрузки
+        if (app_.GetWatchdog().IsAtLeast(overload::Level::shed_joins)) {
+            MakeErrorApiResponse(response, ErrorCode::service_unavailable, "Server is overloaded"sv);
+            SetOverloadRetryAfter(response);
+            return;
+        }
+
         boost::system::error_code ec;
         json::value request_body = json::parse(request.body(), ec);
         if (ec || !(request_body.if_object() && request_body.as_object().count("userName") 
@@ -248,12 +514,12 @@ private:
             
             auto join_result = app_.JoinGame(user_name, map_id);
 
-            json::value jv = {
-                {"authToken", *join_result.token},
-                {"playerId", *join_result.player_id}
-            };
-
-            response.body() = json::serialize(jv);
+            response.body().clear();
+            json_writer::JsonWriter writer{response.body()};
+            writer.BeginObject()
+                .Key("authToken"sv).String(*join_result.token)
+                .Key("playerId"sv).Uint(*join_result.player_id)
+                .EndObject();
 
         } catch (const app::JoinGameError& error) {
             switch (error.reason) {
@@ -271,50 +537,96 @@ private:
         response.result(http::status::ok);
     }
 
-    template <typename Request>
-    void ProcessApiGameState(Request& request, StringResponse& response) {
-
-        ExecuteAuthorized(request, response, [self = shared_from_this(), &response](std::string_view token) {
-            const auto& dogs = self->app_.ListPlayers(token);
-
-            json::object game_state_json;
-            game_state_json["players"].emplace_object();
-
-            for (const auto& [id, dog] : dogs) {
-                const geom::Point2D& pos = dog->GetPosition();
-                const geom::Vec2D& speed = dog->GetSpeed();
-
-                game_state_json["players"].as_object().insert_or_assign(std::to_string(*id), json::object{
-                    {"pos", {pos.x, pos.y}},
-                    {"speed", {speed.x, speed.y}},
-                    {"dir", model::DirectionToString(dog->GetDirection())},
-                    {"score", dog->GetScore()}
-                });
-
-                auto& player_obj = game_state_json["players"].as_object()[std::to_string(*id)].as_object();
-                auto& bag = player_obj["bag"].emplace_array();
-                for (const auto& loot : dog->GetBag()->GetAllLoot()) {
-                    bag.emplace_back(json::object{{"id", *loot.id},
-                        {"type", loot.type}});
-                }
-            }
+    // возвращает true, если ответ с состоянием отправлен сам или будет отправлен после тика
+    template <typename Request, typename Send>
+    bool ProcessApiGameState(Request& request, StringResponse& response, const Send& send) {
+        using namespace std::literals;
 
-            game_state_json["lostObjects"].emplace_object();
-            for (const auto& [id, loot_ptr] : self->app_.GetPlayerGameSession(token)->GetAllLoot()) {
-                game_state_json["lostObjects"].as_object().insert_or_assign(std::to_string(*id), json::object{
-                    {"type", loot_ptr->type},
-                    {"pos", {loot_ptr->point.x, loot_ptr->point.y}}
-                });
+        QueryParams params = GetQueryParams(request);
+        std::optional<std::uint64_t> since_version;
+        std::optional<std::uint64_t> wait_for_version;
+        if (!ReadQueryParam(params, "since"s, since_version) || !ReadQueryParam(params, "waitFor"s, wait_for_version)) {
+            MakeErrorApiResponse(response, ErrorCode::invalid_argument, "Invalid state version"sv);
+            return false;
+        }
+        auto encoding = IsBinaryRequested(request, params) ? snapshot::Encoding::binary : snapshot::Encoding::json;
+
+        // при перегрузке частый опрос вытесняется в long-poll и потоки состояния
+        const overload::Watchdog& watchdog = app_.GetWatchdog();
+        if (watchdog.IsAtLeast(overload::Level::shed_joins)) {
+            MakeErrorApiResponse(response, ErrorCode::service_unavailable, "Server is overloaded"sv);
+            SetOverloadRetryAfter(response);
+            return false;
+        }
+        if (!wait_for_version && watchdog.IsAtLeast(overload::Level::throttle_polls)) {
+            MakeErrorApiResponse(response, ErrorCode::too_many_requests,
+                                 "Server is overloaded, use waitFor or the state stream"sv);
+            SetOverloadRetryAfter(response);
+            return false;
+        }
+
+        bool sent = false;
+        ExecuteAuthorized(request, response, [self = shared_from_this(), &response, &send, &sent, since_version,
+                                              wait_for_version, encoding] (std::string_view token) {
+            const model::GameSession* session = self->app_.GetPlayerGameSession(token);
+            if (wait_for_version && session->GetVersion() <= *wait_for_version) {
+                self->ParkStateRequest(session, std::string{token}, since_version, encoding, std::move(response), send);
+            } else {
+                send(self->MakeGameStateResponse(std::move(response), token, since_version, encoding));
             }
+            sent = true;
+        });
+        return sent;
+    }
 
-            response.body() = json::serialize(json::value(std::move(game_state_json)));
+    // заголовки берутся из подготовленного строкового ответа, тело - общий буфер снимка
+    StateResponse MakeGameStateResponse(StringResponse&& response, std::string_view token,
+                                        std::optional<std::uint64_t> since_version, snapshot::Encoding encoding) const;
+
+    /*
+     * Long-poll: запрос не занимает поток, пока ждёт. Ответ отправляется один раз на strand игры -
+     * после следующего тика сессии или по таймауту с текущим состоянием.
+     */
+    template <typename Send>
+    void ParkStateRequest(const model::GameSession* session, std::string token,
+                          std::optional<std::uint64_t> since_version, snapshot::Encoding encoding,
+                          StringResponse&& response, const Send& send) {
+        using namespace std::literals;
 
-            response.set(http::field::content_type, ContentType::APP_JSON);
-            response.content_length(response.body().size());
-            response.result(http::status::ok);
+        auto timer = std::make_shared<net::steady_timer>(streaming_.game_strand);
+        auto answer = std::make_shared<std::function<void()>>(
+            [self = shared_from_this(), timer, token = std::move(token), since_version, encoding,
+             response = std::move(response), send]() mutable {
+                timer->cancel();
+                // игрок мог покинуть игру, пока запрос ждал
+                if (self->app_.IsTokenValid(token)) {
+                    send(self->MakeGameStateResponse(std::move(response), token, since_version, encoding));
+                    return;
+                }
+                self->MakeErrorApiResponse(response, ErrorCode::unknown_token, "Player token has not been found"sv);
+                send(response);
+            });
+
+        auto fire = [answer] {
+            if (auto callback = std::exchange(*answer, nullptr)) {
+                callback();
+            }
+        };
+        auto wait_id = streaming_.state_hub.WaitForUpdate(session, fire);
+        timer->expires_after(LONG_POLL_TIMEOUT);
+        timer->async_wait([self = shared_from_this(), session, wait_id, fire](beast::error_code ec) {
+            if (!ec) {
+                self->streaming_.state_hub.CancelWait(session, wait_id);
+                fire();
+            }
         });
     }
 
+    // при ручных тиках команда применяется сразу, иначе ждёт начала следующего тика в очереди сессии
+    bool ApplyMove(std::string_view token, std::string_view move) {
+        return manual_update_ ? app_.MoveDog(token, move) : app_.EnqueueMove(token, move);
+    }
+
     template <typename Request>
     void ProcessApiAction(Request& request, StringResponse& response) {
         using namespace std::literals;
@@ -331,9 +643,16 @@ private:
             boost::system::error_code ec;
 
             json::value request_body = json::parse(request.body(), ec);
-            if (ec || !(request_body.if_object() && request_body.as_object().count("move"))
-                   || !self->app_.MoveDog(token, request_body.as_object().at("move").as_string())) {
-                self->MakeErrorApiResponse(response, ErrorCode::invalid_argument, "Failed to parse action"sv);
+            const json::value* move = !ec && request_body.if_object() ? request_body.as_object().if_contains("move"sv)
+                                                                      : nullptr;
+            try {
+                if (!move || !move->is_string() || !self->ApplyMove(token, move->as_string())) {
+                    self->MakeErrorApiResponse(response, ErrorCode::invalid_argument, "Failed to parse action"sv);
+                    return;
+                }
+            } catch (const app::ListPlayersError&) {
+                // вне strand игрок мог покинуть игру сразу после проверки токена
+                self->MakeErrorApiResponse(response, ErrorCode::unknown_token, "Player token has not been found"sv);
                 return;
             }
 
@@ -345,6 +664,83 @@ private:
         });
     }
 
+    /*
+     * Пакет действий для ботов и нагрузочных тестов:
+     * {"actions": [{"token": "...", "move": "L"}, ...], "withState": true}.
+     * Все действия применяются за один вход в strand, ошибка одного действия не отменяет остальные.
+     * С withState в ответ добавляется состояние каждой затронутой сессии по id карты.
+     */
+    template <typename Request>
+    void ProcessApiBatch(Request& request, StringResponse& response) {
+        using namespace std::literals;
+
+        if (!request.count(http::field::content_type)) {
+            MakeErrorApiResponse(response, ErrorCode::invalid_argument, "Invalid content type"sv);
+            return;
+        }
+
+        boost::system::error_code ec;
+        json::value request_body = json::parse(request.body(), ec);
+        const json::object* batch = ec ? nullptr : request_body.if_object();
+        const json::value* actions_value = batch ? batch->if_contains("actions"sv) : nullptr;
+        const json::value* with_state_value = batch ? batch->if_contains("withState"sv) : nullptr;
+        const json::array* actions = actions_value ? actions_value->if_array() : nullptr;
+        const bool* with_state_flag = with_state_value ? with_state_value->if_bool() : nullptr;
+        if (!actions || actions->size() > MAX_BATCH_SIZE || (with_state_value && !with_state_flag)) {
+            MakeErrorApiResponse(response, ErrorCode::invalid_argument, "Failed to parse batch"sv);
+            return;
+        }
+        const bool with_state = with_state_flag && *with_state_flag;
+
+        // сессия и токен любого её игрока, по которому берётся состояние
+        std::vector<std::pair<const model::GameSession*, std::string_view>> sessions;
+        response.body().clear();
+        json_writer::JsonWriter writer{response.body()};
+        writer.BeginObject().Key("results"sv).BeginArray();
+        for (const json::value& action : *actions) {
+            const json::object* fields = action.if_object();
+            const json::value* token_value = fields ? fields->if_contains("token"sv) : nullptr;
+            const json::value* move_value = fields ? fields->if_contains("move"sv) : nullptr;
+            const json::string* token = token_value ? token_value->if_string() : nullptr;
+            const json::string* move = move_value ? move_value->if_string() : nullptr;
+
+            if (!token || !move) {
+                writer.BeginObject().Key("code"sv).String("invalidArgument"sv)
+                      .Key("message"sv).String("Failed to parse action"sv).EndObject();
+            } else if (!app_.IsTokenValid(*token)) {
+                writer.BeginObject().Key("code"sv).String("unknownToken"sv)
+                      .Key("message"sv).String("Player token has not been found"sv).EndObject();
+            } else if (!ApplyMove(*token, *move)) {
+                writer.BeginObject().Key("code"sv).String("invalidArgument"sv)
+                      .Key("message"sv).String("Failed to parse action"sv).EndObject();
+            } else {
+                writer.BeginObject().EndObject();
+                if (with_state) {
+                    const model::GameSession* session = app_.GetPlayerGameSession(*token);
+                    if (std::find_if(sessions.begin(), sessions.end(), [session](const auto& known) {
+                            return known.first == session;
+                        }) == sessions.end()) {
+                        sessions.emplace_back(session, *token);
+                    }
+                }
+            }
+        }
+        writer.EndArray();
+
+        if (with_state) {
+            writer.Key("states"sv).BeginObject();
+            for (const auto& [session, session_token] : sessions) {
+                writer.Key(*session->GetMap()->GetId()).Raw(*app_.GetGameStateSnapshot(session_token));
+            }
+            writer.EndObject();
+        }
+        writer.EndObject();
+
+        response.set(http::field::content_type, ContentType::APP_JSON);
+        response.content_length(response.body().size());
+        response.result(http::status::ok);
+    }
+
     template <typename Request>
     void ProcessApiTick(Request& request, StringResponse& response) {
         using namespace std::literals;
@@ -382,41 +778,39 @@ private:
     void ProcessGetRecords(Request& request, StringResponse& response) {
         using namespace std::literals;
 
-        auto target = request.target();
-        size_t delim_params = target.find('?');
-        auto params = ParseQuery(target.substr(delim_params + 1));
-
-        int start = 0;
-        if (params.contains("start"s)) {
-            start = std::stoi(params.at("start"s));
-        }
+        QueryParams params = GetQueryParams(request);
 
-        int max_items = 100;
-        if (params.contains("maxItems"s)) {
-            max_items = std::stoi(params.at("maxItems"s));
+        size_t start = 0;
+        size_t max_items = 100;
+        if (!ReadQueryParam(params, "start"s, start) || !ReadQueryParam(params, "maxItems"s, max_items)) {
+            MakeErrorApiResponse(response, ErrorCode::invalid_argument, "Invalid records range"sv);
+            return;
         }
 
         if (max_items > 100) {
             MakeErrorApiResponse(response, ErrorCode::bad_request, "Imposible to show more then 100 players on 1 list"sv);
+            return;
         }
 
-        json::array body;
+        response.body().clear();
+        json_writer::JsonWriter writer{response.body()};
+        writer.BeginArray();
 
         try {
             auto leaderboard = app_.GetLeaders(start, max_items);
             double second_multiplier = 1000.;
             for (const auto& player_info : leaderboard) {
-                body.push_back(json::object{
-                    {"name", player_info.GetName()},
-                    {"score", player_info.GetScore()},
-                    {"playTime", static_cast<double>(player_info.GetPlayTimeInMs()/second_multiplier)}
-                });
+                writer.BeginObject()
+                    .Key("name"sv).String(player_info.GetName())
+                    .Key("score"sv).Uint(player_info.GetScore())
+                    .Key("playTime"sv).Double(player_info.GetPlayTimeInMs() / second_multiplier)
+                    .EndObject();
             }
         } catch (const std::exception& e) {
-            body.push_back({"message", e.what()});
+            writer.BeginObject().Key("message"sv).String(e.what()).EndObject();
         }
 
-        response.body() = json::serialize(json::value(body));
+        writer.EndArray();
 
         response.set(http::field::content_type, ContentType::APP_JSON);
         response.content_length(response.body().size());
@@ -425,7 +819,8 @@ private:
 
     enum class ErrorCode {
         map_not_found, invalid_method_get_head, invalid_method_post,
-        invalid_argument, bad_request, invalid_token, unknown_token
+        invalid_argument, bad_request, invalid_token, unknown_token,
+        too_many_requests, service_unavailable
     };
 
     template <typename Request, typename Executor>
@@ -535,38 +930,68 @@ private:
 
 class RequestHandler : public std::enable_shared_from_this<RequestHandler> {
 public:
-    explicit RequestHandler(app::Application& app, net::io_context& ioc, Strand& api_strand,
-                            std::filesystem::path&& static_files_path, bool manual_update)
+    explicit RequestHandler(app::Application& app, net::io_context& ioc, priority_strand::PriorityStrand& api_strand,
+                            state_stream::StateHub& state_hub, state_stream::SpectatorBroadcaster& spectators,
+                            std::filesystem::path&& static_files_path, bool manual_update,
+                            rate_limiter::RateLimits rate_limits = {})
         : ioc_(ioc)
         , api_strand_(api_strand)
-        , api_handler_(std::make_shared<ApiRequestHandler>(app, manual_update))
-        , static_handler_(std::move(fs::canonical(static_files_path))) {
+        , streaming_{api_strand.GetStrand(), state_hub, spectators}
+        , api_handler_(std::make_shared<ApiRequestHandler>(app, streaming_, manual_update, &api_strand))
+        , static_handler_(std::move(fs::canonical(static_files_path)))
+        , rate_limiter_(std::move(rate_limits)) {
     }
 
     RequestHandler(const RequestHandler&) = delete;
     RequestHandler& operator=(const RequestHandler&) = delete;
 
+    void SetTicker(const tick::Ticker* ticker) {
+        api_handler_->SetTicker(ticker);
+    }
+
+    // запрос принадлежит соединению и не копируется: оно живо и не читает новый запрос, пока жив send
     template <typename Body, typename Allocator, typename Send>
-    void operator()(http::request<Body, http::basic_fields<Allocator>>&& req, Send&& send) {
+    void operator()(const http::request<Body, http::basic_fields<Allocator>>& req, std::string_view client_ip,
+                    Send&& send) {
         using namespace std::literals;
 
         std::string_view target = req.target();
         if (target.size() >= 4 && target.substr(0, 5) == "/api/"sv) {
-            net::dispatch(api_strand_, [self = shared_from_this(),
-                                       req = std::forward<decltype(req)>(req),
-                                       send = std::forward<Send>(send)]() {
+            // лишние запросы отклоняются в потоке соединения и не занимают strand игры
+            auto decision = rate_limiter_.Admit(target, api_handler_->PeekToken(req), client_ip);
+            if (!decision.allowed) {
+                api_handler_->SendTooManyRequests(req, std::forward<Send>(send), decision.retry_after);
+                return;
+            }
+            if (api_handler_->CanHandleOffStrand(target)) {
+                (*api_handler_)(req, send);
+                return;
+            }
+            // запросы ждут в обычной очереди и пропускают тики вперёд
+            api_strand_.Post(priority_strand::Priority::normal, [self = shared_from_this(), &req,
+                                                                 send = std::forward<Send>(send)]() {
                 (*self->api_handler_)(req, send);
             });
         } else {
-            static_handler_(std::forward<decltype(req)>(req), std::forward<Send>(send));
+            static_handler_(req, std::forward<Send>(send));
         }
     }
 
+    template <typename Stream>
+    void Upgrade(http::request<http::string_body>&& req, Stream&& stream, state_stream::Connection&& connection) {
+        net::dispatch(api_strand_.GetStrand(), [self = shared_from_this(), req = std::move(req),
+                                    stream = std::move(stream), connection = std::move(connection)]() mutable {
+            self->api_handler_->Upgrade(std::move(req), std::move(stream), std::move(connection));
+        });
+    }
+
 private:
     net::io_context& ioc_;
-    Strand& api_strand_;
+    priority_strand::PriorityStrand& api_strand_;
+    StreamingContext streaming_;
     std::shared_ptr<ApiRequestHandler> api_handler_;
     StaticRequestHandler static_handler_;
+    rate_limiter::RateLimiter rate_limiter_;
 };
 
 }  // namespace http_handler
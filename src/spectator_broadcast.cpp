@@ -0,0 +1,174 @@
+#include "spectator_broadcast.h"
+#include "http_server.h"
+
+#include <boost/asio/post.hpp>
+#include <boost/asio/write.hpp>
+
+#include <algorithm>
+
+namespace state_stream {
+
+using namespace std::literals;
+
+void SpectatorChannel::Publish(SpectatorFramePtr frame) {
+    std::atomic_store_explicit(&latest_, std::move(frame), std::memory_order_release);
+    if (!wake_scheduled_.exchange(true)) {
+        // обход зрителей идёт вне strand игры
+        net::post(fanout_executor_, [self = shared_from_this()] {
+            self->WakeViewers();
+        });
+    }
+}
+
+SpectatorFramePtr SpectatorChannel::GetLatest() const {
+    return std::atomic_load_explicit(&latest_, std::memory_order_acquire);
+}
+
+void SpectatorChannel::Add(std::weak_ptr<SpectatorSession> viewer) {
+    std::lock_guard lock{mutex_};
+    viewers_.push_back(std::move(viewer));
+    viewer_count_.store(viewers_.size(), std::memory_order_relaxed);
+}
+
+void SpectatorChannel::WakeViewers() {
+    wake_scheduled_.store(false);
+
+    std::lock_guard lock{mutex_};
+    std::erase_if(viewers_, [](const auto& weak_viewer) {
+        auto viewer = weak_viewer.lock();
+        if (!viewer) {
+            return true;
+        }
+        viewer->Wake();
+        return false;
+    });
+    viewer_count_.store(viewers_.size(), std::memory_order_relaxed);
+}
+
+void SpectatorBroadcaster::OnStateUpdated(const model::GameSession& session, const snapshot::Buffer& state) {
+    std::shared_ptr<SpectatorChannel> channel;
+    {
+        std::lock_guard lock{mutex_};
+        auto it = channels_.find(*session.GetMapId());
+        if (it == channels_.end()) {
+            return;
+        }
+        channel = it->second;
+    }
+
+    if (!channel->HasViewers()) {
+        return;
+    }
+
+    // событие собирается один раз и отправляется всем зрителям как есть
+    auto frame = std::make_shared<SpectatorFrame>();
+    frame->seq = ++next_seq_;
+    frame->data.reserve(STATE_EVENT_PREFIX.size() + state->size() + STATE_EVENT_SUFFIX.size());
+    frame->data.append(STATE_EVENT_PREFIX).append(*state).append(STATE_EVENT_SUFFIX);
+    channel->Publish(std::move(frame));
+}
+
+std::shared_ptr<SpectatorChannel> SpectatorBroadcaster::GetChannel(const model::Map::Id& map_id) {
+    std::lock_guard lock{mutex_};
+    auto [it, inserted] = channels_.try_emplace(*map_id);
+    if (inserted) {
+        it->second = std::make_shared<SpectatorChannel>(fanout_executor_);
+    }
+    return it->second;
+}
+
+SpectatorSession::SpectatorSession(beast::tcp_stream&& stream, Connection&& connection,
+                                   std::shared_ptr<SpectatorChannel> channel)
+    : stream_(std::move(stream))
+    , connection_(std::move(connection))
+    , channel_(std::move(channel)) {
+}
+
+void SpectatorSession::Run(unsigned http_version) {
+    header_ = http_server::MakeEventStreamHeader(http_version);
+
+    stream_.expires_after(STREAM_WRITE_TIMEOUT);
+    http::async_write_header(stream_, header_serializer_,
+                             beast::bind_front_handler(&SpectatorSession::OnWriteHeader, shared_from_this()));
+}
+
+void SpectatorSession::Wake() {
+    if (idle_.exchange(false)) {
+        net::post(stream_.get_executor(), [self = shared_from_this()] {
+            self->Pull();
+        });
+    }
+}
+
+void SpectatorSession::OnWriteHeader(beast::error_code ec, [[maybe_unused]] std::size_t bytes_written) {
+    if (ec) {
+        if (!http_server::IsClientDisconnect(ec)) {
+            http_server::ReportError(ec, "spectator write"sv);
+        }
+        return;
+    }
+
+    channel_->Add(weak_from_this());
+    // ожидание данных от клиента не ограничено, таймаут ставится на каждую запись кадра
+    stream_.expires_never();
+    Read();
+    Pull();
+}
+
+void SpectatorSession::Read() {
+    stream_.async_read_some(net::buffer(read_buffer_),
+                            beast::bind_front_handler(&SpectatorSession::OnRead, shared_from_this()));
+}
+
+void SpectatorSession::OnRead(beast::error_code ec, [[maybe_unused]] std::size_t bytes_read) {
+    if (!ec) {
+        // присланное клиентом не нужно
+        return Read();
+    }
+
+    // после текущей записи сессия закончится вместе с последней ссылкой на неё
+    closed_ = true;
+    if (ec != net::error::eof && ec != net::error::operation_aborted && !http_server::IsClientDisconnect(ec)) {
+        http_server::ReportError(ec, "spectator read"sv);
+    }
+}
+
+void SpectatorSession::Pull() {
+    if (closed_) {
+        return;
+    }
+
+    SpectatorFramePtr frame = channel_->GetLatest();
+    if (!frame || frame->seq == sent_seq_) {
+        idle_.store(true);
+        // кадр мог появиться между проверкой и установкой idle_, тогда Wake его уже не увидит
+        frame = channel_->GetLatest();
+        if (!frame || frame->seq == sent_seq_ || !idle_.exchange(false)) {
+            return;
+        }
+    }
+
+    writing_frame_ = std::move(frame);
+    stream_.expires_after(STREAM_WRITE_TIMEOUT);
+    net::async_write(stream_, net::buffer(writing_frame_->data),
+                     beast::bind_front_handler(&SpectatorSession::OnWrite, shared_from_this()));
+}
+
+void SpectatorSession::OnWrite(beast::error_code ec, [[maybe_unused]] std::size_t bytes_written) {
+    if (ec) {
+        writing_frame_.reset();
+        if (!closed_ && !http_server::IsClientDisconnect(ec)) {
+            http_server::ReportError(ec, "spectator write"sv);
+        }
+        closed_ = true;
+        // прерывает ожидающее чтение, чтобы сессия не ждала закрытия соединения клиентом
+        stream_.close();
+        return;
+    }
+
+    sent_seq_ = writing_frame_->seq;
+    writing_frame_.reset();
+    Pull();
+}
+
+} // namespace state_stream
@@ -0,0 +1,131 @@
+#pragma once
+
+#include "app.h"
+#include "state_stream.h"
+
+#include <boost/asio/any_io_executor.hpp>
+#include <boost/beast/core.hpp>
+#include <boost/beast/http.hpp>
+
+#include <array>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace state_stream {
+
+namespace beast = boost::beast;
+namespace http = beast::http;
+
+// Готовое к отправке событие text/event-stream, одно на сессию за тик
+struct SpectatorFrame {
+    std::uint64_t seq = 0;
+    std::string data;
+};
+
+using SpectatorFramePtr = std::shared_ptr<const SpectatorFrame>;
+
+class SpectatorSession;
+
+/*
+ * Зрители одной карты. Кадр хранится в единственном экземпляре, зрители сами забирают
+ * самый свежий кадр после окончания предыдущей записи, поэтому медленный зритель пропускает кадры,
+ * а будить после тика нужно только простаивающих.
+ */
+class SpectatorChannel : public std::enable_shared_from_this<SpectatorChannel> {
+public:
+    explicit SpectatorChannel(net::any_io_executor fanout_executor)
+        : fanout_executor_(std::move(fanout_executor)) {
+    }
+
+    SpectatorChannel(const SpectatorChannel&) = delete;
+    SpectatorChannel& operator=(const SpectatorChannel&) = delete;
+
+    void Publish(SpectatorFramePtr frame);
+    SpectatorFramePtr GetLatest() const;
+
+    void Add(std::weak_ptr<SpectatorSession> viewer);
+    bool HasViewers() const {
+        return viewer_count_.load(std::memory_order_relaxed) != 0;
+    }
+
+private:
+    net::any_io_executor fanout_executor_;
+    SpectatorFramePtr latest_;
+
+    std::mutex mutex_;
+    std::vector<std::weak_ptr<SpectatorSession>> viewers_;
+    std::atomic<size_t> viewer_count_ = 0;
+    // несколько тиков подряд будят зрителей одним проходом
+    std::atomic<bool> wake_scheduled_ = false;
+
+    void WakeViewers();
+};
+
+// Раздача состояния сессий зрителям без токена, по id карты
+class SpectatorBroadcaster : public app::ApplicationListener {
+public:
+    explicit SpectatorBroadcaster(net::any_io_executor fanout_executor)
+        : fanout_executor_(std::move(fanout_executor)) {
+    }
+
+    SpectatorBroadcaster(const SpectatorBroadcaster&) = delete;
+    SpectatorBroadcaster& operator=(const SpectatorBroadcaster&) = delete;
+
+    void OnTick(std::chrono::milliseconds delta) override {
+    }
+
+    // вызывается на strand игры
+    void OnStateUpdated(const model::GameSession& session, const snapshot::Buffer& state) override;
+
+    std::shared_ptr<SpectatorChannel> GetChannel(const model::Map::Id& map_id);
+
+private:
+    net::any_io_executor fanout_executor_;
+    std::mutex mutex_;
+    std::unordered_map<std::string, std::shared_ptr<SpectatorChannel>> channels_;
+    std::uint64_t next_seq_ = 0;
+};
+
+/*
+ * Соединение зрителя: ответ text/event-stream, в который пишутся кадры канала.
+ * Канал хранит зрителей по weak_ptr, сессию держит чтение из соединения, которое ждёт всё время,
+ * пока клиент его не закроет, - в том числе когда зритель простаивает между кадрами.
+ */
+class SpectatorSession : public std::enable_shared_from_this<SpectatorSession> {
+public:
+    SpectatorSession(beast::tcp_stream&& stream, Connection&& connection, std::shared_ptr<SpectatorChannel> channel);
+
+    SpectatorSession(const SpectatorSession&) = delete;
+    SpectatorSession& operator=(const SpectatorSession&) = delete;
+
+    void Run(unsigned http_version);
+
+    // из любого потока; ставит чтение кадра, только если соединение простаивает
+    void Wake();
+
+private:
+    beast::tcp_stream stream_;
+    Connection connection_;
+    std::shared_ptr<SpectatorChannel> channel_;
+
+    http::response<http::empty_body> header_;
+    http::response_serializer<http::empty_body> header_serializer_{header_};
+
+    std::array<char, 64> read_buffer_;
+    SpectatorFramePtr writing_frame_;
+    std::uint64_t sent_seq_ = 0;
+    std::atomic<bool> idle_ = false;
+    bool closed_ = false;
+
+    void OnWriteHeader(beast::error_code ec, std::size_t bytes_written);
+    void Read();
+    void OnRead(beast::error_code ec, std::size_t bytes_read);
+    void Pull();
+    void OnWrite(beast::error_code ec, std::size_t bytes_written);
+};
+
+} // namespace state_stream
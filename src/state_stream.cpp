@@ -0,0 +1,78 @@
+#include "state_stream.h"
+#include "game_state_binary.h"
+
+#include <algorithm>
+
+namespace state_stream {
+
+void StateHub::OnStateUpdated(const model::GameSession& session, const snapshot::Buffer& state) {
+    if (auto waiters = waiters_.extract(&session)) {
+        for (auto& waiter : waiters.mapped()) {
+            waiter.callback();
+        }
+    }
+
+    auto it = subscribers_.find(&session);
+    if (it == subscribers_.end()) {
+        return;
+    }
+
+    // двоичный кадр кодируется один раз на сессию и только если он кому-то нужен
+    snapshot::Buffer binary_state;
+    for (const auto& weak_subscriber : it->second) {
+        auto subscriber = weak_subscriber.lock();
+        if (!subscriber) {
+            continue;
+        }
+
+        if (subscriber->GetEncoding() == snapshot::Encoding::binary) {
+            if (!binary_state) {
+                binary_state = std::make_shared<const std::string>(snapshot::EncodeGameStateBinary(session));
+            }
+            subscriber->OnFrame(binary_state);
+        } else {
+            subscriber->OnFrame(state);
+        }
+    }
+
+    std::erase_if(it->second, [](const auto& subscriber) {
+        return subscriber.expired();
+    });
+    if (it->second.empty()) {
+        subscribers_.erase(it);
+    }
+}
+
+void StateHub::Subscribe(const model::GameSession* session, std::weak_ptr<Subscriber> subscriber) {
+    subscribers_[session].push_back(std::move(subscriber));
+}
+
+StateHub::WaitId StateHub::WaitForUpdate(const model::GameSession* session, std::function<void()> waiter) {
+    WaitId id = next_wait_id_++;
+    waiters_[session].push_back({id, std::move(waiter)});
+    return id;
+}
+
+void StateHub::CancelWait(const model::GameSession* session, WaitId id) {
+    auto it = waiters_.find(session);
+    if (it == waiters_.end()) {
+        return;
+    }
+
+    std::erase_if(it->second, [id](const Waiter& waiter) {
+        return waiter.id == id;
+    });
+    if (it->second.empty()) {
+        waiters_.erase(it);
+    }
+}
+
+size_t StateHub::GetWaiterCount() const {
+    size_t count = 0;
+    for (const auto& [session, waiters] : waiters_) {
+        count += waiters.size();
+    }
+    return count;
+}
+
+} // namespace state_stream
@@ -0,0 +1,85 @@
+#pragma once
+
+#include "app.h"
+#include "connection_manager.h"
+#include "game_state_snapshot.h"
+#include "model.h"
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/strand.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace state_stream {
+
+namespace net = boost::asio;
+
+using Strand = net::strand<net::io_context::executor_type>;
+
+// событие text/event-stream с кадром состояния: префикс + JSON + суффикс
+constexpr std::string_view STATE_EVENT_PREFIX = "event: state\ndata: ";
+constexpr std::string_view STATE_EVENT_SUFFIX = "\n\n";
+
+// клиент, который перестал читать поток дольше этого времени, отключается
+constexpr std::chrono::seconds STREAM_WRITE_TIMEOUT{30};
+
+// место в ConnectionManager; сессия потока держит его, пока соединение открыто, и оно учитывается в --max-connections
+using Connection = connection_manager::ConnectionManager::Connection;
+
+// Получатель кадров состояния (WebSocket, text/event-stream)
+class Subscriber {
+public:
+    // вызывается на strand игры, реализация должна сама перейти на свой executor
+    virtual void OnFrame(const snapshot::Buffer& frame) = 0;
+    virtual snapshot::Encoding GetEncoding() const = 0;
+
+protected:
+    ~Subscriber() = default;
+};
+
+/*
+ * Раздаёт опубликованное после тика состояние подписчикам сессии.
+ * Все методы вызываются на strand игры. Отписка не нужна: подписчики хранятся по weak_ptr
+ * и удаляются из списка после закрытия соединения.
+ */
+class StateHub : public app::ApplicationListener {
+public:
+    StateHub() = default;
+
+    StateHub(const StateHub&) = delete;
+    StateHub& operator=(const StateHub&) = delete;
+
+    void OnTick(std::chrono::milliseconds delta) override {
+    }
+
+    void OnStateUpdated(const model::GameSession& session, const snapshot::Buffer& state) override;
+
+    void Subscribe(const model::GameSession* session, std::weak_ptr<Subscriber> subscriber);
+
+    using WaitId = std::uint64_t;
+
+    // однократный вызов после следующего обновления состояния сессии
+    WaitId WaitForUpdate(const model::GameSession* session, std::function<void()> waiter);
+    // ожидание больше не нужно (например, истёк таймаут); без этого ожидания копятся, пока у сессии нет тиков
+    void CancelWait(const model::GameSession* session, WaitId id);
+
+    size_t GetWaiterCount() const;
+
+private:
+    struct Waiter {
+        WaitId id;
+        std::function<void()> callback;
+    };
+
+    WaitId next_wait_id_ = 0;
+    std::unordered_map<const model::GameSession*, std::vector<Waiter>> waiters_;
+    std::unordered_map<const model::GameSession*, std::vector<std::weak_ptr<Subscriber>>> subscribers_;
+};
+
+} // namespace state_stream
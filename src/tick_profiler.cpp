@@ -0,0 +1,146 @@
+#include "tick_profiler.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <stdexcept>
+
+namespace tick_profiler {
+
+using namespace std::literals;
+using namespace std::chrono;
+
+namespace {
+
+std::int64_t ToMicroseconds(nanoseconds duration) {
+    return duration_cast<microseconds>(duration).count();
+}
+
+} // namespace
+
+std::string_view PhaseName(Phase phase) {
+    switch (phase) {
+        case Phase::input_apply:
+            return "inputApply"sv;
+        case Phase::movement:
+            return "movement"sv;
+        case Phase::loot_spawn:
+            return "lootSpawn"sv;
+        case Phase::gather:
+            return "gather"sv;
+        case Phase::scoring:
+            return "scoring"sv;
+        case Phase::listeners:
+            return "listeners"sv;
+        case Phase::snapshot:
+            return "snapshot"sv;
+    }
+    throw std::invalid_argument("Unknown tick phase"s);
+}
+
+void Histogram::Record(Duration duration) noexcept {
+    auto us = static_cast<std::uint64_t>(std::max<std::int64_t>(ToMicroseconds(duration), 0));
+    size_t bucket = std::min<size_t>(std::bit_width(us), BUCKET_COUNT - 1);
+    ++buckets_[bucket];
+    ++count_;
+    total_ += duration;
+    max_ = std::max(max_, duration);
+}
+
+Histogram::Duration Histogram::GetPercentile(double q) const noexcept {
+    if (count_ == 0) {
+        return {};
+    }
+
+    auto rank = static_cast<std::uint64_t>(std::ceil(std::clamp(q, 0., 1.) * static_cast<double>(count_)));
+    rank = std::max<std::uint64_t>(rank, 1);
+    std::uint64_t seen = 0;
+    for (size_t bucket = 0; bucket < BUCKET_COUNT; ++bucket) {
+        seen += buckets_[bucket];
+        if (seen >= rank) {
+            return std::min<Duration>(microseconds{std::uint64_t{1} << bucket}, max_);
+        }
+    }
+    return max_;
+}
+
+void TickProfiler::BeginTick() {
+    current_tick_ = {};
+    tick_start_ = Clock::now();
+}
+
+bool TickProfiler::EndTick() {
+    current_tick_.total = Clock::now() - tick_start_;
+    tick_.Record(current_tick_.total);
+    last_tick_ = current_tick_;
+
+    last_over_budget_ = budget_ != Clock::duration{} && current_tick_.total > budget_;
+    if (last_over_budget_) {
+        ++over_budget_ticks_;
+    }
+    return last_over_budget_;
+}
+
+void TickProfiler::Record(Phase phase, const model::GameSession* session, Clock::duration duration) {
+    auto index = static_cast<size_t>(phase);
+    phases_[index].Record(duration);
+    current_tick_.phases[index] += duration;
+    if (session != nullptr) {
+        sessions_[*session->GetMapId()][index].Record(duration);
+    }
+}
+
+void WriteHistogram(json_writer::JsonWriter& writer, const Histogram& histogram) {
+    writer.BeginObject()
+          .Key("count"sv).Uint(histogram.GetCount())
+          .Key("totalUs"sv).Int(ToMicroseconds(histogram.GetTotal()))
+          .Key("maxUs"sv).Int(ToMicroseconds(histogram.GetMax()))
+          .Key("p50Us"sv).Int(ToMicroseconds(histogram.GetPercentile(0.5)))
+          .Key("p90Us"sv).Int(ToMicroseconds(histogram.GetPercentile(0.9)))
+          .Key("p99Us"sv).Int(ToMicroseconds(histogram.GetPercentile(0.99)))
+          .EndObject();
+}
+
+void WriteBreakdown(json_writer::JsonWriter& writer, const TickProfiler::TickBreakdown& breakdown) {
+    writer.BeginObject();
+    for (size_t phase = 0; phase < PHASE_COUNT; ++phase) {
+        writer.Key(PhaseName(static_cast<Phase>(phase))).Int(ToMicroseconds(breakdown.phases[phase]));
+    }
+    writer.Key("totalUs"sv).Int(ToMicroseconds(breakdown.total)).EndObject();
+}
+
+void WriteProfile(json_writer::JsonWriter& writer, const TickProfiler& profiler) {
+    writer.BeginObject();
+    WriteProfileFields(writer, profiler);
+    writer.EndObject();
+}
+
+void WriteProfileFields(json_writer::JsonWriter& writer, const TickProfiler& profiler) {
+    auto write_phases = [&writer](const PhaseHistograms& histograms) {
+        writer.BeginObject();
+        for (size_t phase = 0; phase < PHASE_COUNT; ++phase) {
+            if (histograms[phase].GetCount() != 0) {
+                writer.Key(PhaseName(static_cast<Phase>(phase)));
+                WriteHistogram(writer, histograms[phase]);
+            }
+        }
+        writer.EndObject();
+    };
+
+    writer.Key("budgetUs"sv).Int(ToMicroseconds(profiler.GetBudget()));
+    writer.Key("overBudgetTicks"sv).Uint(profiler.GetOverBudgetTicks());
+    writer.Key("tick"sv);
+    WriteHistogram(writer, profiler.GetTickHistogram());
+    writer.Key("lastTick"sv);
+    WriteBreakdown(writer, profiler.GetLastTick());
+    writer.Key("phases"sv);
+    write_phases(profiler.GetPhaseHistograms());
+    writer.Key("sessions"sv).BeginObject();
+    for (const auto& [map_id, histograms] : profiler.GetSessionHistograms()) {
+        writer.Key(map_id);
+        write_phases(histograms);
+    }
+    writer.EndObject();
+}
+
+} // namespace tick_profiler
@@ -0,0 +1,163 @@
+#pragma once
+
+#include "json_writer.h"
+#include "model.h"
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace tick_profiler {
+
+// фазы тика; слушатели выполняются до фаз сессий, снимки - после
+enum class Phase : std::uint8_t {
+    input_apply,
+    movement,
+    loot_spawn,
+    gather,
+    scoring,
+    listeners,
+    snapshot
+};
+
+constexpr size_t PHASE_COUNT = 7;
+
+// фазы тика сессии идут в профиле первыми и с теми же номерами
+constexpr Phase ToPhase(model::TickPhase phase) noexcept {
+    return static_cast<Phase>(phase);
+}
+
+static_assert(ToPhase(model::TickPhase::input_apply) == Phase::input_apply
+              && ToPhase(model::TickPhase::movement) == Phase::movement
+              && ToPhase(model::TickPhase::loot_spawn) == Phase::loot_spawn
+              && ToPhase(model::TickPhase::gather) == Phase::gather
+              && ToPhase(model::TickPhase::scoring) == Phase::scoring);
+
+std::string_view PhaseName(Phase phase);
+
+/*
+ * Гистограмма длительностей с корзинами по степеням двойки в микросекундах:
+ * корзина 0 - меньше 1 мкс, корзина i - от 2^(i-1) до 2^i мкс. Запись не выделяет память.
+ */
+class Histogram {
+public:
+    using Duration = std::chrono::nanoseconds;
+
+    constexpr static size_t BUCKET_COUNT = 32;
+
+    void Record(Duration duration) noexcept;
+
+    std::uint64_t GetCount() const noexcept {
+        return count_;
+    }
+
+    Duration GetTotal() const noexcept {
+        return total_;
+    }
+
+    Duration GetMax() const noexcept {
+        return max_;
+    }
+
+    // верхняя граница корзины, в которую попал квантиль q (0..1)
+    Duration GetPercentile(double q) const noexcept;
+
+    const std::array<std::uint64_t, BUCKET_COUNT>& GetBuckets() const noexcept {
+        return buckets_;
+    }
+
+private:
+    std::array<std::uint64_t, BUCKET_COUNT> buckets_{};
+    std::uint64_t count_ = 0;
+    Duration total_{};
+    Duration max_{};
+};
+
+using PhaseHistograms = std::array<Histogram, PHASE_COUNT>;
+
+/*
+ * Замеры фаз тика: общие по всем сессиям и отдельно для каждой карты.
+ * Используется только на strand игры.
+ */
+class TickProfiler {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    struct TickBreakdown {
+        Clock::duration total{};
+        std::array<Clock::duration, PHASE_COUNT> phases{};
+    };
+
+    // 0 - без бюджета
+    void SetBudget(Clock::duration budget) noexcept {
+        budget_ = budget;
+    }
+
+    Clock::duration GetBudget() const noexcept {
+        return budget_;
+    }
+
+    void BeginTick();
+    // возвращает true, если тик превысил бюджет
+    bool EndTick();
+
+    bool IsLastTickOverBudget() const noexcept {
+        return last_over_budget_;
+    }
+
+    // session == nullptr для фаз, общих для всей игры
+    template <typename Fn>
+    void Measure(Phase phase, const model::GameSession* session, Fn&& fn) {
+        auto start = Clock::now();
+        fn();
+        Record(phase, session, Clock::now() - start);
+    }
+
+    const TickBreakdown& GetLastTick() const noexcept {
+        return last_tick_;
+    }
+
+    std::uint64_t GetOverBudgetTicks() const noexcept {
+        return over_budget_ticks_;
+    }
+
+    const Histogram& GetTickHistogram() const noexcept {
+        return tick_;
+    }
+
+    const PhaseHistograms& GetPhaseHistograms() const noexcept {
+        return phases_;
+    }
+
+    const std::unordered_map<std::string, PhaseHistograms>& GetSessionHistograms() const noexcept {
+        return sessions_;
+    }
+
+private:
+    Clock::duration budget_{};
+    Clock::time_point tick_start_;
+    TickBreakdown current_tick_;
+    TickBreakdown last_tick_;
+    std::uint64_t over_budget_ticks_ = 0;
+    bool last_over_budget_ = false;
+
+    Histogram tick_;
+    PhaseHistograms phases_;
+    // по id карты: сессия на карте одна
+    std::unordered_map<std::string, PhaseHistograms> sessions_;
+
+    void Record(Phase phase, const model::GameSession* session, Clock::duration duration);
+};
+
+// {"count", "totalUs", "maxUs", "p50Us", "p90Us", "p99Us"}
+void WriteHistogram(json_writer::JsonWriter& writer, const Histogram& histogram);
+// {"phase": {...длительность в мкс...}, "totalUs": ...}
+void WriteBreakdown(json_writer::JsonWriter& writer, const TickProfiler::TickBreakdown& breakdown);
+void WriteProfile(json_writer::JsonWriter& writer, const TickProfiler& profiler);
+// поля профиля без объекта вокруг них, чтобы рядом можно было записать другие счётчики
+void WriteProfileFields(json_writer::JsonWriter& writer, const TickProfiler& profiler);
+
+} // namespace tick_profiler
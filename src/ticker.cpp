@@ -1,36 +1,122 @@
 #include "ticker.h"
+#include "logger.h"
 
+#include <algorithm>
 #include <cassert>
+#include <cstdlib>
 
 namespace tick {
 
 using namespace std::chrono;
+using namespace std::literals;
+
+std::optional<CatchUpPolicy> ParseCatchUpPolicy(std::string_view name) {
+    if (name == "skip"sv) {
+        return CatchUpPolicy::skip;
+    } else if (name == "coalesce"sv) {
+        return CatchUpPolicy::coalesce;
+    } else if (name == "steps"sv) {
+        return CatchUpPolicy::fixed_steps;
+    }
+    return std::nullopt;
+}
+
+CatchUp PlanCatchUp(steady_clock::duration lateness, steady_clock::duration since_last_tick, milliseconds period,
+                    const TickerOptions& options) {
+    CatchUp plan;
+    plan.missed = lateness >= period ? lateness / period : 0;
+    plan.delta = period;
+
+    switch (options.policy) {
+        case CatchUpPolicy::skip:
+            plan.dropped_periods = plan.missed;
+            break;
+        case CatchUpPolicy::coalesce:
+            plan.delta = duration_cast<milliseconds>(since_last_tick);
+            break;
+        case CatchUpPolicy::fixed_steps:
+            // ограничение не даёт тикам, которые сами не успевают, отставать всё сильнее
+            plan.steps = std::min<std::int64_t>(plan.missed + 1, std::max(1u, options.max_catch_up_steps));
+            plan.dropped_periods = plan.missed + 1 - plan.steps;
+            break;
+    }
+    return plan;
+}
 
 void Ticker::Start() {
-    net::dispatch(strand_, [self = shared_from_this()] {
-        self->last_tick_ = steady_clock::now();
+    strand_.Post(priority_strand::Priority::high, [self = shared_from_this()] {
+        self->last_tick_ = Clock::now();
+        self->deadline_ = self->last_tick_ + self->period_;
         self->ScheduleTick();
     });
 }
 
 void Ticker::ScheduleTick() {
-    timer_.expires_after(period_);
+    timer_.expires_at(deadline_);
     timer_.async_wait([self = shared_from_this()](sys::error_code ec) {
-        self->OnTick(ec);
+        self->strand_.Post(priority_strand::Priority::high, [self, ec] {
+            self->OnTick(ec);
+        });
     });
 }
 
 void Ticker::OnTick(sys::error_code ec) {
-    if (!ec) {
-        auto this_tick = steady_clock::now();
-        auto delta = duration_cast<milliseconds>(this_tick - last_tick_);
-        last_tick_ = this_tick;
-        try {
-            handler_(delta);
-        } catch (...) {
-        }
-        ScheduleTick();
+    if (ec) {
+        return;
+    }
+
+    auto now = Clock::now();
+    auto lateness = now - deadline_;
+    stats_.max_lateness = std::max(stats_.max_lateness, lateness);
+
+    CatchUp plan = PlanCatchUp(lateness, now - last_tick_, period_, options_);
+    if (plan.missed > 0) {
+        ++stats_.overruns;
     }
+    for (std::int64_t step = 0; step < plan.steps; ++step) {
+        RunHandler(plan.delta);
+    }
+    stats_.dropped_periods += plan.dropped_periods;
+
+    last_tick_ = now;
+    deadline_ += period_ * (plan.missed + 1);
+    ScheduleTick();
+}
+
+void Ticker::RunHandler(milliseconds delta) {
+    auto start = Clock::now();
+    try {
+        handler_(delta);
+    } catch (const std::exception& e) {
+        ++stats_.errors;
+        http_logger::LogServerError(EXIT_FAILURE, e.what(), "tick"sv);
+    } catch (...) {
+        ++stats_.errors;
+        http_logger::LogServerError(EXIT_FAILURE, "unknown exception"sv, "tick"sv);
+    }
+
+    auto duration = Clock::now() - start;
+    ++stats_.ticks;
+    stats_.last_handler = duration;
+    stats_.max_handler = std::max(stats_.max_handler, duration);
+    stats_.total_handler += duration;
+}
+
+void WriteStats(json_writer::JsonWriter& writer, const Ticker::Stats& stats) {
+    auto us = [](Ticker::Clock::duration duration) {
+        return duration_cast<microseconds>(duration).count();
+    };
+
+    writer.BeginObject()
+        .Key("ticks"sv).Uint(stats.ticks)
+        .Key("overruns"sv).Uint(stats.overruns)
+        .Key("droppedPeriods"sv).Uint(stats.dropped_periods)
+        .Key("errors"sv).Uint(stats.errors)
+        .Key("maxLatenessUs"sv).Int(us(stats.max_lateness))
+        .Key("lastHandlerUs"sv).Int(us(stats.last_handler))
+        .Key("maxHandlerUs"sv).Int(us(stats.max_handler))
+        .Key("totalHandlerUs"sv).Int(us(stats.total_handler))
+        .EndObject();
 }
 
 } // namespace tick
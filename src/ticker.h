@@ -4,38 +4,107 @@
 #include <boost/asio/steady_timer.hpp>
 #include <boost/asio/strand.hpp>
 
+#include "json_writer.h"
+#include "priority_strand.h"
+
 #include <chrono>
+#include <cstdint>
+#include <functional>
 #include <memory>
+#include <optional>
+#include <string_view>
 
 namespace tick {
 
 namespace net = boost::asio;
 namespace sys = boost::system;
 
+// что делать с периодами, пропущенными из-за долгого тика или перегрузки
+enum class CatchUpPolicy {
+    skip,       // один тик с обычным delta, пропущенное игровое время теряется
+    coalesce,   // один тик с delta, равным всему прошедшему времени
+    fixed_steps // несколько тиков с обычным delta, но не больше max_catch_up_steps
+};
+
+// "skip", "coalesce", "steps"
+std::optional<CatchUpPolicy> ParseCatchUpPolicy(std::string_view name);
+
+struct TickerOptions {
+    CatchUpPolicy policy = CatchUpPolicy::coalesce;
+    unsigned max_catch_up_steps = 5;
+};
+
+// что делать на тике, который опоздал на lateness относительно своего срока
+struct CatchUp {
+    // целых периодов, срок которых уже прошёл, кроме текущего; на столько периодов больше сдвигается срок
+    std::int64_t missed = 0;
+    // вызовов обработчика и delta каждого из них
+    std::int64_t steps = 1;
+    std::chrono::milliseconds delta{};
+    // периоды, для которых обработчик не вызывается
+    std::int64_t dropped_periods = 0;
+};
+
+// since_last_tick - сколько прошло с предыдущего тика, это delta политики coalesce
+CatchUp PlanCatchUp(std::chrono::steady_clock::duration lateness, std::chrono::steady_clock::duration since_last_tick,
+                    std::chrono::milliseconds period, const TickerOptions& options);
+
+/*
+ * Тики по абсолютным срокам: следующий срок отсчитывается от предыдущего,
+ * а не от окончания обработчика, поэтому время обработчика и ожидания в очереди
+ * не накапливается в периоде.
+ */
 class Ticker : public std::enable_shared_from_this<Ticker> {
 public:
-    using Strand = net::strand<net::io_context::executor_type>;
+    using Clock = std::chrono::steady_clock;
     using Handler = std::function<void(std::chrono::milliseconds delta)>;
 
-    Ticker(Strand& strand, std::chrono::milliseconds period, Handler handler)
+    using Options = TickerOptions;
+
+    struct Stats {
+        std::uint64_t ticks = 0;
+        std::uint64_t overruns = 0;         // срок был пропущен хотя бы на период
+        std::uint64_t dropped_periods = 0;  // периоды, для которых обработчик не вызывался
+        std::uint64_t errors = 0;
+        Clock::duration max_lateness{};
+        Clock::duration last_handler{};
+        Clock::duration max_handler{};
+        Clock::duration total_handler{};
+    };
+
+    // обработчик выполняется на strand раньше ожидающих запросов API
+    Ticker(priority_strand::PriorityStrand& strand, std::chrono::milliseconds period, Handler handler,
+           Options options = {})
         : strand_(strand)
         , period_(period)
-        , handler_(std::move(handler)) {
+        , handler_(std::move(handler))
+        , options_(options) {
     }
 
     void Start();
 
-private:
-    using Clock = std::chrono::steady_clock;
+    // только на strand или после остановки io_context
+    const Stats& GetStats() const noexcept {
+        return stats_;
+    }
 
-    Strand& strand_;
+private:
+    priority_strand::PriorityStrand& strand_;
     std::chrono::milliseconds period_;
-    net::steady_timer timer_{strand_};
+    // срабатывание таймера не ждёт в strand, задача тика сразу ставится в приоритетную очередь
+    net::steady_timer timer_{strand_.GetStrand().get_inner_executor()};
     Handler handler_;
+    Options options_;
     Clock::time_point last_tick_;
+    Clock::time_point deadline_;
+    Stats stats_;
 
     void ScheduleTick();
     void OnTick(sys::error_code ec);
+    void RunHandler(std::chrono::milliseconds delta);
 };
 
+// те же счётчики, что и в журнале при остановке сервера
+void WriteStats(json_writer::JsonWriter& writer, const Ticker::Stats& stats);
+
 } // namespace tick
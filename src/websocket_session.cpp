@@ -0,0 +1,206 @@
+#include "websocket_session.h"
+#include "http_server.h"
+#include "json_writer.h"
+
+#include <boost/asio/dispatch.hpp>
+#include <boost/asio/post.hpp>
+#include <boost/json.hpp>
+
+namespace state_stream {
+
+using namespace std::literals;
+namespace json = boost::json;
+
+namespace {
+
+template <typename Stream>
+void WriteRejection(Stream&& stream, Connection&& connection, http::response<http::string_body>&& response) {
+    struct Rejection {
+        Stream stream;
+        Connection connection;
+        http::response<http::string_body> response;
+    };
+
+    auto rejection = std::make_shared<Rejection>(Rejection{std::move(stream), std::move(connection),
+                                                           std::move(response)});
+    rejection->response.keep_alive(false);
+    rejection->stream.expires_after(30s);
+    http::async_write(rejection->stream, rejection->response,
+                      [rejection](beast::error_code ec, [[maybe_unused]] std::size_t bytes_written) {
+        if (ec) {
+            http_server::ReportError(ec, "write"sv);
+        }
+        rejection->stream.socket().shutdown(net::socket_base::shutdown_send, ec);
+    });
+}
+
+} // namespace
+
+void RejectUpgrade(beast::tcp_stream&& stream, Connection&& connection, http::response<http::string_body>&& response) {
+    WriteRejection(std::move(stream), std::move(connection), std::move(response));
+}
+
+void RejectUpgrade(beast::basic_stream<net::local::stream_protocol>&& stream, Connection&& connection,
+                   http::response<http::string_body>&& response) {
+    WriteRejection(std::move(stream), std::move(connection), std::move(response));
+}
+
+WebSocketSession::WebSocketSession(beast::tcp_stream&& stream, Connection&& connection, app::Application& app,
+                                   Strand& game_strand, StateHub& hub, std::string token,
+                                   const model::GameSession* session, Options options)
+    : ws_(std::move(stream))
+    , connection_(std::move(connection))
+    , app_(app)
+    , game_strand_(game_strand)
+    , hub_(hub)
+    , token_(std::move(token))
+    , session_(session)
+    , options_(options) {
+}
+
+void WebSocketSession::Run(http::request<http::string_body>&& upgrade_request) {
+    // таймаут чтения HTTP больше не действует, дальше за соединением следят пинги websocket
+    ws_.next_layer().expires_never();
+    ws_.set_option(websocket::stream_base::timeout::suggested(beast::role_type::server));
+    ws_.read_message_max(MAX_COMMAND_SIZE);
+    ws_.async_accept(upgrade_request, beast::bind_front_handler(&WebSocketSession::OnAccept, shared_from_this()));
+}
+
+void WebSocketSession::OnFrame(const snapshot::Buffer& frame) {
+    if (ticks_++ % options_.every_nth_tick != 0) {
+        return;
+    }
+
+    bool binary = options_.encoding == snapshot::Encoding::binary;
+    net::post(ws_.get_executor(), [self = shared_from_this(), frame, binary] {
+        self->Send({frame, true, binary});
+    });
+}
+
+void WebSocketSession::OnAccept(beast::error_code ec) {
+    if (ec) {
+        return http_server::ReportError(ec, "websocket accept"sv);
+    }
+
+    net::dispatch(game_strand_, [self = shared_from_this()] {
+        self->hub_.Subscribe(self->session_, self->weak_from_this());
+    });
+    Read();
+}
+
+void WebSocketSession::Read() {
+    ws_.async_read(read_buffer_, beast::bind_front_handler(&WebSocketSession::OnRead, shared_from_this()));
+}
+
+void WebSocketSession::OnRead(beast::error_code ec, [[maybe_unused]] std::size_t bytes_read) {
+    if (ec == websocket::error::closed) {
+        return;
+    }
+
+    if (ec) {
+        return http_server::ReportError(ec, "websocket read"sv);
+    }
+
+    std::string command = beast::buffers_to_string(read_buffer_.data());
+    read_buffer_.consume(read_buffer_.size());
+    HandleCommand(command);
+    Read();
+}
+
+void WebSocketSession::HandleCommand(std::string_view text) {
+    boost::system::error_code ec;
+    json::value command = json::parse(text, ec);
+
+    const json::string* move = nullptr;
+    if (!ec && command.is_object()) {
+        if (const json::value* move_value = command.as_object().if_contains("move")) {
+            move = move_value->if_string();
+        }
+    }
+
+    if (move == nullptr) {
+        return SendError("invalidArgument"sv, "Failed to parse action"sv);
+    }
+
+    if (!options_.manual_update) {
+        // как и /api/v1/game/player/action: ход применится в начале следующего тика, strand игры не нужен
+        try {
+            if (!app_.EnqueueMove(token_, *move)) {
+                SendError("invalidArgument"sv, "Failed to parse action"sv);
+            }
+        } catch (const app::ListPlayersError&) {
+            // игрок мог уйти на покой, пока соединение было открыто
+            SendError("unknownToken"sv, "Player token has not been found"sv);
+        }
+        return;
+    }
+
+    net::dispatch(game_strand_, [self = shared_from_this(), move = std::string(*move)] {
+        // игрок мог уйти на покой, пока соединение было открыто
+        bool known_token = self->app_.IsTokenValid(self->token_);
+        if (known_token && self->app_.MoveDog(self->token_, move)) {
+            return;
+        }
+
+        net::post(self->ws_.get_executor(), [self, known_token] {
+            if (known_token) {
+                self->SendError("invalidArgument"sv, "Failed to parse action"sv);
+            } else {
+                self->SendError("unknownToken"sv, "Player token has not been found"sv);
+            }
+        });
+    });
+}
+
+void WebSocketSession::Send(OutgoingMessage message) {
+    // первый элемент очереди может уже отправляться, его не трогаем
+    auto it = queue_.begin() + (writing_ ? 1 : 0);
+    for (; it != queue_.end(); ++it) {
+        if (it->is_state != message.is_state) {
+            continue;
+        }
+        // клиент, который шлёт команды быстрее, чем читает ответы, получит только первую из ошибок
+        if (message.is_state) {
+            *it = std::move(message);
+        }
+        return;
+    }
+
+    queue_.push_back(std::move(message));
+    if (!writing_) {
+        Write();
+    }
+}
+
+void WebSocketSession::SendError(std::string_view code, std::string_view message) {
+    std::string body;
+    json_writer::JsonWriter writer{body};
+    writer.BeginObject().Key("code"sv).String(code).Key("message"sv).String(message).EndObject();
+    Send({std::make_shared<const std::string>(std::move(body)), false, false});
+}
+
+void WebSocketSession::Write() {
+    writing_ = true;
+    const OutgoingMessage& message = queue_.front();
+    ws_.binary(message.binary);
+    ws_.async_write(net::buffer(*message.data),
+                    beast::bind_front_handler(&WebSocketSession::OnWrite, shared_from_this()));
+}
+
+void WebSocketSession::OnWrite(beast::error_code ec, [[maybe_unused]] std::size_t bytes_written) {
+    writing_ = false;
+    if (ec) {
+        queue_.clear();
+        if (ec != websocket::error::closed) {
+            http_server::ReportError(ec, "websocket write"sv);
+        }
+        return;
+    }
+
+    queue_.pop_front();
+    if (!queue_.empty()) {
+        Write();
+    }
+}
+
+} // namespace state_stream
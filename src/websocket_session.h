@@ -0,0 +1,95 @@
+#pragma once
+
+#include "app.h"
+#include "state_stream.h"
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/local/stream_protocol.hpp>
+#include <boost/asio/strand.hpp>
+#include <boost/beast/core.hpp>
+#include <boost/beast/http.hpp>
+#include <boost/beast/websocket.hpp>
+
+#include <deque>
+#include <memory>
+#include <string>
+#include <string_view>
+
+namespace state_stream {
+
+namespace net = boost::asio;
+namespace beast = boost::beast;
+namespace http = beast::http;
+namespace websocket = beast::websocket;
+
+// Отказ в апгрейде до рукопожатия: обычный HTTP-ответ и закрытие соединения
+void RejectUpgrade(beast::tcp_stream&& stream, Connection&& connection, http::response<http::string_body>&& response);
+void RejectUpgrade(beast::basic_stream<net::local::stream_protocol>&& stream, Connection&& connection,
+                   http::response<http::string_body>&& response);
+
+/*
+ * WebSocket-соединение игрока. Сервер отправляет состояние сессии каждый N-й тик
+ * (тот же JSON, что и /api/v1/game/state, или двоичный кадр), клиент присылает команды {"move": "L"}.
+ * Если клиент не успевает читать, неотправленный кадр состояния заменяется свежим,
+ * а новые ошибки команд отбрасываются, пока не отправлена предыдущая.
+ */
+class WebSocketSession : public Subscriber, public std::enable_shared_from_this<WebSocketSession> {
+public:
+    struct Options {
+        unsigned every_nth_tick = 1;
+        snapshot::Encoding encoding = snapshot::Encoding::json;
+        // тики по запросу /api/v1/game/tick: ход применяется сразу на strand игры, иначе ставится в очередь сессии
+        bool manual_update = false;
+    };
+
+    WebSocketSession(beast::tcp_stream&& stream, Connection&& connection, app::Application& app, Strand& game_strand,
+                     StateHub& hub, std::string token, const model::GameSession* session, Options options);
+
+    WebSocketSession(const WebSocketSession&) = delete;
+    WebSocketSession& operator=(const WebSocketSession&) = delete;
+
+    void Run(http::request<http::string_body>&& upgrade_request);
+
+    void OnFrame(const snapshot::Buffer& frame) override;
+
+    snapshot::Encoding GetEncoding() const override {
+        return options_.encoding;
+    }
+
+private:
+    struct OutgoingMessage {
+        snapshot::Buffer data;
+        bool is_state = false;
+        bool binary = false;
+    };
+
+    constexpr static size_t MAX_COMMAND_SIZE = 1024;
+
+    websocket::stream<beast::tcp_stream> ws_;
+    Connection connection_;
+    beast::flat_buffer read_buffer_;
+    app::Application& app_;
+    Strand& game_strand_;
+    StateHub& hub_;
+    std::string token_;
+    const model::GameSession* session_;
+    Options options_;
+
+    // только на strand игры
+    std::uint64_t ticks_ = 0;
+
+    // только на executor соединения
+    std::deque<OutgoingMessage> queue_;
+    bool writing_ = false;
+
+    void OnAccept(beast::error_code ec);
+    void Read();
+    void OnRead(beast::error_code ec, std::size_t bytes_read);
+    void HandleCommand(std::string_view text);
+    void Send(OutgoingMessage message);
+    void SendError(std::string_view code, std::string_view message);
+    void Write();
+    void OnWrite(beast::error_code ec, std::size_t bytes_written);
+};
+
+} // namespace state_stream
@@ -8,6 +8,12 @@ let camera;
 let lootTypesLoaded = false;
 const lootRotationSpeed = 0.0025;
 const lootWaiwingSpeed = 0.005;
+// open game.html?binary=1 to receive state in the binary format (js/state_decoder.js)
+const useBinaryState = new URLSearchParams(window.location.search).get('binary') === '1';
+// open game.html?ws=1 to receive state over WebSocket (js/state_stream.js)
+const useStateSocket = new URLSearchParams(window.location.search).get('ws') === '1';
+// open game.html?sse=1 to receive state as server-sent events, actions are still posted
+const useStateEvents = new URLSearchParams(window.location.search).get('sse') === '1';
 
 let pos_arr = [];
 
@@ -164,6 +170,12 @@ class GameState {
     this.lostObjects = {};
     this.disappearingLoot = {};
     this.player_elems = {};
+    this.stateSocket = undefined;
+    if (useStateSocket) {
+      this.stateSocket = new StateSocket(Cookies.get('authToken'), useBinaryState);
+    } else if (useStateEvents) {
+      this.stateSocket = new StateEventStream(Cookies.get('authToken'));
+    }
 
     this._updateState(function() {
       self.stateLoaded = true;
@@ -212,6 +224,10 @@ class GameState {
 
   _pressKey(keys, then) {
     const self = this;
+    if (this.stateSocket !== undefined && this.stateSocket.sendMove(keys)) {
+      then();
+      return;
+    }
     $.post({
       url: '/api/v1/game/player/action',
       dataType: 'json',
@@ -265,6 +281,16 @@ class GameState {
   _syncPlayers(then) {
     this.playersSuncInProgress = true;
     let self = this;
+    if (useBinaryState) {
+      fetchBinaryState('/api/v1/game/players', decodePlayers).then(function(x) {
+        self._updatePlayersList(x);
+        then();
+      }).catch(function(err) {
+        if (err.status == 401) goToRecords();
+      });
+      this.playersSuncInProgress = false;
+      return;
+    }
     $.get({
       url: '/api/v1/game/players',
       dataType: 'json',
@@ -411,6 +437,22 @@ class GameState {
 
   _updateState(then) {
     let self = this;
+    if (this.stateSocket !== undefined) {
+      this.stateSocket.getState(function(x) {
+        self.desiredState = x;
+        self.stateTime = performance.now();
+        then();
+      });
+      return;
+    }
+    if (useBinaryState) {
+      fetchBinaryState('/api/v1/game/state', decodeGameState).then(function(x) {
+        self.desiredState = x;
+        self.stateTime = performance.now();
+        then();
+      });
+      return;
+    }
     $.get({
       url: '/api/v1/game/state',
       dataType: 'json',
@@ -0,0 +1,141 @@
+// Decoder for the binary game state format (see src/game_state_binary.h for the schema).
+// Decoded messages have the same shape as the JSON responses of the API.
+
+const STATE_MESSAGE_GAME_STATE = 1;
+const STATE_MESSAGE_PLAYERS = 2;
+const STATE_MESSAGE_GAME_STATE_DELTA = 3;
+const STATE_FORMAT_VERSION = 1;
+
+const stateDirections = ['U', 'D', 'L', 'R'];
+
+class StateReader {
+  constructor(buffer) {
+    this.view = new DataView(buffer);
+    this.offset = 0;
+  }
+
+  u8() {
+    return this.view.getUint8(this.offset++);
+  }
+
+  varint() {
+    let result = 0;
+    let mul = 1;
+    let byte;
+    do {
+      byte = this.u8();
+      result += (byte & 0x7F) * mul;
+      mul *= 128;
+    } while (byte & 0x80);
+    return result;
+  }
+
+  f32() {
+    const value = this.view.getFloat32(this.offset, true);
+    this.offset += 4;
+    return value;
+  }
+
+  string() {
+    const len = this.varint();
+    const bytes = new Uint8Array(this.view.buffer, this.view.byteOffset + this.offset, len);
+    this.offset += len;
+    return new TextDecoder('utf-8').decode(bytes);
+  }
+}
+
+function readStateHeader(reader, expectedType) {
+  const type = reader.u8();
+  const version = reader.u8();
+  if (type != expectedType || version != STATE_FORMAT_VERSION) {
+    throw new Error('Unexpected state message ' + type + ' v' + version);
+  }
+}
+
+function readStatePlayers(reader) {
+  const players = {};
+  for (let count = reader.varint(); count > 0; --count) {
+    const id = reader.varint();
+    const pos = [reader.f32(), reader.f32()];
+    const speed = [reader.f32(), reader.f32()];
+    const dir = stateDirections[reader.u8()];
+    const score = reader.varint();
+    const bag = [];
+    for (let bagSize = reader.varint(); bagSize > 0; --bagSize) {
+      const lootId = reader.varint();
+      bag.push({id: lootId, type: reader.u8()});
+    }
+    players[id] = {pos: pos, speed: speed, dir: dir, score: score, bag: bag};
+  }
+  return players;
+}
+
+function readStateLostObjects(reader) {
+  const lostObjects = {};
+  for (let count = reader.varint(); count > 0; --count) {
+    const id = reader.varint();
+    const type = reader.u8();
+    lostObjects[id] = {type: type, pos: [reader.f32(), reader.f32()]};
+  }
+  return lostObjects;
+}
+
+function readStateIds(reader) {
+  const ids = [];
+  for (let count = reader.varint(); count > 0; --count) {
+    ids.push(reader.varint());
+  }
+  return ids;
+}
+
+function decodeGameState(buffer) {
+  const reader = new StateReader(buffer);
+  readStateHeader(reader, STATE_MESSAGE_GAME_STATE);
+  const players = readStatePlayers(reader);
+  return {players: players, lostObjects: readStateLostObjects(reader)};
+}
+
+function decodeGameStateDelta(buffer) {
+  const reader = new StateReader(buffer);
+  readStateHeader(reader, STATE_MESSAGE_GAME_STATE_DELTA);
+  const version = reader.varint();
+  const full = reader.u8() != 0;
+  const players = readStatePlayers(reader);
+  const lostObjects = readStateLostObjects(reader);
+  const removedPlayers = readStateIds(reader);
+  return {
+    version: version,
+    full: full,
+    players: players,
+    lostObjects: lostObjects,
+    removedPlayers: removedPlayers,
+    removedObjects: readStateIds(reader)
+  };
+}
+
+function decodePlayers(buffer) {
+  const reader = new StateReader(buffer);
+  readStateHeader(reader, STATE_MESSAGE_PLAYERS);
+  const players = {};
+  for (let count = reader.varint(); count > 0; --count) {
+    const id = reader.varint();
+    players[id] = {name: reader.string()};
+  }
+  return players;
+}
+
+function fetchBinaryState(url, decode) {
+  return fetch(url, {
+    headers: {
+      'Accept': 'application/octet-stream',
+      'Authorization': 'Bearer ' + Cookies.get('authToken')
+    }
+  }).then(function(response) {
+    if (!response.ok) {
+      const error = new Error(response.statusText);
+      error.status = response.status;
+      throw error;
+    }
+    return response.arrayBuffer();
+  }).then(decode);
+}
@@ -0,0 +1,104 @@
+// Game state pushed by the server over /api/v1/game/ws instead of polling /api/v1/game/state.
+// Incoming text frames are either the game state or an error object with a "code" field.
+
+class StateSocket {
+  constructor(token, binary) {
+    const protocol = window.location.protocol === 'https:' ? 'wss:' : 'ws:';
+    let url = protocol + '//' + window.location.host + '/api/v1/game/ws?token=' + encodeURIComponent(token);
+    if (binary) {
+      url += '&format=binary';
+    }
+
+    this.binary = binary;
+    this.latestState = undefined;
+    this.waiting = [];
+    this.socket = new WebSocket(url);
+    this.socket.binaryType = 'arraybuffer';
+
+    const self = this;
+    this.socket.onmessage = function(event) {
+      self._onMessage(event.data);
+    };
+  }
+
+  // calls then(state) with a frame that has not been handed out yet, waiting for the next one if needed
+  getState(then) {
+    if (this.latestState !== undefined) {
+      const state = this.latestState;
+      this.latestState = undefined;
+      then(state);
+    } else {
+      this.waiting.push(then);
+    }
+  }
+
+  sendMove(move) {
+    if (this.socket.readyState !== WebSocket.OPEN) {
+      return false;
+    }
+    this.socket.send(JSON.stringify({move: move}));
+    return true;
+  }
+
+  _onMessage(data) {
+    let message;
+    if (data instanceof ArrayBuffer) {
+      message = decodeGameState(data);
+    } else {
+      message = JSON.parse(data);
+      if (message.code !== undefined) {
+        console.warn('state socket: ' + message.code + ': ' + message.message);
+        return;
+      }
+    }
+
+    if (this.waiting.length == 0) {
+      this.latestState = message;
+      return;
+    }
+    const waiting = this.waiting;
+    this.waiting = [];
+    waiting.forEach(function(then) {
+      then(message);
+    });
+  }
+}
+
+// Read-only alternative for networks that block WebSocket: /api/v1/game/state/stream (text/event-stream).
+class StateEventStream {
+  constructor(token, maxFps) {
+    let url = '/api/v1/game/state/stream?token=' + encodeURIComponent(token);
+    if (maxFps) {
+      url += '&fps=' + maxFps;
+    }
+
+    this.latestState = undefined;
+    this.waiting = [];
+    this.source = new EventSource(url);
+
+    const self = this;
+    this.source.addEventListener('state', function(event) {
+      self._onState(JSON.parse(event.data));
+    });
+  }
+
+  getState(then) {
+    StateSocket.prototype.getState.call(this, then);
+  }
+
+  sendMove(move) {
+    return false;
+  }
+
+  _onState(state) {
+    if (this.waiting.length == 0) {
+      this.latestState = state;
+      return;
+    }
+    const waiting = this.waiting;
+    this.waiting = [];
+    waiting.forEach(function(then) {
+      then(state);
+    });
+  }
+}
@@ -0,0 +1,120 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/benchmark/catch_benchmark.hpp>
+
+#include "../src/api_router.h"
+
+using namespace api_router;
+using namespace std::literals;
+
+namespace {
+
+// прежняя цепочка сравнений префиксов, для сравнения в бенчмарке
+int LegacyDispatch(std::string_view target) {
+    if (target.substr(0, 12) == "/api/v1/maps"sv) return 0;
+    if (target.substr(0, 20) == "/api/v1/game/players"sv) return 1;
+    if (target.substr(0, 17) == "/api/v1/game/join"sv) return 2;
+    if (target.substr(0, 18) == "/api/v1/game/state"sv) return 3;
+    if (target.substr(0, 26) == "/api/v1/game/player/action"sv) return 4;
+    if (target.substr(0, 17) == "/api/v1/game/tick"sv) return 5;
+    if (target.substr(0, 20) == "/api/v1/game/records"sv) return 6;
+    return -1;
+}
+
+} // namespace
+
+SCENARIO("Compile-time API router") {
+    GIVEN("the API route table") {
+        WHEN("static paths are matched") {
+            THEN("each path resolves to its route") {
+                CHECK(API_ROUTER.Match("/api/v1/maps"sv)->route == Route::maps);
+                CHECK(API_ROUTER.Match("/api/v1/game/players"sv)->route == Route::players);
+                CHECK(API_ROUTER.Match("/api/v1/game/join"sv)->route == Route::join);
+                CHECK(API_ROUTER.Match("/api/v1/game/state"sv)->route == Route::state);
+                CHECK(API_ROUTER.Match("/api/v1/game/player/action"sv)->route == Route::action);
+                CHECK(API_ROUTER.Match("/api/v1/game/batch"sv)->route == Route::batch);
+                CHECK(API_ROUTER.Match("/api/v1/game/tick"sv)->route == Route::tick);
+                CHECK(API_ROUTER.Match("/api/v1/game/records/"sv)->route == Route::records);
+                CHECK(API_ROUTER.Match("/api/v1/admin/tick-metrics"sv)->route == Route::tick_metrics);
+            }
+        }
+
+        WHEN("a path with a parameter is matched") {
+            auto match = API_ROUTER.Match("/api/v1/maps/map1/"sv);
+
+            THEN("the parameter is extracted") {
+                REQUIRE(match);
+                CHECK(match->route == Route::map);
+                CHECK(GetPathParam<std::string>(*match, 0) == "map1"s);
+                CHECK_FALSE(GetPathParam<int>(*match, 0));
+                CHECK_FALSE(GetPathParam<std::string>(*match, 1));
+            }
+        }
+
+        WHEN("unknown or malformed paths are matched") {
+            THEN("nothing is found") {
+                CHECK_FALSE(API_ROUTER.Match(""sv));
+                CHECK_FALSE(API_ROUTER.Match("/"sv));
+                CHECK_FALSE(API_ROUTER.Match("/api/v1/game"sv));
+                CHECK_FALSE(API_ROUTER.Match("/api/v1/game/player"sv));
+                CHECK_FALSE(API_ROUTER.Match("/api/v1/game/states"sv));
+                CHECK_FALSE(API_ROUTER.Match("/api/v1//maps"sv));
+                CHECK_FALSE(API_ROUTER.Match("/api/v1/maps/map1/extra"sv));
+            }
+        }
+
+        WHEN("methods are checked") {
+            auto state = API_ROUTER.Match("/api/v1/game/state"sv);
+            auto join = API_ROUTER.Match("/api/v1/game/join"sv);
+
+            THEN("only the allowed methods pass") {
+                CHECK(state->IsMethodAllowed(http::verb::get));
+                CHECK(state->IsMethodAllowed(http::verb::head));
+                CHECK_FALSE(state->IsMethodAllowed(http::verb::post));
+                CHECK(join->IsMethodAllowed(http::verb::post));
+                CHECK_FALSE(join->IsMethodAllowed(http::verb::get));
+            }
+        }
+    }
+
+    GIVEN("a request target with a query") {
+        auto [path, query] = SplitTarget("/api/v1/game/records?start=5&maxItems=10"sv);
+
+        THEN("path and query are split") {
+            CHECK(path == "/api/v1/game/records"sv);
+            CHECK(query == "start=5&maxItems=10"sv);
+        }
+    }
+
+    GIVEN("query parameter values") {
+        THEN("they are parsed into typed values") {
+            CHECK(ParseParam<std::uint64_t>("42"sv) == 42u);
+            CHECK(ParseParam<double>("0.5"sv) == 0.5);
+            CHECK_FALSE(ParseParam<int>(""sv));
+            CHECK_FALSE(ParseParam<int>("12abc"sv));
+            CHECK_FALSE(ParseParam<std::uint32_t>("-1"sv));
+        }
+    }
+}
+
+TEST_CASE("API dispatch cost", "[.][benchmark]") {
+    std::array targets = {
+        "/api/v1/maps"sv, "/api/v1/maps/map1"sv, "/api/v1/game/state"sv,
+        "/api/v1/game/player/action"sv, "/api/v1/game/records"sv, "/api/v1/unknown"sv
+    };
+
+    BENCHMARK("trie router") {
+        int found = 0;
+        for (auto target : targets) {
+            found += API_ROUTER.Match(SplitTarget(target).first).has_value();
+        }
+        return found;
+    };
+
+    BENCHMARK("prefix chain") {
+        int found = 0;
+        for (auto target : targets) {
+            found += LegacyDispatch(target) >= 0;
+        }
+        return found;
+    };
+}
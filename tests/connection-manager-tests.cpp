@@ -0,0 +1,162 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "../src/connection_manager.h"
+
+#include <vector>
+
+using namespace std::literals;
+using namespace connection_manager;
+
+namespace {
+
+ConnectionLimits MakeLimits(size_t max_connections) {
+    ConnectionLimits limits;
+    limits.max_connections = max_connections;
+    limits.idle_timeout = 30s;
+    limits.min_idle_timeout = 2s;
+    limits.idle_shrink_from = 0.5;
+    return limits;
+}
+
+} // namespace
+
+SCENARIO("Connection manager") {
+    GIVEN("a manager for two connections") {
+        auto manager = std::make_shared<ConnectionManager>(MakeLimits(2));
+        int woken = 0;
+        auto waiter = [&woken] {
+            ++woken;
+        };
+
+        WHEN("both places are taken") {
+            auto first = manager->TryAcquire(waiter);
+            auto second = manager->TryAcquire(waiter);
+
+            THEN("the third connection waits") {
+                REQUIRE(first);
+                REQUIRE(second);
+                CHECK(manager->GetConnectionCount() == 2);
+                CHECK_FALSE(manager->TryAcquire(waiter));
+                CHECK(woken == 0);
+
+                AND_WHEN("a connection closes") {
+                    first.reset();
+
+                    THEN("the waiter is woken once and may take the place") {
+                        CHECK(woken == 1);
+                        CHECK(manager->GetConnectionCount() == 1);
+                        CHECK(manager->TryAcquire(waiter));
+                        second.reset();
+                        CHECK(woken == 1);
+                    }
+                }
+            }
+        }
+
+        WHEN("a connection is moved") {
+            std::vector<ConnectionManager::Connection> connections;
+            connections.push_back(std::move(*manager->TryAcquire(waiter)));
+            ConnectionManager::Connection moved = std::move(connections.back());
+            connections.clear();
+
+            THEN("its place is released once") {
+                CHECK(manager->GetConnectionCount() == 1);
+            }
+        }
+    }
+
+    GIVEN("a manager for ten connections") {
+        auto manager = std::make_shared<ConnectionManager>(MakeLimits(10));
+        std::vector<ConnectionManager::Connection> connections;
+        auto open = [&](size_t count) {
+            while (connections.size() < count) {
+                connections.push_back(std::move(*manager->TryAcquire([] {})));
+            }
+        };
+
+        THEN("the idle timeout is full up to half of the places") {
+            CHECK(manager->GetIdleTimeout() == 30s);
+            open(5);
+            CHECK(manager->GetIdleTimeout() == 30s);
+        }
+
+        THEN("it shrinks linearly to the minimum when all places are taken") {
+            open(8);
+            CHECK(manager->GetIdleTimeout() == 13200ms);
+            open(10);
+            CHECK(manager->GetIdleTimeout() == 2s);
+        }
+    }
+
+    GIVEN("a manager without a limit") {
+        auto manager = std::make_shared<ConnectionManager>(MakeLimits(0));
+
+        THEN("connections are always accepted with the full idle timeout") {
+            std::vector<ConnectionManager::Connection> connections;
+            for (int i = 0; i < 100; ++i) {
+                auto connection = manager->TryAcquire([] {});
+                REQUIRE(connection);
+                connections.push_back(std::move(*connection));
+            }
+            CHECK(manager->GetIdleTimeout() == 30s);
+        }
+    }
+
+    GIVEN("connections with requests in flight") {
+        bool drained = false;
+        auto manager = std::make_shared<ConnectionManager>(MakeLimits(2));
+        auto busy = manager->TryAcquire([] {});
+        auto idle = manager->TryAcquire([] {});
+        busy->BeginRequest();
+        busy->BeginRequest();
+
+        int closed_acceptors = 0;
+        manager->OnDrain([&closed_acceptors] {
+            ++closed_acceptors;
+        });
+        bool waiting_acceptor_woken = false;
+        REQUIRE_FALSE(manager->TryAcquire([&waiting_acceptor_woken] {
+            waiting_acceptor_woken = true;
+        }));
+
+        WHEN("the server drains") {
+            manager->Drain([&drained] {
+                drained = true;
+            });
+
+            THEN("acceptors are closed and new connections are refused") {
+                CHECK(closed_acceptors == 1);
+                CHECK(busy->IsDraining());
+                CHECK_FALSE(manager->TryAcquire([] {}));
+                idle.reset();
+                CHECK_FALSE(waiting_acceptor_woken);
+            }
+
+            THEN("it completes when the last in-flight request is answered") {
+                CHECK_FALSE(drained);
+                busy->EndRequest();
+                CHECK_FALSE(drained);
+                busy->EndRequest();
+                CHECK(drained);
+            }
+
+            THEN("a closed connection finishes its unanswered requests") {
+                busy.reset();
+                CHECK(drained);
+                CHECK(manager->GetRequestCount() == 0);
+            }
+        }
+
+        WHEN("nothing is in flight") {
+            busy->EndRequest();
+            busy->EndRequest();
+            manager->Drain([&drained] {
+                drained = true;
+            });
+
+            THEN("draining completes at once") {
+                CHECK(drained);
+            }
+        }
+    }
+}
@@ -0,0 +1,165 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "../src/app.h"
+#include "../src/game_state_binary.h"
+#include "../src/game_state_snapshot.h"
+#include "../src/json_loader.h"
+#include "../src/model.h"
+
+using namespace model;
+using namespace std::literals;
+
+SCENARIO("Game state snapshot") {
+    GIVEN("an app with one player on map1") {
+        Game game = json_loader::LoadGame("../../tests/test_config.json"s);
+        app::Application app(&game);
+        auto join_res = app.JoinGame("dog1"s, "map1"s);
+        const std::string& token = *join_res.token;
+
+        WHEN("state is requested twice without changes") {
+            auto first = app.GetGameStateSnapshot(token);
+            auto second = app.GetGameStateSnapshot(token);
+
+            THEN("the same buffer is shared") {
+                CHECK(first == second);
+                CHECK(*first == snapshot::SerializeGameState(*app.GetPlayerGameSession(token)));
+            }
+        }
+
+        WHEN("the dog changes direction between ticks") {
+            auto before = app.GetGameStateSnapshot(token);
+            REQUIRE(app.MoveDog(token, "R"sv));
+            auto after = app.GetGameStateSnapshot(token);
+
+            THEN("a new buffer is built and the old one stays intact") {
+                CHECK(before != after);
+                CHECK(*before != *after);
+                CHECK(*after == snapshot::SerializeGameState(*app.GetPlayerGameSession(token)));
+            }
+        }
+
+        WHEN("a tick is processed") {
+            auto before = app.GetGameStateSnapshot(token);
+            app.MoveDog(token, "R"sv);
+            app.ProcessTick(100);
+
+            THEN("the tick publishes a fresh snapshot") {
+                auto after = app.GetGameStateSnapshot(token);
+                CHECK(after == app.GetGameStateSnapshot(token));
+                CHECK(*after != *before);
+            }
+        }
+    }
+}
+
+SCENARIO("Game state delta") {
+    GIVEN("a session with two dogs") {
+        Game game = json_loader::LoadGame("../../tests/test_config.json"s);
+        game.SetLootConfig(1000., 0.);
+        auto& session = game.StartGameSession(game.FindMap(Map::Id{"map1"s}));
+        Dog* dog1 = session.AddDog("dog1"s);
+        Dog* dog2 = session.AddDog("dog2"s);
+        session.UpdateState(100);
+        const std::uint64_t version = session.GetVersion();
+
+        WHEN("nothing changes during a tick") {
+            session.UpdateState(100);
+
+            THEN("the delta is empty") {
+                auto delta = session.MakeDelta(version);
+                CHECK(session.GetVersion() == version + 1);
+                CHECK(delta.changed_dogs.empty());
+                CHECK(delta.spawned_loot.empty());
+                CHECK(delta.removed_dogs.empty());
+                CHECK(delta.removed_loot.empty());
+            }
+        }
+
+        WHEN("one dog moves") {
+            dog1->SetSpeed({1., 0.});
+            dog1->SetDirection(Direction::EAST);
+            session.MarkDogChanged(dog1->GetId());
+
+            THEN("the move is visible before and after the next tick") {
+                auto before_tick = session.MakeDelta(version);
+                REQUIRE(before_tick.changed_dogs.size() == 1);
+                CHECK(before_tick.changed_dogs.front() == dog1);
+
+                session.UpdateState(100);
+                auto after_tick = session.MakeDelta(version);
+                REQUIRE(after_tick.changed_dogs.size() == 1);
+                CHECK(after_tick.changed_dogs.front() == dog1);
+                CHECK(session.MakeDelta(session.GetVersion()).changed_dogs.empty());
+            }
+        }
+
+        WHEN("a dog leaves the session") {
+            const Dog::Id removed_id = dog2->GetId();
+            session.DeleteDog(removed_id);
+            session.UpdateState(100);
+
+            THEN("it is reported as removed") {
+                auto delta = session.MakeDelta(version);
+                REQUIRE(delta.removed_dogs.size() == 1);
+                CHECK(delta.removed_dogs.front() == removed_id);
+                CHECK(session.MakeDelta(session.GetVersion()).removed_dogs.empty());
+            }
+        }
+
+        WHEN("the requested version is older than the history") {
+            for (std::uint64_t i = 0; i <= GameSession::DELTA_HISTORY_DEPTH; ++i) {
+                session.UpdateState(1);
+            }
+
+            THEN("delta can not be made") {
+                CHECK_FALSE(session.CanMakeDelta(version));
+                CHECK_FALSE(session.CanMakeDelta(session.GetVersion() + 1));
+                CHECK(session.CanMakeDelta(session.GetVersion()));
+                CHECK_THROWS_AS(session.MakeDelta(version), std::out_of_range);
+            }
+        }
+    }
+}
+
+SCENARIO("Binary game state encoding") {
+    GIVEN("a binary writer") {
+        std::string out;
+        snapshot::BinaryWriter writer{out};
+
+        WHEN("varints and floats are written") {
+            writer.PutVarint(1);
+            writer.PutVarint(300);
+            writer.PutFloat(1.5);
+
+            THEN("they are encoded as LEB128 and little-endian float32") {
+                CHECK(out == "\x01\xAC\x02\x00\x00\xC0\x3F"s);
+            }
+        }
+    }
+
+    GIVEN("a session with one dog") {
+        Game game = json_loader::LoadGame("../../tests/test_config.json"s);
+        auto& session = game.StartGameSession(game.FindMap(Map::Id{"map1"s}));
+        session.AddDog("Rex"s);
+
+        WHEN("players list is encoded") {
+            std::string encoded = snapshot::EncodePlayersBinary(session.GetDogs());
+
+            THEN("it contains the header, count, id and name") {
+                CHECK(encoded == "\x02\x01\x01\x00\x03Rex"s);
+            }
+        }
+
+        WHEN("game state is encoded") {
+            std::string encoded = snapshot::EncodeGameStateBinary(session);
+
+            THEN("it has the fixed layout of one dog without loot") {
+                // заголовок 2 + количество 1 + id 1 + 4 * f32 + dir 1 + score 1 + bag 1 + количество трофеев 1
+                REQUIRE(encoded.size() == 2 + 1 + 1 + 16 + 1 + 1 + 1 + 1);
+                CHECK(encoded[0] == static_cast<char>(snapshot::MessageType::game_state));
+                CHECK(encoded[1] == static_cast<char>(snapshot::FORMAT_VERSION));
+                CHECK(encoded.back() == '\x00');
+            }
+        }
+    }
+}
@@ -0,0 +1,76 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "../src/handler_memory.h"
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/post.hpp>
+
+#include <vector>
+
+using namespace handler_memory;
+namespace net = boost::asio;
+
+SCENARIO("Recycling handler memory") {
+    GIVEN("handler memory") {
+        HandlerMemory memory;
+
+        WHEN("allocations fit into the blocks") {
+            std::vector<void*> blocks;
+            for (size_t i = 0; i < HandlerMemory::BLOCK_COUNT; ++i) {
+                blocks.push_back(memory.Allocate(HandlerMemory::BLOCK_SIZE, alignof(std::max_align_t)));
+            }
+            void* extra = memory.Allocate(100, alignof(std::max_align_t));
+
+            THEN("blocks are used until they run out, then the heap") {
+                CHECK(blocks.front() != blocks.back());
+                CHECK(memory.GetStats().recycled == HandlerMemory::BLOCK_COUNT);
+                CHECK(memory.GetStats().heap == 1);
+            }
+
+            memory.Deallocate(extra, alignof(std::max_align_t));
+            memory.Deallocate(blocks.back(), alignof(std::max_align_t));
+
+            AND_WHEN("a block is released") {
+                void* again = memory.Allocate(100, alignof(std::max_align_t));
+
+                THEN("it is reused") {
+                    CHECK(again == blocks.back());
+                    CHECK(memory.GetStats().recycled == HandlerMemory::BLOCK_COUNT + 1);
+                }
+                memory.Deallocate(again, alignof(std::max_align_t));
+            }
+            blocks.pop_back();
+            for (void* block : blocks) {
+                memory.Deallocate(block, alignof(std::max_align_t));
+            }
+        }
+
+        WHEN("an allocation is larger than a block") {
+            void* big = memory.Allocate(HandlerMemory::BLOCK_SIZE + 1, alignof(std::max_align_t));
+            memory.Deallocate(big, alignof(std::max_align_t));
+
+            THEN("it goes to the heap") {
+                CHECK(memory.GetStats().recycled == 0);
+                CHECK(memory.GetStats().heap == 1);
+            }
+        }
+
+        WHEN("handlers are posted one after another") {
+            net::io_context ioc;
+            int calls = 0;
+            for (int i = 0; i < 100; ++i) {
+                net::post(ioc, MakeAllocHandler(memory, [&calls] {
+                    ++calls;
+                }));
+                ioc.run();
+                ioc.restart();
+            }
+
+            THEN("their state never touches the heap") {
+                CHECK(calls == 100);
+                CHECK(memory.GetStats().recycled == 100);
+                CHECK(memory.GetStats().heap == 0);
+            }
+        }
+    }
+}
@@ -0,0 +1,356 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/generators/catch_generators.hpp>
+
+#include "../src/http_server.h"
+
+#include <boost/asio/read.hpp>
+
+#include <array>
+#include <atomic>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <string>
+#include <thread>
+
+#include <unistd.h>
+
+using namespace std::literals;
+using namespace http_server;
+
+namespace {
+
+constexpr auto SLOW_RESPONSE_DELAY = 100ms;
+constexpr auto SHORT_IDLE_TIMEOUT = 25ms;
+
+// отвечает путём запроса; на /slow - позже, чем на запросы после него, на /empty - ответом без тела
+struct TestHandler {
+    net::io_context* ioc;
+
+    template <typename Request, typename Send>
+    void operator()(Request& request, std::string_view /*client_ip*/, Send&& send) {
+        if (request.target() == "/empty"sv) {
+            http::response<http::empty_body> empty{http::status::no_content, request.version()};
+            empty.keep_alive(request.keep_alive());
+            send(std::move(empty));
+            return;
+        }
+
+        auto response = send.TakeResponse();
+        response.result(http::status::ok);
+        response.version(request.version());
+        response.keep_alive(request.keep_alive());
+        response.body().assign(request.target().data(), request.target().size());
+        response.prepare_payload();
+
+        if (request.target().starts_with("/slow"sv)) {
+            auto timer = std::make_shared<net::steady_timer>(*ioc, SLOW_RESPONSE_DELAY);
+            timer->async_wait([timer, send = std::forward<Send>(send), response = std::move(response)](sys::error_code) mutable {
+                send(std::move(response));
+            });
+            return;
+        }
+        send(std::move(response));
+    }
+
+    // соединение после апгрейда получает строку "upgraded <путь>" и держит место, пока клиент его не закроет
+    template <typename Request, typename Stream>
+    void Upgrade(Request&& request, std::string_view /*client_ip*/, Stream&& stream, Connection&& connection) {
+        struct Upgraded {
+            std::decay_t<Stream> stream;
+            Connection connection;
+            std::string text;
+            std::array<char, 64> buffer;
+        };
+
+        auto upgraded = std::make_shared<Upgraded>(Upgraded{std::move(stream), std::move(connection),
+                                                            "upgraded "s + std::string{request.target()}, {}});
+        net::async_write(upgraded->stream, net::buffer(upgraded->text), [upgraded](sys::error_code ec, std::size_t) {
+            upgraded->stream.socket().shutdown(net::socket_base::shutdown_send, ec);
+            upgraded->stream.async_read_some(net::buffer(upgraded->buffer), [upgraded](sys::error_code, std::size_t) {
+            });
+        });
+    }
+};
+
+class TestServer {
+public:
+    explicit TestServer(RequestLimits limits = RequestLimits{}, ListenerOptions options = {}) {
+        std::filesystem::remove(path_);
+        ServeHttp(ioc_, unix_socket::endpoint{path_}, std::move(limits), TestHandler{&ioc_}, std::move(options));
+        thread_ = std::thread{[this] {
+            ioc_.run();
+        }};
+    }
+
+    ~TestServer() {
+        ioc_.stop();
+        thread_.join();
+        std::filesystem::remove(path_);
+    }
+
+    const std::string& GetPath() const {
+        return path_;
+    }
+
+private:
+    std::string path_ = (std::filesystem::temp_directory_path()
+                         / ("http-server-tests-"s + std::to_string(::getpid()) + ".sock"s)).string();
+    net::io_context ioc_;
+    std::thread thread_;
+};
+
+class TestClient {
+public:
+    explicit TestClient(const TestServer& server) {
+        socket_.connect(unix_socket::endpoint{server.GetPath()});
+    }
+
+    void Close() {
+        socket_.close();
+    }
+
+    void Send(std::string_view requests) {
+        net::write(socket_, net::buffer(requests));
+    }
+
+    // nullopt - соединение закрыто
+    std::optional<http::response<http::string_body>> Receive() {
+        http::response<http::string_body> response;
+        beast::error_code ec;
+        http::read(socket_, buffer_, response, ec);
+        if (ec) {
+            return std::nullopt;
+        }
+        return response;
+    }
+
+    // всё, что сервер пришлёт до закрытия соединения
+    std::string ReceiveRest() {
+        std::string rest = beast::buffers_to_string(buffer_.data());
+        buffer_.consume(buffer_.size());
+        beast::error_code ec;
+        net::read(socket_, net::dynamic_buffer(rest), ec);
+        return rest;
+    }
+
+private:
+    net::io_context ioc_;
+    unix_socket::socket socket_{ioc_};
+    beast::flat_buffer buffer_;
+};
+
+std::string Get(std::string_view target, std::string_view extra_fields = {}) {
+    return "GET "s + std::string{target} + " HTTP/1.1\r\nHost: test\r\n"s + std::string{extra_fields} + "\r\n"s;
+}
+
+std::string ReceiveBody(TestClient& client) {
+    auto response = client.Receive();
+    return response ? response->body() : "<closed>"s;
+}
+
+template <typename Predicate>
+bool WaitFor(Predicate&& predicate) {
+    for (int i = 0; i < 200 && !predicate(); ++i) {
+        std::this_thread::sleep_for(10ms);
+    }
+    return predicate();
+}
+
+} // namespace
+
+// все сценарии с сервером проходят и для сессий на колбэках, и для сессий на сопрограммах
+SCENARIO("Pipelined HTTP requests") {
+    bool coroutine_sessions = GENERATE(false, true);
+
+    GIVEN("a server that answers /slow later than the requests after it") {
+        RequestLimits limits;
+        limits.SetRouteLimit("/upload"s, {.max_body = 16});
+        auto connections = std::make_shared<ConnectionManager>();
+        TestServer server{std::move(limits),
+                          ListenerOptions{.coroutine_sessions = coroutine_sessions, .connections = connections}};
+        TestClient client{server};
+
+        WHEN("several requests are sent at once") {
+            client.Send(Get("/slow"sv) + Get("/fast?1"sv) + Get("/fast?2"sv));
+
+            THEN("responses come back in request order") {
+                CHECK(ReceiveBody(client) == "/slow"s);
+                CHECK(ReceiveBody(client) == "/fast?1"s);
+                CHECK(ReceiveBody(client) == "/fast?2"s);
+
+                AND_THEN("the connection keeps serving requests") {
+                    client.Send(Get("/fast?3"sv));
+                    CHECK(ReceiveBody(client) == "/fast?3"s);
+                }
+            }
+        }
+
+        WHEN("a response has a body other than a string") {
+            client.Send(Get("/slow"sv) + Get("/empty"sv) + Get("/fast"sv));
+
+            THEN("it is written in its place") {
+                CHECK(ReceiveBody(client) == "/slow"s);
+                auto empty = client.Receive();
+                REQUIRE(empty);
+                CHECK(empty->result() == http::status::no_content);
+                CHECK(ReceiveBody(client) == "/fast"s);
+            }
+        }
+
+        WHEN("the server is drained while a request is in flight") {
+            client.Send(Get("/slow"sv));
+            REQUIRE(WaitFor([&] {
+                return connections->GetRequestCount() == 1;
+            }));
+            std::atomic<bool> drained = false;
+            connections->Drain([&drained] {
+                drained = true;
+            });
+
+            THEN("the request is answered before the connection is closed") {
+                CHECK(ReceiveBody(client) == "/slow"s);
+                CHECK_FALSE(client.Receive());
+                CHECK(WaitFor([&] {
+                    return drained.load();
+                }));
+            }
+        }
+
+        WHEN("a request in the middle asks to close the connection") {
+            client.Send(Get("/slow"sv) + Get("/fast?1"sv, "Connection: close\r\n"sv) + Get("/fast?2"sv));
+
+            THEN("requests up to it are answered and the connection is closed") {
+                CHECK(ReceiveBody(client) == "/slow"s);
+                CHECK(ReceiveBody(client) == "/fast?1"s);
+                CHECK_FALSE(client.Receive());
+            }
+        }
+
+        WHEN("a too large request follows a slow one") {
+            client.Send(Get("/slow"sv) + "POST /upload HTTP/1.1\r\nHost: test\r\nContent-Length: 1000\r\n\r\n"s);
+
+            THEN("it is rejected after the earlier response and the connection is closed") {
+                CHECK(ReceiveBody(client) == "/slow"s);
+                auto rejection = client.Receive();
+                REQUIRE(rejection);
+                CHECK(rejection->result() == http::status::payload_too_large);
+                CHECK_FALSE(client.Receive());
+            }
+        }
+
+        WHEN("an upgrade request follows a slow one") {
+            client.Send(Get("/slow"sv) + Get("/ws"sv, "Connection: Upgrade\r\nUpgrade: websocket\r\n"sv));
+
+            THEN("the connection is handed over after the earlier response is written") {
+                CHECK(ReceiveBody(client) == "/slow"s);
+                CHECK(client.ReceiveRest() == "upgraded /ws"s);
+            }
+        }
+
+        WHEN("a connection is upgraded") {
+            client.Send(Get("/ws"sv, "Connection: Upgrade\r\nUpgrade: websocket\r\n"sv));
+            REQUIRE(client.ReceiveRest() == "upgraded /ws"s);
+
+            THEN("it keeps its place among the connections until it is closed") {
+                // ещё одно место занято под следующий accept
+                CHECK(connections->GetConnectionCount() == 2);
+                client.Close();
+                CHECK(WaitFor([&] {
+                    return connections->GetConnectionCount() == 1;
+                }));
+            }
+        }
+
+        WHEN("a request asks for text/event-stream") {
+            THEN("only the streaming routes hand the connection over") {
+                client.Send(Get("/fast"sv, "Accept: text/event-stream\r\n"sv));
+                CHECK(ReceiveBody(client) == "/fast"s);
+                client.Send(Get("/api/v1/game/state/stream"sv, "Accept: text/event-stream\r\n"sv));
+                CHECK(client.ReceiveRest() == "upgraded /api/v1/game/state/stream"s);
+            }
+        }
+    }
+}
+
+SCENARIO("Idle timeout") {
+    bool coroutine_sessions = GENERATE(false, true);
+
+    GIVEN("a server whose idle timeout is shorter than the slow response") {
+        ListenerOptions options;
+        options.coroutine_sessions = coroutine_sessions;
+        options.connections = std::make_shared<ConnectionManager>(connection_manager::ConnectionLimits{
+            .idle_timeout = SHORT_IDLE_TIMEOUT, .min_idle_timeout = SHORT_IDLE_TIMEOUT});
+        TestServer server{RequestLimits{}, std::move(options)};
+        TestClient client{server};
+
+        WHEN("requests wait for a slow response") {
+            client.Send(Get("/slow"sv) + Get("/fast"sv));
+
+            THEN("the connection is not idle and all of them are answered") {
+                CHECK(ReceiveBody(client) == "/slow"s);
+                CHECK(ReceiveBody(client) == "/fast"s);
+            }
+        }
+
+        WHEN("the client sends nothing after the responses") {
+            client.Send(Get("/slow"sv));
+
+            THEN("the connection is closed") {
+                CHECK(ReceiveBody(client) == "/slow"s);
+                CHECK_FALSE(client.Receive());
+            }
+        }
+
+        WHEN("the client does not finish the request after a slow one") {
+            client.Send(Get("/slow"sv) + "GET /fast HTTP/1.1\r\n"s);
+
+            THEN("the connection is closed after the response") {
+                CHECK(ReceiveBody(client) == "/slow"s);
+                CHECK_FALSE(client.Receive());
+            }
+        }
+    }
+}
+
+SCENARIO("Client address from proxy headers") {
+    GIVEN("a Forwarded header") {
+        THEN("the address is taken from the for parameter of the last element") {
+            CHECK(ParseForwardedFor("for=192.0.2.60;proto=http;by=203.0.113.43"sv, {}) == "192.0.2.60"sv);
+            CHECK(ParseForwardedFor("for=192.0.2.43, for=198.51.100.17"sv, {}) == "198.51.100.17"sv);
+            CHECK(ParseForwardedFor("proto=https; For=192.0.2.43"sv, {}) == "192.0.2.43"sv);
+        }
+
+        THEN("quotes, brackets and ports are removed") {
+            CHECK(ParseForwardedFor(R"(for="198.51.100.17:4711")"sv, {}) == "198.51.100.17"sv);
+            CHECK(ParseForwardedFor(R"(for="[2001:db8:cafe::17]:4711")"sv, {}) == "2001:db8:cafe::17"sv);
+            CHECK(ParseForwardedFor(R"(for="[2001:db8:cafe::17]")"sv, {}) == "2001:db8:cafe::17"sv);
+        }
+
+        THEN("unknown and obfuscated identifiers fall back to X-Forwarded-For") {
+            CHECK(ParseForwardedFor("for=unknown"sv, "203.0.113.9"sv) == "203.0.113.9"sv);
+            CHECK(ParseForwardedFor("for=_hidden;proto=https"sv, "203.0.113.9"sv) == "203.0.113.9"sv);
+            CHECK(ParseForwardedFor("for=192.0.2.43, proto=https"sv, "203.0.113.9"sv) == "203.0.113.9"sv);
+            CHECK(ParseForwardedFor("for=unknown"sv, {}).empty());
+        }
+    }
+
+    GIVEN("only an X-Forwarded-For header") {
+        THEN("the address added by the nearest proxy is taken") {
+            CHECK(ParseForwardedFor({}, "203.0.113.195, 70.41.3.18, 150.172.238.178"sv) == "150.172.238.178"sv);
+            CHECK(ParseForwardedFor({}, " 203.0.113.195 "sv) == "203.0.113.195"sv);
+            CHECK(ParseForwardedFor({}, {}).empty());
+        }
+    }
+
+    GIVEN("a request from a proxy") {
+        http::request<http::string_body> request;
+        request.set(http::field::forwarded, "for=192.0.2.60");
+        const tcp::endpoint remote{net::ip::make_address("127.0.0.1"), 40000};
+
+        THEN("the headers are used only if the proxy is trusted") {
+            CHECK(GetClientIp(request, remote, true) == "192.0.2.60"s);
+            CHECK(GetClientIp(request, remote, false) == "127.0.0.1"s);
+        }
+    }
+}
@@ -0,0 +1,82 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <boost/json.hpp>
+
+#include "../src/app.h"
+#include "../src/game_state_snapshot.h"
+#include "../src/json_loader.h"
+#include "../src/json_writer.h"
+
+using namespace std::literals;
+namespace json = boost::json;
+
+SCENARIO("Streaming JSON writer") {
+    GIVEN("an empty output string") {
+        std::string out;
+        json_writer::JsonWriter writer{out};
+
+        WHEN("nested containers are written") {
+            writer.BeginObject()
+                .Key("a"sv).Int(-1)
+                .Key(17u).BeginArray().Uint(1).Double(0.5).Bool(true).Null().EndArray()
+                .Key("p"sv).Point(1., 2.5)
+                .Key("empty"sv).BeginObject().EndObject()
+                .EndObject();
+
+            THEN("commas and colons are placed correctly") {
+                CHECK(out == R"({"a":-1,"17":[1,0.5,true,null],"p":[1,2.5],"empty":{}})"s);
+            }
+        }
+
+        WHEN("a string with special characters is written") {
+            writer.String("q\"b\\n\n\x01"sv);
+
+            THEN("it is escaped") {
+                CHECK(out == R"("q\"b\\n\n\u0001")"s);
+                CHECK(json::parse(out).as_string() == "q\"b\\n\n\x01"sv);
+            }
+        }
+
+        WHEN("doubles are written") {
+            writer.BeginArray().Double(0.1).Double(-3.).Double(1e300).EndArray();
+
+            THEN("they round-trip through the parser") {
+                auto arr = json::parse(out).as_array();
+                CHECK(arr.at(0).to_number<double>() == 0.1);
+                CHECK(arr.at(1).to_number<double>() == -3.);
+                CHECK(arr.at(2).to_number<double>() == 1e300);
+            }
+        }
+
+        WHEN("containers are unbalanced") {
+            THEN("an exception is thrown") {
+                CHECK_THROWS_AS(writer.EndObject(), std::logic_error);
+            }
+        }
+    }
+}
+
+SCENARIO("Game state JSON written by the streaming writer") {
+    GIVEN("a session with two players") {
+        model::Game game = json_loader::LoadGame("../../tests/test_config.json"s);
+        app::Application app(&game);
+        auto join_res = app.JoinGame("dog1"s, "map1"s);
+        app.JoinGame("dog2"s, "map1"s);
+        app.ProcessTick(1000);
+
+        WHEN("the state is serialized") {
+            auto state = json::parse(snapshot::SerializeGameState(*app.GetPlayerGameSession(*join_res.token)));
+
+            THEN("it has the API shape") {
+                const auto& players = state.as_object().at("players").as_object();
+                CHECK(players.size() == 2);
+                const auto& dog = players.at(std::to_string(*join_res.player_id)).as_object();
+                CHECK(dog.at("pos").as_array().size() == 2);
+                CHECK(dog.at("speed").as_array().size() == 2);
+                CHECK(dog.at("dir").is_string());
+                CHECK(dog.at("bag").is_array());
+                CHECK(state.as_object().at("lostObjects").is_object());
+            }
+        }
+    }
+}
@@ -0,0 +1,81 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "../src/app.h"
+#include "../src/json_loader.h"
+#include "../src/mpsc_queue.h"
+
+#include <thread>
+#include <vector>
+
+using namespace std::literals;
+
+SCENARIO("Lock-free MPSC queue") {
+    GIVEN("a queue filled from several threads") {
+        constexpr int PRODUCERS = 4;
+        constexpr int ITEMS_PER_PRODUCER = 10'000;
+
+        util::MpscQueue<std::pair<int, int>> queue;
+        std::vector<std::thread> producers;
+        for (int producer = 0; producer < PRODUCERS; ++producer) {
+            producers.emplace_back([&queue, producer] {
+                for (int item = 0; item < ITEMS_PER_PRODUCER; ++item) {
+                    queue.Push({producer, item});
+                }
+            });
+        }
+
+        // потребитель работает параллельно с производителями
+        std::vector<int> next_item(PRODUCERS, 0);
+        bool ordered = true;
+        size_t drained = 0;
+        auto check = [&](std::pair<int, int> value) {
+            ordered = ordered && value.second == next_item[value.first];
+            next_item[value.first] = value.second + 1;
+        };
+        while (drained < PRODUCERS * ITEMS_PER_PRODUCER) {
+            drained += queue.Drain(check);
+        }
+        for (auto& producer : producers) {
+            producer.join();
+        }
+
+        THEN("every item is drained once in the order of each producer") {
+            CHECK(ordered);
+            CHECK(queue.Empty());
+            for (int count : next_item) {
+                CHECK(count == ITEMS_PER_PRODUCER);
+            }
+        }
+    }
+}
+
+SCENARIO("Queued player moves") {
+    GIVEN("a player in a game session") {
+        model::Game game = json_loader::LoadGame("../../tests/test_config.json"s);
+        app::Application app(&game);
+        auto join_res = app.JoinGame("dog1"s, "map1"s);
+        const model::GameSession* session = app.GetPlayerGameSession(*join_res.token);
+        const model::Dog* dog = session->GetDog(join_res.player_id);
+
+        WHEN("moves are enqueued") {
+            REQUIRE(app.EnqueueMove(*join_res.token, "L"sv));
+            REQUIRE(app.EnqueueMove(*join_res.token, "R"sv));
+
+            THEN("the dog is unchanged until the tick") {
+                CHECK(dog->IsStopped());
+            }
+
+            THEN("the tick applies them in order") {
+                app.ProcessTick(0);
+                CHECK(dog->GetDirection() == model::Direction::EAST);
+                CHECK(dog->GetSpeed().x > 0);
+            }
+        }
+
+        WHEN("an unknown move is enqueued") {
+            THEN("it is rejected") {
+                CHECK_FALSE(app.EnqueueMove(*join_res.token, "X"sv));
+            }
+        }
+    }
+}
@@ -0,0 +1,106 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "../src/overload_watchdog.h"
+
+using namespace std::literals;
+using namespace overload;
+
+namespace {
+
+WatchdogConfig MakeConfig() {
+    WatchdogConfig config;
+    config.smoothing = 1.;
+    config.escalate_after = 3;
+    config.recover_after = 5;
+    return config;
+}
+
+void RunTicks(Watchdog& watchdog, int count, Watchdog::Clock::duration tick_time) {
+    for (int i = 0; i < count; ++i) {
+        watchdog.OnTick(tick_time, 10ms);
+    }
+}
+
+} // namespace
+
+SCENARIO("Overload watchdog") {
+    GIVEN("a watchdog with a 10ms budget") {
+        Watchdog watchdog{MakeConfig()};
+
+        WHEN("ticks fit into the budget") {
+            RunTicks(watchdog, 100, 5ms);
+
+            THEN("the level stays normal and every snapshot is published") {
+                CHECK(watchdog.GetLevel() == Level::normal);
+                CHECK(watchdog.ShouldPublishSnapshot());
+            }
+
+            THEN("clients are asked to retry after one recovery step, but not sooner than in a second") {
+                CHECK(watchdog.GetRetryAfter() == 1s);
+                watchdog.OnTick(5ms, 500ms);
+                CHECK(watchdog.GetRetryAfter() == 3s);
+            }
+        }
+
+        WHEN("the load stays above the threshold") {
+            RunTicks(watchdog, 3, 12ms);
+
+            THEN("the level rises by one step") {
+                CHECK(watchdog.GetLevel() == Level::reduced_snapshots);
+                bool published_now = watchdog.ShouldPublishSnapshot();
+                RunTicks(watchdog, 1, 12ms);
+                CHECK(watchdog.ShouldPublishSnapshot() != published_now);
+            }
+
+            AND_WHEN("the overload continues") {
+                RunTicks(watchdog, 100, 12ms);
+
+                THEN("the level stops at the deepest one") {
+                    CHECK(watchdog.GetLevel() == MAX_LEVEL);
+                    CHECK(watchdog.IsAtLeast(Level::throttle_polls));
+                }
+
+                AND_WHEN("the load drops") {
+                    RunTicks(watchdog, 5, 2ms);
+
+                    THEN("the level goes down one step at a time") {
+                        CHECK(watchdog.GetLevel() == Level::throttle_polls);
+                        RunTicks(watchdog, 100, 2ms);
+                        CHECK(watchdog.GetLevel() == Level::normal);
+                    }
+                }
+            }
+        }
+
+        WHEN("the load is between the thresholds") {
+            RunTicks(watchdog, 3, 12ms);
+            RunTicks(watchdog, 100, 8ms);
+
+            THEN("the level does not change") {
+                CHECK(watchdog.GetLevel() == Level::reduced_snapshots);
+            }
+        }
+
+        WHEN("the deepest level is limited") {
+            auto config = MakeConfig();
+            config.max_level = Level::skip_idle_loot;
+            watchdog.SetConfig(config);
+            RunTicks(watchdog, 100, 20ms);
+
+            THEN("the watchdog does not go past it") {
+                CHECK(watchdog.GetLevel() == Level::skip_idle_loot);
+                CHECK_FALSE(watchdog.IsAtLeast(Level::throttle_polls));
+            }
+        }
+
+        WHEN("ticks have no budget") {
+            for (int i = 0; i < 100; ++i) {
+                watchdog.OnTick(1s, 0ms);
+            }
+
+            THEN("degradation is not used") {
+                CHECK(watchdog.GetLevel() == Level::normal);
+            }
+        }
+    }
+}
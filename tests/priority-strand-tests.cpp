@@ -0,0 +1,51 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "../src/priority_strand.h"
+
+#include <string>
+
+using namespace std::literals;
+using namespace priority_strand;
+
+SCENARIO("Priority strand") {
+    GIVEN("a strand with queued API work") {
+        net::io_context ioc;
+        auto strand = net::make_strand(ioc);
+        PriorityStrand queue{strand};
+
+        std::string order;
+        for (char request : {'a', 'b', 'c'}) {
+            queue.Post(Priority::normal, [&order, request] {
+                order += request;
+            });
+        }
+
+        WHEN("a tick is posted after the requests") {
+            queue.Post(Priority::high, [&order] {
+                order += 'T';
+            });
+            ioc.run();
+
+            THEN("the tick runs first and the requests keep their order") {
+                CHECK(order == "Tabc");
+            }
+
+            THEN("queue wait is counted per priority") {
+                CHECK(queue.GetWaitStats(Priority::high).count == 1);
+                CHECK(queue.GetWaitStats(Priority::normal).count == 3);
+                CHECK(queue.GetWaitStats(Priority::normal).max >= queue.GetWaitStats(Priority::normal).last);
+            }
+        }
+    }
+
+    GIVEN("wait times of queued tasks") {
+        PriorityStrand::WaitStats stats{.count = 4, .total = 10ms, .max = 6ms, .last = 1ms};
+
+        THEN("they are written for /api/v1/admin/tick-metrics in microseconds") {
+            std::string json;
+            json_writer::JsonWriter writer{json};
+            WriteWaitStats(writer, stats);
+            CHECK(json == R"({"count":4,"avgWaitUs":2500,"maxWaitUs":6000,"lastWaitUs":1000})");
+        }
+    }
+}
@@ -0,0 +1,135 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "../src/rate_limiter.h"
+
+using namespace std::literals;
+using namespace rate_limiter;
+
+namespace {
+
+constexpr std::string_view STATE = "/api/v1/game/state"sv;
+constexpr std::string_view TOKEN = "0123456789abcdef0123456789abcdef"sv;
+constexpr std::string_view OTHER_TOKEN = "fedcba9876543210fedcba9876543210"sv;
+constexpr std::string_view IP = "192.0.2.1"sv;
+
+RateLimits MakeLimits() {
+    RateLimits limits;
+    limits.SetRouteBudget(std::string{STATE}, {.per_token = {.rate = 2., .burst = 3.},
+                                               .per_ip = {.rate = 10., .burst = 5.}});
+    return limits;
+}
+
+int CountAdmitted(RateLimiter& limiter, int requests, std::string_view target, std::string_view token,
+                  std::string_view ip, RateLimiter::Clock::time_point now) {
+    int admitted = 0;
+    for (int i = 0; i < requests; ++i) {
+        admitted += limiter.Admit(target, token, ip, now).allowed ? 1 : 0;
+    }
+    return admitted;
+}
+
+} // namespace
+
+SCENARIO("Token bucket rate limiter") {
+    GIVEN("a limiter with a per-token and per-address budget for the state route") {
+        RateLimiter limiter{MakeLimits()};
+        const auto start = RateLimiter::Clock::now();
+
+        WHEN("a player sends a burst") {
+            int admitted = CountAdmitted(limiter, 10, STATE, TOKEN, IP, start);
+
+            THEN("only the burst is admitted and the rest must retry later") {
+                CHECK(admitted == 3);
+                auto decision = limiter.Admit(STATE, TOKEN, IP, start);
+                CHECK_FALSE(decision.allowed);
+                CHECK(decision.retry_after == 1s);
+            }
+
+            THEN("tokens are refilled at the budget rate") {
+                CHECK(CountAdmitted(limiter, 10, STATE, TOKEN, IP, start + 500ms) == 1);
+                CHECK(CountAdmitted(limiter, 10, STATE, TOKEN, IP, start + 10s) == 3);
+            }
+
+            THEN("the query string does not change the route") {
+                CHECK_FALSE(limiter.Admit("/api/v1/game/state?since=5"sv, TOKEN, IP, start).allowed);
+            }
+
+            THEN("another player from the same address is limited separately") {
+                CHECK(CountAdmitted(limiter, 10, STATE, OTHER_TOKEN, IP, start) == 2);
+            }
+
+            THEN("other routes are not limited") {
+                CHECK(CountAdmitted(limiter, 100, "/api/v1/maps"sv, TOKEN, IP, start) == 100);
+            }
+        }
+
+        WHEN("many players share one address") {
+            int admitted = CountAdmitted(limiter, 3, STATE, TOKEN, IP, start)
+                         + CountAdmitted(limiter, 3, STATE, OTHER_TOKEN, IP, start)
+                         + CountAdmitted(limiter, 3, STATE, ""sv, IP, start);
+
+            THEN("the address budget caps them together") {
+                CHECK(admitted == 5);
+                CHECK(CountAdmitted(limiter, 3, STATE, ""sv, "192.0.2.2"sv, start) == 3);
+            }
+        }
+
+        WHEN("a request is rejected by the token budget") {
+            CountAdmitted(limiter, 4, STATE, TOKEN, IP, start);
+
+            THEN("it does not use up the address budget") {
+                CHECK(CountAdmitted(limiter, 10, STATE, OTHER_TOKEN, IP, start) == 2);
+            }
+        }
+
+        WHEN("many clients come and go") {
+            constexpr int CLIENTS = 2 * RateLimiter::SHARD_COUNT * RateLimiter::SWEEP_THRESHOLD;
+            for (int i = 0; i < CLIENTS; ++i) {
+                limiter.Admit(STATE, ""sv, std::to_string(i), start + std::chrono::milliseconds{i});
+            }
+
+            THEN("refilled buckets are forgotten") {
+                // части перебираются не чаще раза в секунду, за это время приходит тысяча новых клиентов
+                CHECK(limiter.GetBucketCount() <= RateLimiter::SHARD_COUNT * RateLimiter::SWEEP_THRESHOLD + 1000);
+            }
+        }
+
+        WHEN("new clients keep coming while all buckets are in use") {
+            constexpr int CLIENTS = 2 * RateLimiter::SHARD_COUNT * RateLimiter::SWEEP_THRESHOLD;
+            for (int i = 0; i < CLIENTS; ++i) {
+                limiter.Admit(STATE, ""sv, std::to_string(i), start);
+            }
+
+            THEN("nothing is forgotten before the buckets refill") {
+                CHECK(limiter.GetBucketCount() == CLIENTS);
+            }
+        }
+    }
+
+    GIVEN("budgets from the command line") {
+        RateLimits limits;
+
+        THEN("a route budget sets the rate and the burst") {
+            REQUIRE(ParseRateLimit("/api/v1/game/state=20:40"sv, Scope::token, limits));
+            REQUIRE(ParseRateLimit("/api/v1/game/state=100"sv, Scope::ip, limits));
+            const RouteBudget& budget = limits.Find(STATE).second;
+            CHECK(budget.per_token.rate == 20.);
+            CHECK(budget.per_token.burst == 40.);
+            CHECK(budget.per_ip.rate == 100.);
+            CHECK(budget.per_ip.burst == 100.);
+        }
+
+        THEN("* sets the budget of other routes") {
+            REQUIRE(ParseRateLimit("*=7.5"sv, Scope::ip, limits));
+            CHECK(limits.Find("/api/v1/maps"sv).second.per_ip.rate == 7.5);
+        }
+
+        THEN("malformed budgets are rejected") {
+            CHECK_FALSE(ParseRateLimit("api/v1/game/state=1"sv, Scope::token, limits));
+            CHECK_FALSE(ParseRateLimit("/api/v1/game/state"sv, Scope::token, limits));
+            CHECK_FALSE(ParseRateLimit("/api/v1/game/state=fast"sv, Scope::token, limits));
+            CHECK_FALSE(ParseRateLimit("/api/v1/game/state=5:0"sv, Scope::token, limits));
+            CHECK_FALSE(ParseRateLimit(""sv, Scope::token, limits));
+        }
+    }
+}
@@ -0,0 +1,146 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "../src/json_loader.h"
+#include "../src/request_handler.h"
+
+#include <string>
+#include <type_traits>
+
+using namespace std::literals;
+using namespace http_handler;
+
+namespace {
+
+constexpr std::string_view UNKNOWN_TOKEN = "0123456789abcdef0123456789abcdef"sv;
+
+// ответ обработчика; состояние отправляется с общим буфером снимка, в тестах оно копируется в строку
+auto CaptureTo(StringResponse& response) {
+    return [&response]<typename Response>(Response&& sent) {
+        if constexpr (std::is_same_v<std::decay_t<Response>, StateResponse>) {
+            response = StringResponse{std::move(sent.base()), *sent.body()};
+        } else {
+            response = std::move(sent);
+        }
+    };
+}
+
+// пакетный запрос с уже собранным массивом действий
+StringResponse PostBatch(ApiRequestHandler& handler, const json::array& actions, bool with_state = false) {
+    json::object batch{{"actions", actions}};
+    if (with_state) {
+        batch["withState"] = true;
+    }
+
+    http::request<http::string_body> request{http::verb::post, "/api/v1/game/batch", 11};
+    request.set(http::field::content_type, "application/json");
+    request.body() = json::serialize(batch);
+    request.prepare_payload();
+
+    StringResponse response;
+    handler(request, CaptureTo(response));
+    return response;
+}
+
+json::object MakeAction(std::string_view token, std::string_view move) {
+    return {{"token", token}, {"move", move}};
+}
+
+} // namespace
+
+SCENARIO("Batched player actions") {
+    GIVEN("players on two maps") {
+        model::Game game = json_loader::LoadGame("../../tests/test_config.json"s);
+        app::Application app(&game);
+        net::io_context ioc;
+        Strand game_strand = net::make_strand(ioc);
+        state_stream::StateHub hub;
+        state_stream::SpectatorBroadcaster spectators{ioc.get_executor()};
+        auto handler = std::make_shared<ApiRequestHandler>(app, StreamingContext{game_strand, hub, spectators}, true);
+
+        auto first_join = app.JoinGame("dog1"s, "map1"s);
+        std::string first = *first_join.token;
+        std::string second = *app.JoinGame("dog2"s, "map1"s).token;
+        std::string third = *app.JoinGame("dog3"s, "town"s).token;
+
+        WHEN("a batch mixes valid and invalid actions") {
+            json::array actions{
+                MakeAction(first, "L"sv),
+                MakeAction(UNKNOWN_TOKEN, "R"sv),
+                json::object{{"token", third}},
+                MakeAction(second, "X"sv),
+                42,
+                MakeAction(third, "U"sv)
+            };
+            StringResponse response = PostBatch(*handler, actions);
+
+            THEN("every action gets its own result and the valid ones are applied") {
+                REQUIRE(response.result() == http::status::ok);
+                json::value body = json::parse(response.body());
+                const json::array& results = body.as_object().at("results").as_array();
+                REQUIRE(results.size() == actions.size());
+                CHECK(results[0].as_object().empty());
+                CHECK(results[1].as_object().at("code").as_string() == "unknownToken");
+                CHECK(results[2].as_object().at("code").as_string() == "invalidArgument");
+                CHECK(results[3].as_object().at("code").as_string() == "invalidArgument");
+                CHECK(results[4].as_object().at("code").as_string() == "invalidArgument");
+                CHECK(results[5].as_object().empty());
+                CHECK_FALSE(body.as_object().contains("states"));
+
+                app.ProcessTick(100);
+                json::value state = json::parse(*app.GetGameStateSnapshot(first));
+                const auto& players = state.as_object().at("players").as_object();
+                CHECK(players.at(std::to_string(*first_join.player_id)).as_object().at("dir").as_string() == "L");
+            }
+        }
+
+        WHEN("a batch asks for the state of touched sessions") {
+            json::array actions{MakeAction(first, "L"sv), MakeAction(second, "R"sv), MakeAction(third, "D"sv)};
+            StringResponse response = PostBatch(*handler, actions, true);
+
+            THEN("each session state is included once, by map id") {
+                REQUIRE(response.result() == http::status::ok);
+                json::value body = json::parse(response.body());
+                const json::object& states = body.as_object().at("states").as_object();
+                CHECK(states.size() == 2);
+                CHECK(states.at("map1") == json::parse(*app.GetGameStateSnapshot(first)));
+                CHECK(states.at("town") == json::parse(*app.GetGameStateSnapshot(third)));
+            }
+        }
+
+        WHEN("no action of a batch with withState is valid") {
+            json::array actions{MakeAction(UNKNOWN_TOKEN, "L"sv)};
+            StringResponse response = PostBatch(*handler, actions, true);
+
+            THEN("the states are empty") {
+                json::value body = json::parse(response.body());
+                CHECK(body.as_object().at("states").as_object().empty());
+            }
+        }
+
+        WHEN("a batch is larger than allowed") {
+            json::array actions;
+            for (size_t i = 0; i <= ApiRequestHandler::MAX_BATCH_SIZE; ++i) {
+                actions.push_back(MakeAction(first, "L"sv));
+            }
+            StringResponse response = PostBatch(*handler, actions);
+
+            THEN("the whole batch is rejected") {
+                CHECK(response.result() == http::status::bad_request);
+                CHECK(json::parse(response.body()).as_object().at("code").as_string() == "invalidArgument");
+            }
+        }
+
+        WHEN("the batch is malformed") {
+            http::request<http::string_body> request{http::verb::post, "/api/v1/game/batch", 11};
+            request.set(http::field::content_type, "application/json");
+            request.body() = R"({"actions": [], "withState": "yes"})";
+            request.prepare_payload();
+            StringResponse response;
+            (*handler)(request, CaptureTo(response));
+
+            THEN("it is rejected") {
+                CHECK(response.result() == http::status::bad_request);
+            }
+        }
+    }
+}
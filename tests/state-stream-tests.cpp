@@ -0,0 +1,127 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "../src/app.h"
+#include "../src/game_state_binary.h"
+#include "../src/json_loader.h"
+#include "../src/state_stream.h"
+
+#include <vector>
+
+using namespace std::literals;
+
+namespace {
+
+class FrameCollector : public state_stream::Subscriber {
+public:
+    explicit FrameCollector(snapshot::Encoding encoding = snapshot::Encoding::json)
+        : encoding_(encoding) {
+    }
+
+    void OnFrame(const snapshot::Buffer& frame) override {
+        frames.push_back(frame);
+    }
+
+    snapshot::Encoding GetEncoding() const override {
+        return encoding_;
+    }
+
+    std::vector<snapshot::Buffer> frames;
+
+private:
+    snapshot::Encoding encoding_;
+};
+
+} // namespace
+
+SCENARIO("State hub fan-out") {
+    GIVEN("an app with a state hub and one player") {
+        model::Game game = json_loader::LoadGame("../../tests/test_config.json"s);
+        app::Application app(&game);
+        state_stream::StateHub hub;
+        app.SetListener(&hub);
+
+        auto join_res = app.JoinGame("dog1"s, "map1"s);
+        const model::GameSession* session = app.GetPlayerGameSession(*join_res.token);
+
+        auto first = std::make_shared<FrameCollector>();
+        auto second = std::make_shared<FrameCollector>();
+        auto binary = std::make_shared<FrameCollector>(snapshot::Encoding::binary);
+        hub.Subscribe(session, first);
+        hub.Subscribe(session, second);
+        hub.Subscribe(session, binary);
+
+        WHEN("a tick is processed") {
+            app.ProcessTick(100);
+
+            THEN("every subscriber receives the same published buffer") {
+                REQUIRE(first->frames.size() == 1);
+                REQUIRE(second->frames.size() == 1);
+                CHECK(first->frames[0] == second->frames[0]);
+                CHECK(first->frames[0] == app.GetGameStateSnapshot(*join_res.token));
+            }
+
+            THEN("binary subscribers receive the binary state") {
+                REQUIRE(binary->frames.size() == 1);
+                CHECK(*binary->frames[0] == snapshot::EncodeGameStateBinary(*session));
+            }
+        }
+
+        WHEN("a subscriber goes away") {
+            second.reset();
+            app.ProcessTick(100);
+            app.ProcessTick(100);
+
+            THEN("the others keep receiving frames") {
+                CHECK(first->frames.size() == 2);
+            }
+        }
+    }
+}
+
+SCENARIO("Waiting for the next state update") {
+    GIVEN("an app with a state hub and a waiting request") {
+        model::Game game = json_loader::LoadGame("../../tests/test_config.json"s);
+        app::Application app(&game);
+        state_stream::StateHub hub;
+        app.SetListener(&hub);
+
+        auto join_res = app.JoinGame("dog1"s, "map1"s);
+        const model::GameSession* session = app.GetPlayerGameSession(*join_res.token);
+        std::uint64_t version_before = session->GetVersion();
+
+        std::vector<std::uint64_t> seen_versions;
+        auto wait_id = hub.WaitForUpdate(session, [&] {
+            seen_versions.push_back(session->GetVersion());
+        });
+
+        WHEN("ticks are processed") {
+            app.ProcessTick(100);
+            app.ProcessTick(100);
+
+            THEN("the waiter is called once with the new state already published") {
+                REQUIRE(seen_versions.size() == 1);
+                CHECK(seen_versions[0] > version_before);
+                CHECK(hub.GetWaiterCount() == 0);
+            }
+        }
+
+        WHEN("waits time out while there are no ticks") {
+            hub.CancelWait(session, wait_id);
+            for (int i = 0; i < 100; ++i) {
+                hub.CancelWait(session, hub.WaitForUpdate(session, [] {}));
+            }
+
+            THEN("cancelled waiters are not kept") {
+                CHECK(hub.GetWaiterCount() == 0);
+
+                AND_WHEN("a tick is processed") {
+                    app.ProcessTick(100);
+
+                    THEN("they are not called") {
+                        CHECK(seen_versions.empty());
+                    }
+                }
+            }
+        }
+    }
+}
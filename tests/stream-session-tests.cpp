@@ -0,0 +1,394 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "../src/event_stream_session.h"
+#include "../src/json_loader.h"
+#include "../src/request_handler.h"
+#include "../src/spectator_broadcast.h"
+
+#include <boost/asio/read_until.hpp>
+#include <boost/asio/steady_timer.hpp>
+
+#include <functional>
+#include <future>
+#include <memory>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std::literals;
+using namespace state_stream;
+
+namespace {
+
+using tcp = net::ip::tcp;
+namespace sys = boost::system;
+
+constexpr auto FRAME_PERIOD = 20ms;
+
+// соединение через loopback: серверный сокет на ioc сервера, клиентский - на своём
+std::pair<tcp::socket, tcp::socket> Connect(net::io_context& server_ioc, net::io_context& client_ioc) {
+    tcp::acceptor acceptor{server_ioc, tcp::endpoint{net::ip::make_address("127.0.0.1"), 0}};
+    tcp::socket client{client_ioc};
+    client.connect(acceptor.local_endpoint());
+    return {acceptor.accept(), std::move(client)};
+}
+
+// останавливает ioc и дожидается потока, даже если проверка прервала сценарий
+class ServerThread {
+public:
+    explicit ServerThread(net::io_context& ioc)
+        : ioc_(ioc)
+        , thread_([&ioc] {
+            ioc.run();
+        }) {
+    }
+
+    ~ServerThread() {
+        ioc_.stop();
+        thread_.join();
+    }
+
+private:
+    net::io_context& ioc_;
+    std::thread thread_;
+};
+
+// клиент text/event-stream
+class EventClient {
+public:
+    explicit EventClient(tcp::socket socket)
+        : socket_(std::move(socket)) {
+    }
+
+    std::string ReadHeader() {
+        return ReadUntil("\r\n\r\n"sv).value_or(""s);
+    }
+
+    // nullopt - соединение закрыто
+    std::optional<std::string> ReadEvent() {
+        return ReadUntil("\n\n"sv);
+    }
+
+    void Close() {
+        socket_.close();
+    }
+
+private:
+    tcp::socket socket_;
+    std::string buffer_;
+
+    std::optional<std::string> ReadUntil(std::string_view delimiter) {
+        sys::error_code ec;
+        std::size_t size = net::read_until(socket_, net::dynamic_buffer(buffer_), delimiter, ec);
+        if (ec) {
+            return std::nullopt;
+        }
+        std::string message = buffer_.substr(0, size);
+        buffer_.erase(0, size);
+        return message;
+    }
+};
+
+SpectatorFramePtr MakeFrame(std::uint64_t seq) {
+    return std::make_shared<const SpectatorFrame>(
+        SpectatorFrame{seq, std::string{STATE_EVENT_PREFIX} + std::to_string(seq) + std::string{STATE_EVENT_SUFFIX}});
+}
+
+// апгрейд через ApiRequestHandler, как это делает сервер после чтения запроса
+void AcceptUpgrade(tcp::socket socket, std::shared_ptr<http_handler::ApiRequestHandler> handler) {
+    struct Upgrade {
+        beast::tcp_stream stream;
+        beast::flat_buffer buffer;
+        http::request<http::string_body> request;
+    };
+
+    auto upgrade = std::make_shared<Upgrade>(Upgrade{beast::tcp_stream{std::move(socket)}});
+    http::async_read(upgrade->stream, upgrade->buffer, upgrade->request,
+                     [upgrade, handler](sys::error_code ec, [[maybe_unused]] std::size_t bytes_read) {
+        if (!ec) {
+            handler->Upgrade(std::move(upgrade->request), std::move(upgrade->stream), Connection{});
+        }
+    });
+}
+
+// выполняет fn на strand игры и дожидается его завершения
+void RunOnStrand(Strand& strand, std::function<void()> fn) {
+    std::promise<void> done;
+    net::post(strand, [&] {
+        fn();
+        done.set_value();
+    });
+    done.get_future().wait();
+}
+
+// клиент WebSocket
+class WsClient {
+public:
+    explicit WsClient(tcp::socket socket)
+        : ws_(std::move(socket)) {
+    }
+
+    // статус ответа на запрос апгрейда; при отказе рукопожатие завершается ошибкой
+    http::status Handshake(std::string_view target) {
+        websocket::response_type response;
+        sys::error_code ec;
+        ws_.handshake(response, "localhost"sv, target, ec);
+        return response.result();
+    }
+
+    void Write(std::string_view text) {
+        ws_.text(true);
+        ws_.write(net::buffer(text));
+    }
+
+    std::string Read() {
+        beast::flat_buffer buffer;
+        ws_.read(buffer);
+        return beast::buffers_to_string(buffer.data());
+    }
+
+    // код ошибки из ответа на команду
+    std::string ReadErrorCode() {
+        json::value error = json::parse(Read());
+        return std::string(error.as_object().at("code").as_string());
+    }
+
+private:
+    websocket::stream<tcp::socket> ws_;
+};
+
+std::string GetDogDirection(app::Application& app, const std::string& token, model::Dog::Id player_id) {
+    json::value state = json::parse(*app.GetGameStateSnapshot(token));
+    const auto& players = state.as_object().at("players").as_object();
+    return std::string(players.at(std::to_string(*player_id)).as_object().at("dir").as_string());
+}
+
+template <typename Predicate>
+bool WaitFor(Predicate&& predicate) {
+    for (int i = 0; i < 200 && !predicate(); ++i) {
+        std::this_thread::sleep_for(10ms);
+    }
+    return predicate();
+}
+
+} // namespace
+
+SCENARIO("Event stream session") {
+    GIVEN("an event stream subscribed to a game session with frames published every tick") {
+        model::Map map{model::Map::Id{"map1"s}, "Map 1"s};
+        model::GameSession game_session{&map, false, model::LootConfig{1., 0.5}};
+        StateHub hub;
+
+        net::io_context ioc;
+        Strand game_strand = net::make_strand(ioc);
+        net::io_context client_ioc;
+        auto [server_socket, client_socket] = Connect(ioc, client_ioc);
+        EventClient client{std::move(client_socket)};
+
+        auto session = std::make_shared<EventStreamSession>(beast::tcp_stream{std::move(server_socket)}, Connection{},
+                                                            game_strand, hub, &game_session,
+                                                            EventStreamSession::Options{});
+        std::weak_ptr<EventStreamSession> weak_session = session;
+        session->Run(11);
+        session.reset();
+
+        // тики на strand игры, как у Ticker
+        net::steady_timer tick_timer{game_strand};
+        int tick = 0;
+        std::function<void()> publish = [&] {
+            hub.OnStateUpdated(game_session, std::make_shared<const std::string>("{\"tick\":"s + std::to_string(++tick) + "}"s));
+            tick_timer.expires_after(FRAME_PERIOD);
+            tick_timer.async_wait([&](sys::error_code ec) {
+                if (!ec) {
+                    publish();
+                }
+            });
+        };
+        net::dispatch(game_strand, publish);
+        ServerThread server_thread{ioc};
+
+        WHEN("the client reads the stream") {
+            std::string header = client.ReadHeader();
+
+            THEN("it receives state events after the header") {
+                CHECK(header.find("Content-Type: text/event-stream"sv) != std::string::npos);
+                for (int i = 0; i < 2; ++i) {
+                    auto event = client.ReadEvent();
+                    REQUIRE(event);
+                    CHECK(event->starts_with("event: state\ndata: {\"tick\":"sv));
+                }
+            }
+
+            AND_WHEN("the client disconnects") {
+                client.ReadEvent();
+                client.Close();
+
+                THEN("the session is released") {
+                    CHECK(WaitFor([&] {
+                        return weak_session.expired();
+                    }));
+                }
+            }
+        }
+    }
+}
+
+SCENARIO("Spectator fan-out") {
+    GIVEN("a spectator channel with several viewers") {
+        constexpr int VIEWERS = 3;
+
+        net::io_context ioc;
+        net::io_context client_ioc;
+        auto channel = std::make_shared<SpectatorChannel>(ioc.get_executor());
+        std::vector<EventClient> clients;
+        for (int i = 0; i < VIEWERS; ++i) {
+            auto [server_socket, client_socket] = Connect(ioc, client_ioc);
+            std::make_shared<SpectatorSession>(beast::tcp_stream{std::move(server_socket)}, Connection{}, channel)
+                ->Run(11);
+            clients.emplace_back(std::move(client_socket));
+        }
+        ServerThread server_thread{ioc};
+
+        for (auto& client : clients) {
+            client.ReadHeader();
+        }
+
+        WHEN("frames are published with an idle period between them") {
+            channel->Publish(MakeFrame(1));
+            std::vector<std::optional<std::string>> first;
+            for (auto& client : clients) {
+                first.push_back(client.ReadEvent());
+            }
+
+            std::this_thread::sleep_for(200ms);
+            channel->Publish(MakeFrame(2));
+
+            THEN("every viewer receives both frames") {
+                for (int i = 0; i < VIEWERS; ++i) {
+                    CHECK(first[i] == MakeFrame(1)->data);
+                    CHECK(clients[i].ReadEvent() == MakeFrame(2)->data);
+                }
+            }
+        }
+
+        WHEN("one viewer disconnects") {
+            clients.front().Close();
+            std::this_thread::sleep_for(100ms);
+            channel->Publish(MakeFrame(1));
+
+            THEN("the others keep receiving frames") {
+                for (int i = 1; i < VIEWERS; ++i) {
+                    CHECK(clients[i].ReadEvent() == MakeFrame(1)->data);
+                }
+            }
+        }
+    }
+}
+
+SCENARIO("WebSocket session") {
+    GIVEN("a player and a WebSocket client") {
+        model::Game game = json_loader::LoadGame("../../tests/test_config.json"s);
+        app::Application app(&game);
+        auto join = app.JoinGame("dog"s, "map1"s);
+        std::string token = *join.token;
+        const model::GameSession* game_session = app.GetPlayerGameSession(token);
+        StateHub hub;
+
+        net::io_context ioc;
+        Strand game_strand = net::make_strand(ioc);
+        SpectatorBroadcaster spectators{ioc.get_executor()};
+        net::io_context client_ioc;
+        auto [server_socket, client_socket] = Connect(ioc, client_ioc);
+        WsClient client{std::move(client_socket)};
+
+        auto make_handler = [&](bool manual_update) {
+            return std::make_shared<http_handler::ApiRequestHandler>(
+                app, http_handler::StreamingContext{game_strand, hub, spectators}, manual_update);
+        };
+        auto publish = [&](int tick) {
+            net::post(game_strand, [&hub, game_session, tick] {
+                hub.OnStateUpdated(*game_session,
+                                   std::make_shared<const std::string>("{\"tick\":"s + std::to_string(tick) + "}"s));
+            });
+        };
+
+        WHEN("the client connects with a frame period and a token in the query") {
+            AcceptUpgrade(std::move(server_socket), make_handler(false));
+            ServerThread server_thread{ioc};
+            http::status status = client.Handshake("/api/v1/game/ws?every=2&token="s + token);
+
+            THEN("the connection is upgraded") {
+                CHECK(status == http::status::switching_protocols);
+            }
+
+            AND_WHEN("states are published on every tick") {
+                // ответ на команду приходит после подписки на состояние
+                client.Write("not a command"sv);
+                REQUIRE(client.ReadErrorCode() == "invalidArgument"s);
+                // не больше двух кадров за раз: пока первый отправляется, второй ждёт в очереди и не заменяется
+                for (int tick = 1; tick <= 3; ++tick) {
+                    publish(tick);
+                }
+
+                THEN("the client receives every second state") {
+                    CHECK(client.Read() == R"({"tick":1})"s);
+                    CHECK(client.Read() == R"({"tick":3})"s);
+                    publish(4);
+                    publish(5);
+                    CHECK(client.Read() == R"({"tick":5})"s);
+                }
+            }
+
+            AND_WHEN("the client sends a move") {
+                client.Write(R"({"move": "L"})"sv);
+                client.Write(R"({"move": "X"})"sv);
+
+                THEN("the move is queued until the next tick and a bad move is reported") {
+                    CHECK(client.ReadErrorCode() == "invalidArgument"s);
+                    RunOnStrand(game_strand, [&] {
+                        app.ProcessTick(100);
+                    });
+                    CHECK(GetDogDirection(app, token, join.player_id) == "L"s);
+                }
+            }
+        }
+
+        WHEN("the game is ticked manually and the client sends a move") {
+            AcceptUpgrade(std::move(server_socket), make_handler(true));
+            ServerThread server_thread{ioc};
+            client.Handshake("/api/v1/game/ws?token="s + token);
+            client.Write(R"({"move": "R"})"sv);
+            client.Write(R"({"move": "X"})"sv);
+
+            THEN("the move is applied right away") {
+                CHECK(client.ReadErrorCode() == "invalidArgument"s);
+                std::string direction;
+                RunOnStrand(game_strand, [&] {
+                    direction = GetDogDirection(app, token, join.player_id);
+                });
+                CHECK(direction == "R"s);
+            }
+        }
+
+        WHEN("the client connects with an unknown token") {
+            AcceptUpgrade(std::move(server_socket), make_handler(false));
+            ServerThread server_thread{ioc};
+            http::status status = client.Handshake("/api/v1/game/ws?token=0123456789abcdef0123456789abcdef"s);
+
+            THEN("the upgrade is rejected") {
+                CHECK(status == http::status::unauthorized);
+            }
+        }
+
+        WHEN("the frame period is zero") {
+            AcceptUpgrade(std::move(server_socket), make_handler(false));
+            ServerThread server_thread{ioc};
+            http::status status = client.Handshake("/api/v1/game/ws?every=0&token="s + token);
+
+            THEN("the upgrade is rejected") {
+                CHECK(status == http::status::bad_request);
+            }
+        }
+    }
+}
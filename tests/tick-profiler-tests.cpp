@@ -0,0 +1,113 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "../src/app.h"
+#include "../src/json_loader.h"
+#include "../src/tick_profiler.h"
+
+#include <boost/json.hpp>
+
+#include <vector>
+
+using namespace std::literals;
+using namespace tick_profiler;
+
+SCENARIO("Duration histogram") {
+    GIVEN("a histogram with known samples") {
+        Histogram histogram;
+        for (int i = 0; i < 90; ++i) {
+            histogram.Record(3us);
+        }
+        for (int i = 0; i < 10; ++i) {
+            histogram.Record(1000us);
+        }
+
+        THEN("percentiles are bucket upper bounds capped by the maximum") {
+            CHECK(histogram.GetCount() == 100);
+            CHECK(histogram.GetPercentile(0.5) == 4us);
+            CHECK(histogram.GetPercentile(0.9) == 4us);
+            CHECK(histogram.GetPercentile(0.99) == 1000us);
+            CHECK(histogram.GetMax() == 1000us);
+        }
+    }
+}
+
+SCENARIO("Tick phase profiling") {
+    GIVEN("an app with one active session") {
+        model::Game game = json_loader::LoadGame("../../tests/test_config.json"s);
+        app::Application app(&game);
+        app.JoinGame("dog1"s, "map1"s);
+
+        WHEN("ticks are processed") {
+            app.ProcessTick(100);
+            app.ProcessTick(100);
+            const TickProfiler& profiler = app.GetTickProfiler();
+
+            THEN("every phase is measured once per tick") {
+                CHECK(profiler.GetTickHistogram().GetCount() == 2);
+                for (const Histogram& phase : profiler.GetPhaseHistograms()) {
+                    CHECK(phase.GetCount() == 2);
+                }
+            }
+
+            THEN("session phases are kept per map") {
+                REQUIRE(profiler.GetSessionHistograms().contains("map1"s));
+                const auto& session = profiler.GetSessionHistograms().at("map1"s);
+                CHECK(session[static_cast<size_t>(Phase::movement)].GetCount() == 2);
+                CHECK(session[static_cast<size_t>(Phase::listeners)].GetCount() == 0);
+            }
+
+            THEN("the profile is written as JSON") {
+                std::string out;
+                json_writer::JsonWriter writer{out};
+                WriteProfile(writer, profiler);
+                auto profile = boost::json::parse(out).as_object();
+                CHECK(profile.at("tick").at("count").as_int64() == 2);
+                CHECK(profile.at("sessions").at("map1").as_object().contains("movement"));
+                CHECK(profile.at("lastTick").as_object().contains("snapshot"));
+            }
+        }
+
+        WHEN("a budget is exceeded") {
+            app.GetTickProfiler().SetBudget(1ns);
+            app.ProcessTick(100);
+
+            THEN("the tick is counted as over budget") {
+                CHECK(app.GetTickProfiler().IsLastTickOverBudget());
+                CHECK(app.GetTickProfiler().GetOverBudgetTicks() == 1);
+            }
+        }
+    }
+}
+
+SCENARIO("Session tick phases") {
+    GIVEN("a session without dogs") {
+        model::Map map{model::Map::Id{"map1"s}, "Map 1"s};
+        model::GameSession session{&map, false, model::LootConfig{1., 0.5}};
+        std::vector<model::TickPhase> phases;
+        auto record = [&phases](model::TickPhase phase, auto&& run) {
+            phases.push_back(phase);
+            run();
+        };
+
+        WHEN("a tick is run") {
+            session.UpdateState(100, record);
+
+            THEN("every phase runs once in order") {
+                using enum model::TickPhase;
+                std::vector expected{input_apply, movement, loot_spawn, gather, scoring};
+                CHECK(phases == expected);
+                CHECK(session.GetVersion() == 1);
+            }
+        }
+
+        WHEN("loot of idle sessions is skipped") {
+            session.UpdateState(100, record, true);
+
+            THEN("loot does not spawn") {
+                using enum model::TickPhase;
+                std::vector expected{input_apply, movement, gather, scoring};
+                CHECK(phases == expected);
+            }
+        }
+    }
+}
@@ -0,0 +1,112 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "../src/ticker.h"
+
+#include <string>
+
+using namespace std::literals;
+using namespace tick;
+
+namespace {
+
+constexpr auto PERIOD = 100ms;
+
+TickerOptions MakeOptions(CatchUpPolicy policy, unsigned max_catch_up_steps = 5) {
+    return {.policy = policy, .max_catch_up_steps = max_catch_up_steps};
+}
+
+} // namespace
+
+SCENARIO("Tick catch-up") {
+    GIVEN("a tick that came a little after its deadline") {
+        THEN("every policy runs one tick and drops nothing") {
+            for (auto policy : {CatchUpPolicy::skip, CatchUpPolicy::coalesce, CatchUpPolicy::fixed_steps}) {
+                CatchUp plan = PlanCatchUp(5ms, 105ms, PERIOD, MakeOptions(policy));
+                CHECK(plan.missed == 0);
+                CHECK(plan.steps == 1);
+                CHECK(plan.dropped_periods == 0);
+            }
+        }
+
+        THEN("only coalesce passes the time since the previous tick") {
+            CHECK(PlanCatchUp(5ms, 105ms, PERIOD, MakeOptions(CatchUpPolicy::skip)).delta == PERIOD);
+            CHECK(PlanCatchUp(5ms, 105ms, PERIOD, MakeOptions(CatchUpPolicy::coalesce)).delta == 105ms);
+            CHECK(PlanCatchUp(5ms, 105ms, PERIOD, MakeOptions(CatchUpPolicy::fixed_steps)).delta == PERIOD);
+        }
+    }
+
+    GIVEN("a tick that is late by three and a half periods") {
+        constexpr auto lateness = 350ms;
+        constexpr auto since_last_tick = 450ms;
+
+        THEN("three whole periods are missed") {
+            CHECK(PlanCatchUp(lateness, since_last_tick, PERIOD, MakeOptions(CatchUpPolicy::skip)).missed == 3);
+            CHECK(PlanCatchUp(PERIOD, 200ms, PERIOD, MakeOptions(CatchUpPolicy::skip)).missed == 1);
+        }
+
+        THEN("skip runs one ordinary tick and drops the missed periods") {
+            CatchUp plan = PlanCatchUp(lateness, since_last_tick, PERIOD, MakeOptions(CatchUpPolicy::skip));
+            CHECK(plan.steps == 1);
+            CHECK(plan.delta == PERIOD);
+            CHECK(plan.dropped_periods == 3);
+        }
+
+        THEN("coalesce runs one tick for all the elapsed time") {
+            CatchUp plan = PlanCatchUp(lateness, since_last_tick, PERIOD, MakeOptions(CatchUpPolicy::coalesce));
+            CHECK(plan.steps == 1);
+            CHECK(plan.delta == since_last_tick);
+            CHECK(plan.dropped_periods == 0);
+        }
+
+        THEN("fixed steps run an ordinary tick for every period") {
+            CatchUp plan = PlanCatchUp(lateness, since_last_tick, PERIOD, MakeOptions(CatchUpPolicy::fixed_steps));
+            CHECK(plan.steps == 4);
+            CHECK(plan.delta == PERIOD);
+            CHECK(plan.dropped_periods == 0);
+        }
+
+        THEN("fixed steps drop the periods over the limit") {
+            CatchUp plan = PlanCatchUp(lateness, since_last_tick, PERIOD, MakeOptions(CatchUpPolicy::fixed_steps, 2));
+            CHECK(plan.steps == 2);
+            CHECK(plan.dropped_periods == 2);
+
+            plan = PlanCatchUp(lateness, since_last_tick, PERIOD, MakeOptions(CatchUpPolicy::fixed_steps, 0));
+            CHECK(plan.steps == 1);
+            CHECK(plan.dropped_periods == 3);
+        }
+    }
+
+    GIVEN("policy names from the command line") {
+        THEN("known names are parsed") {
+            CHECK(ParseCatchUpPolicy("skip"sv) == CatchUpPolicy::skip);
+            CHECK(ParseCatchUpPolicy("coalesce"sv) == CatchUpPolicy::coalesce);
+            CHECK(ParseCatchUpPolicy("steps"sv) == CatchUpPolicy::fixed_steps);
+        }
+
+        THEN("unknown names are rejected") {
+            CHECK_FALSE(ParseCatchUpPolicy("fixed_steps"sv));
+            CHECK_FALSE(ParseCatchUpPolicy(""sv));
+        }
+    }
+}
+
+SCENARIO("Ticker stats") {
+    GIVEN("the counters of a running ticker") {
+        Ticker::Stats stats;
+        stats.ticks = 10;
+        stats.overruns = 1;
+        stats.dropped_periods = 2;
+        stats.max_lateness = 150ms;
+        stats.last_handler = 3ms;
+        stats.max_handler = 5ms;
+        stats.total_handler = 40ms;
+
+        THEN("they are written for /api/v1/admin/tick-metrics in microseconds") {
+            std::string json;
+            json_writer::JsonWriter writer{json};
+            WriteStats(writer, stats);
+            CHECK(json == R"({"ticks":10,"overruns":1,"droppedPeriods":2,"errors":0,"maxLatenessUs":150000,)"
+                          R"("lastHandlerUs":3000,"maxHandlerUs":5000,"totalHandlerUs":40000})"s);
+        }
+    }
+}